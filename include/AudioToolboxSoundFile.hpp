@@ -10,12 +10,17 @@ public:
 	~AudioToolboxSoundFile();
 
 	uint32_t numChannels();
+	double sampleRate();
 	int pull(uint32_t *framesRead, AudioBuffers& buffers);
+	int seek(double seconds);
 	
 	ExtAudioFileRef mXAF;
 	uint32_t mNumChannels;
+	double mSampleRate = 0.;
+	double mFileSampleRate = 0.;
 
-	static std::unique_ptr<AudioToolboxSoundFile> open(const char *path);
+	// files are converted to the thread's sample rate by ExtAudioFile.
+	static std::unique_ptr<AudioToolboxSoundFile> open(const char *path, double threadSampleRate);
 	static std::unique_ptr<AudioToolboxSoundFile> create(const char *path, int numChannels, double threadSampleRate, double fileSampleRate, bool interleaved);
 };
 
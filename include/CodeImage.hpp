@@ -0,0 +1,32 @@
+//    SAPF - Sound As Pure Form
+//    Copyright (C) 2019 James McCartney
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef __CodeImage_h__
+#define __CodeImage_h__
+
+#include "VM.hpp"
+
+// A code image is the serialized output of the parser for a whole source file.
+// Loading one skips parsing entirely. The image records a hash of the source text
+// and of the set of built in names it was compiled against, and is rejected if either differs.
+// Built in functions are stored by name and rebound when the image is read.
+
+int64_t hashSourceText(const char* text, size_t len);
+
+bool writeCodeImage(Thread& th, const char* imagePath, int64_t sourceHash, P<FunDef> const& def);
+bool readCodeImage(Thread& th, const char* imagePath, int64_t sourceHash, P<FunDef>& outDef);
+
+#endif
@@ -22,6 +22,7 @@
 #include <stdio.h>
 #include <algorithm>
 #include "MathFuns.hpp"
+#include "Sample.hpp"
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////
 
@@ -75,14 +76,17 @@ void fillDecayTable();
 void fillFirstOrderCoeffTable();
 void fillOddHilbert(int n, double* h);
 
-inline double lut(double* table, int index, double frac)
+// the table lookups take tables of doubles or of samples.
+template <class T>
+inline double lut(const T* table, int index, double frac)
 {
 	double a = table[index];
 	double b = table[index + 1];
 	return a + frac * (b - a);
 }
 
-inline double oscilLUT(double* table, int index, int mask, double x)
+template <class T>
+inline double oscilLUT(const T* table, int index, int mask, double x)
 {
 	double y0 = table[(index - 1) & mask];
 	double y1 = table[(index    ) & mask];
@@ -97,7 +101,8 @@ inline double oscilLUT(double* table, int index, int mask, double x)
     return ((c3 * x + c2) * x + c1) * x + c0;
 }
 
-inline double oscilLUT2(double* tableA, double* tableB, int index, int mask, double x, double frac)
+template <class T>
+inline double oscilLUT2(const T* tableA, const T* tableB, int index, int mask, double x, double frac)
 {
 	double x2 = x*x;
 	double x3 = x*x2;
@@ -231,6 +236,16 @@ inline void tsincosx(double x, double& sn, double& cs)
 }
 
 
+#if !SAMPLE_IS_DOUBLE
+inline void tsincosx(double x, Z& sn, Z& cs)
+{
+	double dsn, dcs;
+	tsincosx(x, dsn, dcs);
+	sn = dsn;
+	cs = dcs;
+}
+#endif
+
 inline void tsincos1(double x, double& sn, double& cs)
 {
 	double findex = gInvSineTableSize * x;
@@ -24,7 +24,7 @@ struct UnaryOpGen : public Gen
 	VIn _a;
 	UnaryOp* op;
 
-	UnaryOpGen(Thread& th, UnaryOp* inOp, Arg a) : Gen(th, itemTypeV, a.isFinite()), op(inOp), _a(a) {}
+	UnaryOpGen(Thread& th, UnaryOp* inOp, Arg a) : Gen(th, itemTypeV, a.isFinite()), op(inOp), _a(a) { setReadAhead(a); }
 
 	virtual const char* TypeName() const override { return "UnaryOpGen"; }
 		
@@ -57,7 +57,7 @@ struct BinaryOpGen : public Gen
 	VIn _b;
 	BinaryOp* op;
 
-	BinaryOpGen(Thread& th, BinaryOp* inOp, Arg a, Arg b)	: Gen(th, itemTypeV, mostFinite(a, b)), op(inOp), _a(a), _b(b) {}
+	BinaryOpGen(Thread& th, BinaryOp* inOp, Arg a, Arg b)	: Gen(th, itemTypeV, mostFinite(a, b)), op(inOp), _a(a), _b(b) { setReadAhead(a, b); }
 
 	virtual const char* TypeName() const override { return "BinaryOpGen"; }
 
@@ -90,7 +90,7 @@ struct BinaryOpLinkGen : public Gen
 	VIn _b;
 	BinaryOp* op;
 
-	BinaryOpLinkGen(Thread& th, BinaryOp* inOp, Arg a, Arg b)	: Gen(th, itemTypeV, mostFinite(a, b)), op(inOp), _a(a), _b(b) {}
+	BinaryOpLinkGen(Thread& th, BinaryOp* inOp, Arg a, Arg b)	: Gen(th, itemTypeV, mostFinite(a, b)), op(inOp), _a(a), _b(b) { setReadAhead(a, b); }
 
 	virtual const char* TypeName() const override { return "BinaryOpLinkGen"; }
 
@@ -152,6 +152,53 @@ struct BinaryOpZGen : public Gen
 	virtual void pull(Thread& th) override;
 };
 
+// Chains of element-wise math on signals are collapsed into a single generator when they are built.
+// The expression is held in postfix order and evaluated in short chunks, so intermediate results
+// stay in cache and only the final output is allocated.
+const int kMaxFusedOpNodes = 16;
+const int kMaxFusedOpInputs = 8;
+const int kFusedOpChunkSize = 64;
+
+struct FusedOpNode
+{
+	UnaryOp* unop;
+	BinaryOp* binop;
+	int input;
+};
+
+struct FusedOpProgram
+{
+	ZIn mInputs[kMaxFusedOpInputs];
+	FusedOpNode mNodes[kMaxFusedOpNodes];
+	int mNumInputs = 0;
+	int mNumNodes = 0;
+	bool mAbsorbed = false;
+
+	bool addInput(ZIn const& in);
+	bool addOp(UnaryOp* op);
+	bool addOp(BinaryOp* op);
+	bool addProgram(FusedOpProgram const& p);
+	bool addOperand(Thread& th, Arg a);
+
+	void eval(int n, Z** in, int* instride, Z* out);
+};
+
+struct FusedOpZGen : public Gen
+{
+	FusedOpProgram mProgram;
+
+	FusedOpZGen(Thread& th, FusedOpProgram const& program, bool finite)
+					: Gen(th, itemTypeZ, finite), mProgram(program) {}
+
+	virtual const char* TypeName() const override { return "FusedOpZGen"; }
+
+	virtual void pull(Thread& th) override;
+};
+
+// these build a fused generator when an operand can be absorbed, otherwise a UnaryOpZGen or BinaryOpZGen.
+V newUnaryOpZList(Thread& th, UnaryOp* op, Arg a);
+V newBinaryOpZList(Thread& th, BinaryOp* op, Arg a, Arg b);
+
 struct BinaryOpLinkZGen : public Gen
 {
 	ZIn _a;
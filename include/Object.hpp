@@ -24,6 +24,7 @@
 #include <string.h>
 #include <string>
 #include <vector>
+#include "Sample.hpp"
 #include "Hash.hpp"
 #include "ErrorCodes.hpp"
 #include "MathFuns.hpp"
@@ -34,6 +35,15 @@
 
 void post(const char* fmt, ...);
 
+// while a PostCapture is alive, post() on the same thread appends to its string instead of printing.
+class PostCapture
+{
+	std::string* mSaved;
+public:
+	PostCapture(std::string& out);
+	~PostCapture();
+};
+
 #define COLLECT_MINFO 1
 
 class VM;
@@ -60,12 +70,6 @@ typedef V const& Arg;
 #define LOOP(I,N) for (int I = 0;  i < (N); ++I)
 #define LOOP2(I,S,N) for (int I = S;  i < (N); ++I)
 
-#define SAMPLE_IS_DOUBLE 1
-#if SAMPLE_IS_DOUBLE 
-typedef double Z;
-#else
-typedef float Z;
-#endif
 
 const double NaN = NAN;
 
@@ -692,9 +696,10 @@ public:
 	const char* mHelp;
 	uint16_t mTakes;
 	uint16_t mLeaves;
+	bool mPure; // no side effects. may be called from several threads at once.
 
 	Prim(PrimFun _primFun, Arg _v, uint16_t takes, uint16_t leaves, const char* name, const char* help)
-		: Object(), prim(_primFun), v(_v), mName(name), mHelp(help), mTakes(takes), mLeaves(leaves) {}
+		: Object(), prim(_primFun), v(_v), mName(name), mHelp(help), mTakes(takes), mLeaves(leaves), mPure(false) {}
 
 	virtual const char* TypeName() const override { return "Prim"; }
 	virtual const char* OneLineHelp() const override { return mHelp; }
@@ -859,6 +864,7 @@ public:
 	size_t mMask;
 	size_t* mIndices;
 	V* mKeys;
+	int64_t mShapeId; // unique to this map and never reused. Forms sharing a map share a shape.
 	
 	TableMap(size_t inSize);
 	TableMap(Arg inKey); // one item table map
@@ -898,6 +904,8 @@ public:
 	P<Table> chaseTable(Thread& th, int64_t n);
 };
 
+class FormLookupCache;
+
 class Form : public Object
 {
 public:
@@ -926,6 +934,9 @@ public:
 	}
 	
 	virtual bool get(Thread& th, Arg key, V& value) const override;
+	bool get(Thread& th, Arg key, V& value, FormLookupCache& cache) const;
+	bool dot(Thread& th, Arg key, V& ioValue, FormLookupCache& cache);
+	using Object::dot;
 	
     void put(int64_t inIndex, Arg inValue);
 	
@@ -938,6 +949,44 @@ public:
 	virtual void print(Thread& th, std::string& out, int depth) override;
 };
 
+const int kFormLookupCacheDepth = 4;
+
+// An inline cache for a single key lookup site, such as a .key or ,key opcode.
+// It remembers the shapes of the forms walked the last time the key was found and the slot it was found in.
+// A hit compares shape ids along the inheritance chain instead of probing each table.
+// Readers never block. Concurrent updates are serialized by a sequence count and a losing writer simply skips its update.
+class FormLookupCache : public RCObj
+{
+	std::atomic<uint32_t> mSeq;
+	std::atomic<int32_t> mDepth;
+	std::atomic<int64_t> mIndex;
+	std::atomic<int64_t> mShapeIds[kFormLookupCacheDepth];
+public:
+	FormLookupCache() : mSeq(0), mDepth(-1), mIndex(0) {}
+
+	virtual const char* TypeName() const override { return "FormLookupCache"; }
+
+	bool lookup(const Form* form, V& outValue) const;
+	void update(const Form* form, int depth, size_t index);
+};
+
+// memoizes the most recent results of linearizeInheritance for a thread.
+struct InheritanceMemo
+{
+	static const int kNumEntries = 8;
+	static const int kMaxParents = 4;
+	struct Entry
+	{
+		size_t numParents = 0;
+		P<Form> parents[kMaxParents];
+		P<Form> result;
+	};
+	Entry entries[kNumEntries];
+	int next = 0;
+
+	bool find(size_t numArgs, V* args, P<Form>& outResult);
+	void add(size_t numArgs, V* args, P<Form> const& result);
+};
 
 enum {
 	itemTypeV,
@@ -977,6 +1026,9 @@ struct VIn : In
 struct ZIn : In
 {
 	bool mOnce = true;
+#if !SAMPLE_IS_DOUBLE
+	Z mConstantZ; // mConstant as a sample, so that it can be returned as a buffer.
+#endif
 
 	ZIn();
 	ZIn(Arg inValue);
@@ -986,7 +1038,9 @@ struct ZIn : In
     bool onez(Thread& th, Z& z);
     bool peek(Thread& th, Z& z);
 	bool fill(Thread& th, int& ioNum, Z* outBuffer, int outStride);
+#if SAMPLE_IS_DOUBLE
 	bool fill(Thread& th, int& ioNum, float* outBuffer, int outStride);
+#endif
 	bool mix(Thread& th, int& ioNum, Z* outBuffer);
 	bool bench(Thread& th, int& ioNum);
 	bool link(Thread& th, List* inList);
@@ -1016,8 +1070,10 @@ public:
 	friend class VIn;
 	friend class ZIn;
 	bool mDone;
+	bool mReadAhead; // elements may be computed before the consumer asks for them.
 	List* mOut;
 	int mBlockSize;
+	int mMaxBlockSize;
 
 	Gen(Thread& th, int inItemType, bool finite = false);
 	virtual ~Gen();
@@ -1033,8 +1089,19 @@ public:
 	void produce(int shrinkBy);
 
 	int blockSize() const { return mBlockSize; }
+
+	// V gens produce one item per pull unless they opt in to reading ahead.
+	// a read ahead gen doubles its block size on each pull, up to kMaxVBlockSize.
+	void setReadAhead();
+	void setReadAhead(Arg a);
+	void setReadAhead(Arg a, Arg b);
+	bool readsAhead() const { return mReadAhead; }
+	void grow() { if (mBlockSize < mMaxBlockSize) mBlockSize = std::min(2 * mBlockSize, mMaxBlockSize); }
 };
 
+// true if the items of a can be computed ahead of its consumer without changing what the program does.
+bool canReadAhead(Arg a);
+
 
 class Plug : public Object
 {
@@ -1085,6 +1152,10 @@ public:
 };
 
 
+// Z arrays of at least this many bytes are mapped onto an unlinked spill file instead of the heap,
+// so that the kernel can page them out to disk.
+const int64_t kMinMappedArrayBytes = 32 * 1024 * 1024;
+
 class Array : public Object
 {
 	int64_t mSize;
@@ -1094,15 +1165,22 @@ class Array : public Object
 		V* vv;
 		Z* zz;
 	};
+	size_t mMapBytes; // length of the mapping if p is mapped, else 0.
+	int mFd; // spill file backing the mapping, or -1.
+
+	void allocMapped();
 
 public:
 
-	Array(int inItemType, int64_t inCap) : mSize(0), mCap(0), p(0)
+	Array(int inItemType, int64_t inCap) : mSize(0), mCap(0), p(0), mMapBytes(0), mFd(-1)
 	{
 		elemType = inItemType;
 		alloc(std::max(int64_t(1), inCap));
 	}
 	
+	// maps a file of raw Z values. writes go to private copies of the pages, never to the file.
+	static P<Array> mapZFile(const char* path);
+
 	virtual ~Array();
 
 	virtual const char* TypeName() const override { return "Array"; }
@@ -1116,8 +1194,10 @@ public:
 	
 	size_t elemSize() { return isV() ? sizeof(V) : sizeof(Z); }
 	void alloc(int64_t inCap);
+	bool isMapped() const { return mMapBytes != 0; }
 
 	int64_t size() const { return mSize; }
+	int64_t capacity() const { return mCap; }
     void setSize(size_t inSize) { mSize = inSize; }
     void addSize(size_t inDelta) { mSize += inDelta; }
 	
@@ -1171,6 +1251,9 @@ public:
 
 #define ASSERT_PACKED  assert(isPacked());
 
+// starts the thread that frees long list chains dropped elsewhere. until then they are freed where they are dropped.
+void startListReclaimer();
+
 class List : public Object
 {
 	P<List> mNext;
@@ -1178,6 +1261,7 @@ public:
     LOCK_DECLARE(mSpinLock);
 	P<Gen> mGen;
 	P<Array> mArray;
+	P<Object> mSetIndex; // built by the set operations the first time the list is searched. dropped when the list is changed.
 
 	List(int inItemType);
 	List(int inItemType, int64_t inCap);
@@ -1235,11 +1319,13 @@ public:
 	virtual bool Equals(Thread& th, Arg v) override;
 
 	// these assume the list is packed
-	void put(int64_t index, Arg value) { ASSERT_PACKED mArray->put(index, value); }
-	void add(Arg value) { ASSERT_PACKED mArray->add(value); }
+	void put(int64_t index, Arg value) { ASSERT_PACKED changed(); mArray->put(index, value); }
+	void add(Arg value) { ASSERT_PACKED changed(); mArray->add(value); }
+	
+	void putz(int64_t index, Z value) { ASSERT_PACKED changed(); mArray->put(index, value); }
+	void addz(Z value) { ASSERT_PACKED changed(); mArray->addz(value); }
 	
-	void putz(int64_t index, Z value) { ASSERT_PACKED mArray->put(index, value); }
-	void addz(Z value) { ASSERT_PACKED mArray->addz(value); }
+	void changed() { if (mSetIndex) mSetIndex = nullptr; }
 
 	using Object::at;
 	V at(int64_t i) override     { ASSERT_PACKED return mArray->at(i); }
@@ -1319,6 +1405,7 @@ struct Opcode
 
 	int op;
 	V v;
+	P<FormLookupCache> cache; // only for opDot and opComma.
 };
 
 class Code : public Object
@@ -21,4 +21,8 @@ void recordWithPlayer(Thread& th, V& v, Arg filename);
 
 void stopPlaying();
 void stopPlayingIfDone();
+void postAudioStats();
+
+// the signals each playing channel is reading, one vector of channels per player.
+void collectPlayerInputs(std::vector<std::vector<V>>& outPlayers);
 
@@ -0,0 +1,29 @@
+//    SAPF - Sound As Pure Form
+//    Copyright (C) 2019 James McCartney
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef __Retention_h__
+#define __Retention_h__
+
+#include "VM.hpp"
+
+// Reports what each workspace binding and each playing channel keeps alive: the List nodes,
+// the bytes of their Arrays and the Gens still waiting to be pulled. A binding that holds the head
+// of a long signal shows up here with a list count that keeps growing as the signal is read.
+// The walk runs a bounded number of objects at a time and yields in between, and does not stop other threads.
+
+void postRetention(Thread& th);
+
+#endif
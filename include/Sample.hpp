@@ -0,0 +1,36 @@
+//    SAPF - Sound As Pure Form
+//    Copyright (C) 2019 James McCartney
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef __Sample_h__
+#define __Sample_h__
+
+// Z is the element type of signal lists.
+// Build with SAMPLE_IS_DOUBLE defined to 0 for single precision signals.
+
+#ifndef SAMPLE_IS_DOUBLE
+#define SAMPLE_IS_DOUBLE 1
+#endif
+
+#if SAMPLE_IS_DOUBLE 
+typedef double Z;
+#else
+#ifdef SAPF_ACCELERATE
+#error "single precision samples are not supported with SAPF_ACCELERATE"
+#endif
+typedef float Z;
+#endif
+
+#endif
@@ -0,0 +1,32 @@
+//    SAPF - Sound As Pure Form
+//    Copyright (C) 2019 James McCartney
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef __Server_h__
+#define __Server_h__
+
+#include "VM.hpp"
+
+// Server mode keeps one warmed up process running and evaluates requests sent over a Unix domain socket.
+// A request is source text ended by a zero byte, or by the client closing its side of the connection.
+// Each request is compiled and run on its own Thread copied from the parent, so requests don't see
+// each other's stack or bindings. The reply is "ok\n" or "error\n", then everything the request posted,
+// then the stack it left, ended by a zero byte. To render, end the source with a >sf call; the path of
+// the written file is in the posted output. A connection may send any number of requests, and
+// sending "quit" closes it.
+
+void runServer(Thread& parent, const char* socketPath);
+
+#endif
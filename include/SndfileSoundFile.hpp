@@ -9,17 +9,21 @@
 
 class SndfileSoundFile {
 public:
-	SndfileSoundFile(SNDFILE *inSndfile, int inNumChannels);
+	SndfileSoundFile(SNDFILE *inSndfile, int inNumChannels, double inSampleRate = 0.);
 	~SndfileSoundFile();
 
 	uint32_t numChannels();
+	double sampleRate();
 	int pull(uint32_t *framesRead, PortableBuffers& buffers);
+	int seek(double seconds);
 	
 	SNDFILE *mSndfile;
 	std::vector<double> mBufInterleaved;
 	int mNumChannels;
+	double mSampleRate;
 
-	static std::unique_ptr<SndfileSoundFile> open(const char *path);
+	// files are read at their own sample rate. SFReader converts to the thread's rate.
+	static std::unique_ptr<SndfileSoundFile> open(const char *path, double threadSampleRate);
 	static std::unique_ptr<SndfileSoundFile> create(const char *path, int numChannels, double threadSampleRate, double fileSampleRate, bool interleaved);
 };
 #endif // SAPF_AUDIOTOOLBOX
@@ -42,6 +42,6 @@ void makeRecordingPath(Arg filename, char* path, int len);
 
 std::unique_ptr<SoundFile> sfcreate(Thread& th, const char* path, int numChannels, double fileSampleRate, bool interleaved);
 void sfwrite(Thread& th, V& v, Arg filename, bool openIt);
-void sfread(Thread& th, Arg filename, int64_t offset, int64_t frames);
+void sfread(Thread& th, Arg filename, double offset, double duration);
 
 #endif /* defined(__taggeddoubles__SoundFiles__) */
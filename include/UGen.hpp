@@ -18,6 +18,20 @@
 #define __UGen_h__
 
 #include "Object.hpp"
+#include <type_traits>
+
+// ZIn only ever yields strides of 0 (a constant) or 1. the one to three input UGens pass each stride to calc
+// as one of these types, so a calc that takes its strides as template parameters is compiled once for each
+// combination, with loops that the compiler can specialize and vectorize. a calc taking int strides still works.
+typedef std::integral_constant<int, 0> Stride0;
+typedef std::integral_constant<int, 1> Stride1;
+
+template <typename Fn>
+inline void withStride(int stride, Fn&& fn)
+{
+	if (stride) fn(Stride1());
+	else fn(Stride0());
+}
 
 template <typename F>
 struct ZeroInputGen : public Gen
@@ -224,7 +238,9 @@ struct OneInputUGen : public Gen
 				setDone();
 				break;
 			} else {
-				static_cast<F*>(this)->F::calc(n, out, a, aStride);
+				withStride(aStride, [&](auto as) {
+					static_cast<F*>(this)->F::calc(n, out, a, as);
+				});
 				_a.advance(n);
 				framesToFill -= n;
 				out += n;
@@ -258,7 +274,9 @@ struct TwoInputUGen : public Gen
 				setDone();
 				break;
 			} else {
-				static_cast<F*>(this)->F::calc(n, out, a, b, aStride, bStride);
+				withStride(aStride, [&](auto as) { withStride(bStride, [&](auto bs) {
+					static_cast<F*>(this)->F::calc(n, out, a, b, as, bs);
+				}); });
 				_a.advance(n);
 				_b.advance(n);
 				framesToFill -= n;
@@ -294,7 +312,9 @@ struct ThreeInputUGen : public Gen
 				setDone();
 				break;
 			} else {
-				static_cast<F*>(this)->F::calc(n, out, a, b, c, aStride, bStride, cStride);
+				withStride(aStride, [&](auto as) { withStride(bStride, [&](auto bs) { withStride(cStride, [&](auto cs) {
+					static_cast<F*>(this)->F::calc(n, out, a, b, c, as, bs, cs);
+				}); }); });
 				_a.advance(n);
 				_b.advance(n);
 				_c.advance(n);
@@ -685,7 +705,9 @@ struct NOneInputUGen : public Gen
                     setDone();
                     break;
                 } else {
-                    static_cast<F*>(this)->F::calc(n, out, a, aStride);
+                    withStride(aStride, [&](auto as) {
+                        static_cast<F*>(this)->F::calc(n, out, a, as);
+                    });
                     _a.advance(n);
                     framesToFill -= n;
                     out += n;
@@ -725,7 +747,9 @@ struct NTwoInputUGen : public Gen
                     setDone();
                     break;
                 } else {
-                    static_cast<F*>(this)->F::calc(n, out, a, b, aStride, bStride);
+                    withStride(aStride, [&](auto as) { withStride(bStride, [&](auto bs) {
+                        static_cast<F*>(this)->F::calc(n, out, a, b, as, bs);
+                    }); });
                     _a.advance(n);
                     _b.advance(n);
                     framesToFill -= n;
@@ -767,7 +791,9 @@ struct NThreeInputUGen : public Gen
                     setDone();
                     break;
                 } else {
-                    static_cast<F*>(this)->F::calc(n, out, a, b, c, aStride, bStride, cStride);
+                    withStride(aStride, [&](auto as) { withStride(bStride, [&](auto bs) { withStride(cStride, [&](auto cs) {
+                        static_cast<F*>(this)->F::calc(n, out, a, b, c, as, bs, cs);
+                    }); }); });
                     _a.advance(n);
                     _b.advance(n);
                     _c.advance(n);
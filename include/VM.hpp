@@ -65,6 +65,7 @@ public:
 const double kDefaultSampleRate = 96000.;
 const int kDefaultControlBlockSize = 128;
 const int kDefaultVBlockSize = 1;
+const int kMaxVBlockSize = 256;
 const int kDefaultZBlockSize = 512;
 
 struct Rate
@@ -149,6 +150,11 @@ public:
 
 	RGen rgen;
 	
+	InheritanceMemo inheritanceMemo;
+	
+	// operands a math op prim popped and holds alone. only these may be inlined into a fused op.
+	Object* ownedOperands[2] = {};
+	
 	// parser
 	FILE* parserInputFile;
 	char token[kMaxTokenLen];
@@ -168,6 +174,11 @@ public:
 	int linelen;
 	int linepos;
 	const char* logfilename;	
+	FILE* logfile = nullptr; // kept open for the whole session.
+	FILE* pipedInput = nullptr; // set when the REPL input is not a terminal. editline is not used then.
+	char* pipedLine = nullptr;
+	size_t pipedLineSize = 0;
+	int linesSinceHistorySave = 0;
 	time_t previousTimeStamp;
 	
 	Thread();
@@ -347,6 +358,7 @@ public:
 	V maxFun;
 	
 	bool traceon = false;
+	bool defPure = false; // primitives defined while this is set are marked as pure.
 
 #if COLLECT_MINFO
 	std::atomic<int64_t> totalRetains;
@@ -553,7 +565,7 @@ public:
 
 
 uint64_t timeseed();
-void loadFile(Thread& th, const char* filename);
+void loadFile(Thread& th, const char* filename, const char* imagePath = nullptr);
 
 
 class UseRate
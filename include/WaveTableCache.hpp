@@ -0,0 +1,35 @@
+//    SAPF - Sound As Pure Form
+//    Copyright (C) 2019 James McCartney
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef __WaveTableCache_h__
+#define __WaveTableCache_h__
+
+#include "Sample.hpp"
+#include <stddef.h>
+#include <stdint.h>
+
+// Computed wave tables are kept in files named by a hash of the spectrum they were computed from,
+// so a table is only ever computed once per machine.
+// The directory is $SAPF_WAVETABLE_CACHE, or ~/sapf-wavetables. Setting SAPF_WAVETABLE_CACHE to an empty string disables the cache.
+// If SAPF_WAVETABLE_FLOAT is set, tables are stored as 32 bit floats, which halves the size of the files.
+// Either format can be read by either build.
+
+int64_t hashWaveTableSpec(int n, const Z* amps, int ampStride, const Z* phases, int phaseStride, Z smooth, int tableSize, int numTables);
+
+bool readWaveTableCache(int64_t key, Z* tables, size_t numSamples);
+bool writeWaveTableCache(int64_t key, const Z* tables, size_t numSamples);
+
+#endif
@@ -17,10 +17,18 @@
 #ifndef __taggeddoubles__dsp__
 #define __taggeddoubles__dsp__
 
+#include "Sample.hpp"
+
 #ifdef SAPF_ACCELERATE
 #include <Accelerate/Accelerate.h>
 #else
 #include <fftw3.h>
+// the fftw interface matching the sample type.
+#if SAMPLE_IS_DOUBLE
+#define SAPF_FFTW(name) fftw_##name
+#else
+#define SAPF_FFTW(name) fftwf_##name
+#endif
 #endif // SAPF_ACCELERATE
 
 const int kMinFFTLogSize = 2;
@@ -30,12 +38,12 @@ class FFT {
 public:
     ~FFT();
     void init(size_t log2n);
-    void forward(double *inReal, double *inImag, double *outReal, double *outImag);
-    void backward(double *inReal, double *inImag, double *outReal, double *outImag);
-    void forward_in_place(double *ioReal, double *ioImag);
-    void backward_in_place(double *ioReal, double *ioImag);
-    void forward_real(double *inReal, double *outReal, double *outImag);
-    void backward_real(double *inReal, double *inImag, double *outReal);
+    void forward(Z *inReal, Z *inImag, Z *outReal, Z *outImag);
+    void backward(Z *inReal, Z *inImag, Z *outReal, Z *outImag);
+    void forward_in_place(Z *ioReal, Z *ioImag);
+    void backward_in_place(Z *ioReal, Z *ioImag);
+    void forward_real(Z *inReal, Z *outReal, Z *outImag);
+    void backward_real(Z *inReal, Z *inImag, Z *outReal);
 
     size_t n;
     size_t log2n;
@@ -43,28 +51,28 @@ private:
 #ifdef SAPF_ACCELERATE
     FFTSetupD setup;
 #else
-    fftw_complex *in;
-    fftw_complex *out;
-    double *in_out_real;
-    fftw_plan forward_out_of_place_plan;
-    fftw_plan backward_out_of_place_plan;
-    fftw_plan forward_in_place_plan;
-    fftw_plan backward_in_place_plan;
-    fftw_plan forward_real_plan;
-    fftw_plan backward_real_plan;
+    SAPF_FFTW(complex) *in;
+    SAPF_FFTW(complex) *out;
+    Z *in_out_real;
+    SAPF_FFTW(plan) forward_out_of_place_plan;
+    SAPF_FFTW(plan) backward_out_of_place_plan;
+    SAPF_FFTW(plan) forward_in_place_plan;
+    SAPF_FFTW(plan) backward_in_place_plan;
+    SAPF_FFTW(plan) forward_real_plan;
+    SAPF_FFTW(plan) backward_real_plan;
 #endif // SAPF_ACCELERATE    
 };
 
 extern FFT ffts[kMaxFFTLogSize+1];
 
 void initFFT();
-void fft (int n, double* ioReal, double* ioImag);
-void ifft(int n, double* ioReal, double* ioImag);
+void fft (int n, Z* ioReal, Z* ioImag);
+void ifft(int n, Z* ioReal, Z* ioImag);
 
-void fft (int n, double* inReal, double* inImag, double* outReal, double* outImag);
-void ifft(int n, double* inReal, double* inImag, double* outReal, double* outImag);
+void fft (int n, Z* inReal, Z* inImag, Z* outReal, Z* outImag);
+void ifft(int n, Z* inReal, Z* inImag, Z* outReal, Z* outImag);
 
-void rfft(int n, double* inReal, double* outReal, double* outImag);
-void rifft(int n, double* inReal, double* inImag, double* outReal);
+void rfft(int n, Z* inReal, Z* outReal, Z* outImag);
+void rifft(int n, Z* inReal, Z* inImag, Z* outReal);
 
 #endif /* defined(__taggeddoubles__dsp__) */
@@ -21,6 +21,22 @@ public:
     }
 };
 
+// takes the lock only if it is free.
+class TrySpinLocker
+{
+    Lock& lock;
+    bool owned;
+public:
+    TrySpinLocker(Lock& inLock) : lock(inLock), owned(os_unfair_lock_trylock(&inLock))
+    {
+    }
+    ~TrySpinLocker()
+    {
+        if (owned) os_unfair_lock_unlock(&lock);
+    }
+    bool owns() const { return owned; }
+};
+
 #else
 #include <mutex>
 #include <shared_mutex>
@@ -40,4 +56,14 @@ public:
     {}
 };
 
+// takes the lock only if it is free.
+class TrySpinLocker
+{
+    std::unique_lock<Lock> w_lock;
+public:
+    TrySpinLocker(Lock& inLock) : w_lock(inLock, std::try_to_lock)
+    {}
+    bool owns() const { return w_lock.owns_lock(); }
+};
+
 #endif // SAPF_APPLE_LOCK
@@ -23,6 +23,26 @@ extern const  int gPrimesShift[30];
 const int kPrimesMaskSize = 33334;
 extern uint8_t gPrimesMask[];
 
+const int kMaxPrimeSegments = 65536; // the sieve extends to about 6.5e10.
+
+// returns segment k of the sieve, building it and any before it if needed. null past kMaxPrimeSegments.
+// byte i of segment k holds the primes from 30 * (k * kPrimesMaskSize + i + 1) up.
+const uint8_t* primesSegment(int64_t k);
+
 bool isprime(int64_t n);
 
 int64_t nextPrime(int64_t x);
+
+// the nth prime, counting from zero.
+int64_t nthPrime(int64_t n);
+
+// steps through the primes in order. next returns 0 past the end of the sieve.
+class PrimeCursor
+{
+	int64_t mByte = -1;
+	int mBit = 0;
+	int64_t mSegmentIndex = -1;
+	const uint8_t* mSegment = nullptr;
+public:
+	int64_t next();
+};
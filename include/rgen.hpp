@@ -76,13 +76,10 @@ inline double itof2(uint32_t i, double a)
 	return (double)i * a * kScaleR31 - a;
 }
 
-struct RGen
+// the distributions shared by the generators below. G supplies trand().
+template <class G>
+struct RandomDist
 {
-	uint64_t s[2];
-	
-	void init(int64_t seed);
-	int64_t trand();
-	    
 	double drand(); // 0 .. 1
 	double drand2(); // -1 .. 1
 	double drand8(); // -1/8 .. 1/8
@@ -99,7 +96,42 @@ struct RGen
 	int64_t irand2(int64_t scale);
 	int64_t ilinrand(int64_t lo, int64_t hi);
 	int64_t itrirand(int64_t lo, int64_t hi);
+
+private:
+	int64_t next() { return static_cast<G*>(this)->trand(); }
+};
+
+struct RGen : RandomDist<RGen>
+{
+	uint64_t s[2];
 	
+	void init(int64_t seed);
+	int64_t trand();
+};
+
+inline uint64_t splitmix64(uint64_t z)
+{
+	z = (z ^ (z >> 30)) * UINT64_C(0xBF58476D1CE4E5B9);
+	z = (z ^ (z >> 27)) * UINT64_C(0x94D049BB133111EB);
+	return z ^ (z >> 31);
+}
+
+// counter based generator. value n of a stream is a function of only the stream's key and n,
+// so it does not matter in which order or on which thread streams are pulled,
+// and a block can be computed without a serial dependency from one value to the next.
+struct CRGen : RandomDist<CRGen>
+{
+	uint64_t base;
+	uint64_t gamma; // odd, so that streams with different keys are not offsets of one another.
+	uint64_t count;
+	
+	void init(int64_t key);
+	int64_t trand() { return (int64_t)at(count++); }
+	uint64_t at(uint64_t n) const { return splitmix64(base + n * gamma); }
+	uint64_t position() const { return count; }
+	void seek(uint64_t n) { count = n; }
+	
+	template <class T> void drands(int n, T* out); // n values 0 .. 1
 };
 
 
@@ -114,81 +146,112 @@ inline int64_t RGen::trand()
 	return (int64_t)xoroshiro128(s);
 }
 
-inline double RGen::drand()
+inline void CRGen::init(int64_t key)
+{
+	base = Hash64(key + 0x43a68b0d0492ba51LL);
+	gamma = Hash64(key + 0x56e376c6e7c29504LL) | 1;
+	count = 0;
+}
+
+template <class T>
+inline void CRGen::drands(int n, T* out)
+{
+	uint64_t c = count;
+	for (int i = 0; i < n; ++i) {
+		out[i] = (T)itof1(at(c + i));
+	}
+	count = c + n;
+}
+
+template <class G>
+inline double RandomDist<G>::drand()
 {
 	union { uint64_t i; double f; } u;
-	u.i = 0x3FF0000000000000LL | ((uint64_t)trand() >> 12);
+	u.i = 0x3FF0000000000000LL | ((uint64_t)next() >> 12);
 	return u.f - 1.;
 }
 
-inline double RGen::drand2()
+template <class G>
+inline double RandomDist<G>::drand2()
 {
 	union { uint64_t i; double f; } u;
-	u.i = 0x4000000000000000LL | ((uint64_t)trand() >> 12);
+	u.i = 0x4000000000000000LL | ((uint64_t)next() >> 12);
 	return u.f - 3.;
 }
 
-inline double RGen::drand8()
+template <class G>
+inline double RandomDist<G>::drand8()
 {
 	union { uint64_t i; double f; } u;
-	u.i = 0x3FD0000000000000LL | ((uint64_t)trand() >> 12);
+	u.i = 0x3FD0000000000000LL | ((uint64_t)next() >> 12);
 	return u.f - .375;
 }
 
-inline double RGen::drand16()
+template <class G>
+inline double RandomDist<G>::drand16()
 {
 	union { uint64_t i; double f; } u;
-	u.i = 0x3FC0000000000000LL | ((uint64_t)trand() >> 12);
+	u.i = 0x3FC0000000000000LL | ((uint64_t)next() >> 12);
 	return u.f - .1875;
 }
 
-inline double RGen::rand(double lo, double hi)
+template <class G>
+inline double RandomDist<G>::rand(double lo, double hi)
 {
 	return lo + (hi - lo) * drand();
 }
 
-inline double RGen::xrand(double lo, double hi)
+template <class G>
+inline double RandomDist<G>::xrand(double lo, double hi)
 {
 	return lo * pow(hi / lo,  drand());
 }
 
-inline double RGen::linrand(double lo, double hi)
+template <class G>
+inline double RandomDist<G>::linrand(double lo, double hi)
 {
 	return lo + (hi - lo) * std::min(drand(), drand());
 }
 
-inline double RGen::trirand(double lo, double hi)
+template <class G>
+inline double RandomDist<G>::trirand(double lo, double hi)
 {
 	return lo + (hi - lo) * (.5 + .5 * (drand() - drand()));
 }
 
-inline double RGen::coin(double p)
+template <class G>
+inline double RandomDist<G>::coin(double p)
 {
 	return drand() < p ? 1. : 0.;
 }
 
-inline int64_t RGen::irand0(int64_t n)
+template <class G>
+inline int64_t RandomDist<G>::irand0(int64_t n)
 {
 	return (int64_t)floor(n * drand());
 }
 
-inline int64_t RGen::irand(int64_t lo, int64_t hi)
+template <class G>
+inline int64_t RandomDist<G>::irand(int64_t lo, int64_t hi)
 {
 	return lo + (int64_t)floor((hi - lo + 1) * drand());
 }
 
-inline int64_t RGen::irand2(int64_t scale)
+template <class G>
+inline int64_t RandomDist<G>::irand2(int64_t scale)
 {
 	double fscale = (double)scale;
 	return (int64_t)floor((2. * fscale + 1.) * drand() - fscale);
 }
 
-inline int64_t RGen::ilinrand(int64_t lo, int64_t hi)
+template <class G>
+inline int64_t RandomDist<G>::ilinrand(int64_t lo, int64_t hi)
 {
 	return lo + (int64_t)floor((hi - lo) * std::min(drand(), drand()));
 }
 
-inline int64_t RGen::itrirand(int64_t lo, int64_t hi)
+template <class G>
+inline int64_t RandomDist<G>::itrirand(int64_t lo, int64_t hi)
 {
 	double scale = (double)(hi - lo);
 	return lo + (int64_t)floor(scale * (.5 + .5 * (drand() - drand())));
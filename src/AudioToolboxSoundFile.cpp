@@ -13,11 +13,20 @@ uint32_t AudioToolboxSoundFile::numChannels() {
 	return this->mNumChannels;
 }
 
+double AudioToolboxSoundFile::sampleRate() {
+	return this->mSampleRate;
+}
+
+int AudioToolboxSoundFile::seek(double seconds) {
+	// ExtAudioFileSeek takes a position in the file's frames, not the client's.
+	return ExtAudioFileSeek(this->mXAF, (SInt64)floor(seconds * this->mFileSampleRate + .5));
+}
+
 int AudioToolboxSoundFile::pull(uint32_t *framesRead, AudioBuffers& buffers) {
 	return ExtAudioFileRead(this->mXAF, framesRead, buffers.abl);
 }
 
-AudioToolboxSoundFile *AudioToolboxSoundFile::open(const char *path) {
+std::unique_ptr<AudioToolboxSoundFile> AudioToolboxSoundFile::open(const char *path, double threadSampleRate) {
 	CFStringRef cfpath = CFStringCreateWithFileSystemRepresentation(0, path);
 	if (!cfpath) {
 		post("failed to create path\n");
@@ -51,14 +60,14 @@ AudioToolboxSoundFile *AudioToolboxSoundFile::open(const char *path) {
 	int numChannels = fileFormat.mChannelsPerFrame;
 
 	AudioStreamBasicDescription clientFormat = {
-		th.rate.sampleRate,
+		threadSampleRate,
 		kAudioFormatLinearPCM,
 		kAudioFormatFlagsNativeFloatPacked | kAudioFormatFlagIsNonInterleaved,
-		static_cast<UInt32>(sizeof(double)),
+		static_cast<UInt32>(sizeof(Z)),
 		1,
-		static_cast<UInt32>(sizeof(double)),
+		static_cast<UInt32>(sizeof(Z)),
 		static_cast<UInt32>(numChannels),
-		64,
+		static_cast<UInt32>(8 * sizeof(Z)),
 		0
 	};
 	
@@ -69,14 +78,10 @@ AudioToolboxSoundFile *AudioToolboxSoundFile::open(const char *path) {
 		return {};
 	}
 	
-	err = ExtAudioFileSeek(xaf, offset);
-	if (err) {
-		post("seek failed %d\n", (int)err);
-		ExtAudioFileDispose(xaf);
-		return {};
-	}
-
-	return std::make_unique<AudioToolboxSoundFile>(xaf, numChannels);
+	std::unique_ptr<AudioToolboxSoundFile> soundFile = std::make_unique<AudioToolboxSoundFile>(xaf, numChannels);
+	soundFile->mSampleRate = threadSampleRate;
+	soundFile->mFileSampleRate = fileFormat.mSampleRate;
+	return soundFile;
 }
 
 AudioToolboxSoundFile *AudioToolboxSoundFile::create(const char *path, int numChannels, double threadSampleRate, double fileSampleRate, bool interleaved) {
@@ -0,0 +1,398 @@
+//    SAPF - Sound As Pure Form
+//    Copyright (C) 2019 James McCartney
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "CodeImage.hpp"
+#include "Opcode.hpp"
+#include <unordered_map>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+const char kImageMagic[8] = { 'S', 'A', 'P', 'F', 'I', 'M', 'G', 0 };
+const uint32_t kImageVersion = 1;
+
+struct ImageHeader
+{
+	char magic[8];
+	uint32_t version;
+	uint32_t valueSize; // guards against images from a build with a different V layout.
+	int64_t sourceHash;
+	int64_t builtinsHash;
+	uint64_t payloadSize;
+};
+
+enum {
+	imageTagReal,
+	imageTagSymbol,
+	imageTagString,
+	imageTagBuiltIn,
+	imageTagNilV,
+	imageTagNilZ,
+	imageTagTableMap,
+	imageTagCode,
+	imageTagFunDef,
+	imageTagNullString
+};
+
+int64_t hashSourceText(const char* text, size_t len)
+{
+	int64_t hash = Hash64((int64_t)len);
+	size_t i = 0;
+	for (; i + 8 <= len; i += 8) {
+		int64_t word;
+		memcpy(&word, text + i, 8);
+		hash = Hash64(hash + word);
+	}
+	for (; i < len; ++i) {
+		hash = Hash64(hash + (uint8_t)text[i]);
+	}
+	return hash;
+}
+
+// built ins are registered in a fixed order at startup, so the serial order of the table is stable.
+static int64_t hashBuiltins()
+{
+	int64_t hash = 0;
+	for (P<TreeNode> const& node : vm.builtins->sorted()) {
+		if (!node->mKey.isString()) continue;
+		String* name = (String*)node->mKey.o();
+		hash = Hash64(hash + name->hash);
+	}
+	return hash;
+}
+
+class ImageWriter
+{
+	std::vector<uint8_t> mBuf;
+	std::unordered_map<const Object*, String*> mBuiltinNames;
+
+public:
+	ImageWriter()
+	{
+		for (P<TreeNode> const& node : vm.builtins->sorted()) {
+			if (node->mValue.isObject() && node->mKey.isString())
+				mBuiltinNames[node->mValue.o()] = (String*)node->mKey.o();
+		}
+	}
+
+	std::vector<uint8_t> const& bytes() const { return mBuf; }
+
+	template <typename T>
+	void put(T x)
+	{
+		const uint8_t* p = (const uint8_t*)&x;
+		mBuf.insert(mBuf.end(), p, p + sizeof(T));
+	}
+
+	void putChars(const char* s)
+	{
+		uint32_t len = (uint32_t)strlen(s);
+		put(len);
+		mBuf.insert(mBuf.end(), (const uint8_t*)s, (const uint8_t*)s + len);
+	}
+
+	bool putString(String* s)
+	{
+		if (!s) {
+			put<uint8_t>(imageTagNullString);
+			return true;
+		}
+		put<uint8_t>(getsym(s->s)() == s ? imageTagSymbol : imageTagString);
+		putChars(s->s);
+		return true;
+	}
+
+	bool putValue(Arg v)
+	{
+		if (v.isReal()) {
+			put<uint8_t>(imageTagReal);
+			put(v.i); // locals and each masks are stored in the integer view of the same bits.
+			return true;
+		}
+		Object* o = v.o();
+		auto it = mBuiltinNames.find(o);
+		if (it != mBuiltinNames.end()) {
+			put<uint8_t>(imageTagBuiltIn);
+			putChars(it->second->s);
+			return true;
+		}
+		if (o == vm._nilv()) { put<uint8_t>(imageTagNilV); return true; }
+		if (o == vm._nilz()) { put<uint8_t>(imageTagNilZ); return true; }
+		if (o->isString()) return putString((String*)o);
+		if (o->isTableMap()) return putTableMap((TableMap*)o);
+
+		const char* typeName = o->TypeName();
+		if (strcmp(typeName, "Code") == 0) return putCode((Code*)o);
+		if (strcmp(typeName, "FunDef") == 0) return putFunDef((FunDef*)o);
+
+		post("code image: can't store a %s\n", typeName);
+		return false;
+	}
+
+	bool putTableMap(TableMap* tmap)
+	{
+		put<uint8_t>(imageTagTableMap);
+		put<uint64_t>(tmap->mSize);
+		for (size_t i = 0; i < tmap->mSize; ++i) {
+			if (!putValue(tmap->mKeys[i])) return false;
+		}
+		return true;
+	}
+
+	bool putCode(Code* code)
+	{
+		put<uint8_t>(imageTagCode);
+		put<uint64_t>(code->keys.size());
+		for (Arg key : code->keys) {
+			if (!putValue(key)) return false;
+		}
+		put<uint64_t>(code->ops.size());
+		for (Opcode const& opc : code->ops) {
+			put<int32_t>(opc.op);
+			if (!putValue(opc.v)) return false;
+		}
+		return true;
+	}
+
+	bool putFunDef(FunDef* def)
+	{
+		put<uint8_t>(imageTagFunDef);
+		put(def->mNumArgs);
+		put(def->mNumLocals);
+		put(def->mNumVars);
+		put<uint64_t>(def->mArgNames.size());
+		for (P<String> const& name : def->mArgNames) {
+			if (!putString(name())) return false;
+		}
+		if (!putString(def->mHelp())) return false;
+		return putCode(def->mCode());
+	}
+};
+
+class ImageReader
+{
+	Thread& th;
+	const uint8_t* mPos;
+	const uint8_t* mEnd;
+
+public:
+	ImageReader(Thread& inThread, const uint8_t* inData, size_t inSize)
+		: th(inThread), mPos(inData), mEnd(inData + inSize) {}
+
+	bool atEnd() const { return mPos == mEnd; }
+
+	template <typename T>
+	bool get(T& x)
+	{
+		if (mEnd - mPos < (ptrdiff_t)sizeof(T)) return false;
+		memcpy(&x, mPos, sizeof(T));
+		mPos += sizeof(T);
+		return true;
+	}
+
+	bool getChars(std::string& s)
+	{
+		uint32_t len;
+		if (!get(len) || mEnd - mPos < (ptrdiff_t)len) return false;
+		s.assign((const char*)mPos, len);
+		mPos += len;
+		return true;
+	}
+
+	bool getString(P<String>& outString)
+	{
+		uint8_t tag;
+		if (!get(tag)) return false;
+		if (tag == imageTagNullString) {
+			outString = nullptr;
+			return true;
+		}
+		std::string s;
+		if (!getChars(s)) return false;
+		if (tag == imageTagSymbol) outString = getsym(s.c_str());
+		else if (tag == imageTagString) outString = new String(s.c_str());
+		else return false;
+		return true;
+	}
+
+	bool getValue(V& outValue)
+	{
+		uint8_t tag;
+		if (!get(tag)) return false;
+		switch (tag) {
+			case imageTagReal : {
+				outValue = V(0.);
+				return get(outValue.i);
+			}
+			case imageTagSymbol :
+			case imageTagString : {
+				std::string s;
+				if (!getChars(s)) return false;
+				if (tag == imageTagSymbol) outValue = getsym(s.c_str());
+				else outValue = new String(s.c_str());
+				return true;
+			}
+			case imageTagBuiltIn : {
+				std::string s;
+				if (!getChars(s)) return false;
+				return vm.builtins->get(th, getsym(s.c_str()), outValue);
+			}
+			case imageTagNilV : outValue = vm._nilv; return true;
+			case imageTagNilZ : outValue = vm._nilz; return true;
+			case imageTagTableMap : {
+				P<TableMap> tmap;
+				if (!getTableMap(tmap)) return false;
+				outValue = tmap;
+				return true;
+			}
+			case imageTagCode : {
+				P<Code> code;
+				if (!getCode(code)) return false;
+				outValue = code;
+				return true;
+			}
+			case imageTagFunDef : {
+				P<FunDef> def;
+				if (!getFunDef(def)) return false;
+				outValue = def;
+				return true;
+			}
+			default :
+				return false;
+		}
+	}
+
+	bool getTableMap(P<TableMap>& outMap)
+	{
+		uint64_t size;
+		if (!get(size) || size > (uint64_t)(mEnd - mPos)) return false;
+		P<TableMap> tmap = new TableMap(size);
+		for (size_t i = 0; i < size; ++i) {
+			V key;
+			if (!getValue(key)) return false;
+			tmap->put(i, key, key.Hash());
+		}
+		outMap = tmap;
+		return true;
+	}
+
+	bool getCode(P<Code>& outCode)
+	{
+		uint64_t numKeys, numOps;
+		if (!get(numKeys) || numKeys > (uint64_t)(mEnd - mPos)) return false;
+		std::vector<V> keys(numKeys);
+		for (V& key : keys) {
+			if (!getValue(key)) return false;
+		}
+		if (!get(numOps) || numOps > (uint64_t)(mEnd - mPos)) return false;
+		P<Code> code = new Code(numOps);
+		code->keys = std::move(keys);
+		for (uint64_t i = 0; i < numOps; ++i) {
+			int32_t op;
+			V v;
+			if (!get(op) || op <= BAD_OPCODE || op >= kNumOpcodes) return false;
+			if (!getValue(v)) return false;
+			code->add(op, v);
+		}
+		outCode = code;
+		return true;
+	}
+
+	bool getFunDef(P<FunDef>& outDef)
+	{
+		uint16_t numArgs, numLocals, numVars;
+		uint64_t numArgNames;
+		if (!get(numArgs) || !get(numLocals) || !get(numVars)) return false;
+		if (!get(numArgNames) || numArgNames > (uint64_t)(mEnd - mPos)) return false;
+		std::vector<P<String>> argNames(numArgNames);
+		for (P<String>& name : argNames) {
+			if (!getString(name)) return false;
+		}
+		P<String> help;
+		if (!getString(help)) return false;
+		uint8_t tag;
+		if (!get(tag) || tag != imageTagCode) return false;
+		P<Code> code;
+		if (!getCode(code)) return false;
+
+		outDef = new FunDef(th, code, numArgs, numLocals, numVars, help);
+		outDef->mArgNames = std::move(argNames);
+		return true;
+	}
+};
+
+bool writeCodeImage(Thread& th, const char* imagePath, int64_t sourceHash, P<FunDef> const& def)
+{
+	ImageWriter writer;
+	if (!writer.putFunDef(def())) return false;
+
+	ImageHeader header;
+	memcpy(header.magic, kImageMagic, sizeof(kImageMagic));
+	header.version = kImageVersion;
+	header.valueSize = sizeof(V);
+	header.sourceHash = sourceHash;
+	header.builtinsHash = hashBuiltins();
+	header.payloadSize = writer.bytes().size();
+
+	// write to a temporary file and rename, so that a concurrent reader never sees a partial image.
+	std::string tmpPath = imagePath;
+	tmpPath += ".tmp";
+	FILE* f = fopen(tmpPath.c_str(), "wb");
+	if (!f) return false;
+	bool ok = fwrite(&header, sizeof(header), 1, f) == 1
+		&& fwrite(writer.bytes().data(), 1, writer.bytes().size(), f) == writer.bytes().size();
+	ok = fclose(f) == 0 && ok;
+	if (!ok || rename(tmpPath.c_str(), imagePath) != 0) {
+		unlink(tmpPath.c_str());
+		return false;
+	}
+	return true;
+}
+
+bool readCodeImage(Thread& th, const char* imagePath, int64_t sourceHash, P<FunDef>& outDef)
+{
+	int fd = open(imagePath, O_RDONLY);
+	if (fd < 0) return false;
+
+	struct stat st;
+	if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(ImageHeader)) {
+		close(fd);
+		return false;
+	}
+	size_t size = st.st_size;
+	void* data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (data == MAP_FAILED) return false;
+
+	bool ok = false;
+	ImageHeader header;
+	memcpy(&header, data, sizeof(header));
+	if (memcmp(header.magic, kImageMagic, sizeof(kImageMagic)) == 0
+		&& header.version == kImageVersion
+		&& header.valueSize == sizeof(V)
+		&& header.sourceHash == sourceHash
+		&& header.builtinsHash == hashBuiltins()
+		&& header.payloadSize == size - sizeof(header))
+	{
+		ImageReader reader(th, (const uint8_t*)data + sizeof(header), header.payloadSize);
+		uint8_t tag;
+		ok = reader.get(tag) && tag == imageTagFunDef && reader.getFunDef(outDef) && reader.atEnd();
+	}
+
+	munmap(data, size);
+	return ok;
+}
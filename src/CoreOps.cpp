@@ -16,6 +16,7 @@
 
 #include "VM.hpp"
 #include "Parser.hpp"
+#include "Retention.hpp"
 #include "clz.hpp"
 #include <string>
 #include <unistd.h>
@@ -262,6 +263,8 @@ static P<Form> Envir_fromVec(int64_t size, Table** a)
 }
 
 
+static P<Form> linearizeInheritanceUncached(Thread& th, size_t numArgs, V* args);
+
 P<Form> linearizeInheritance(Thread& th, size_t numArgs, V* args)
 {
 	if (numArgs == 0) return vm._ee;
@@ -273,6 +276,20 @@ P<Form> linearizeInheritance(Thread& th, size_t numArgs, V* args)
 		}
 	}
 	
+	for (size_t i = 0; i < numArgs; ++i) {
+		if (!args[i].isForm()) return linearizeInheritanceUncached(th, numArgs, args);
+	}
+	
+	P<Form> result;
+	if (!th.inheritanceMemo.find(numArgs, args, result)) {
+		result = linearizeInheritanceUncached(th, numArgs, args);
+		th.inheritanceMemo.add(numArgs, args, result);
+	}
+	return result;
+}
+
+static P<Form> linearizeInheritanceUncached(Thread& th, size_t numArgs, V* args)
+{
 	const size_t maxSize = 1024;
 	Table* t[3][maxSize];
 	
@@ -1029,6 +1046,11 @@ static void minfo_(Thread& th, Prim* prim)
 }
 #endif
 
+static void retained_(Thread& th, Prim* prim)
+{
+	postRetention(th);
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 #pragma mark SAMPLE RATES
@@ -1449,6 +1471,7 @@ void AddCoreOps()
 #if COLLECT_MINFO
 	DEFnoeach(minfo, 0, 0, "(-->) print memory management info.")
 #endif
+	DEFnoeach(retained, 0, 0, "(-->) print the list nodes, array bytes and gens kept alive by each workspace binding, stack item and playing channel.")
 	DEFnoeach(listdump, 1, 0, "(list -->) prints information about a list.");
 
 	vm.addBifHelp("\n*** string ops ***");
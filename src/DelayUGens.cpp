@@ -25,8 +25,57 @@
 #include <stdint.h>
 #include <vector>
 #include <algorithm>
+#include <string.h>
 
 
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// delays whose delay time is constant over a block run in chunks no longer than the delay, so that nothing read
+// in a chunk was written in it. a chunk reads the ring buffer with at most two memcpys, runs the interpolation and
+// feedback over plain arrays, which vectorize, and writes back with at most two memcpys.
+// the ring buffers have kDelayHeadroom extra frames so that a chunk's writes never wrap onto its reads.
+const int kDelayChunk = 128;
+const int kDelayHeadroom = kDelayChunk + 4;
+
+static void ringRead(Z const* buf, int32_t bufMask, int32_t pos, int n, Z* out)
+{
+	int32_t start = pos & bufMask;
+	int first = std::min(n, bufMask + 1 - start);
+	memcpy(out, buf + start, first * sizeof(Z));
+	memcpy(out + first, buf, (n - first) * sizeof(Z));
+}
+
+static void ringWrite(Z* buf, int32_t bufMask, int32_t pos, int n, Z const* in)
+{
+	int32_t start = pos & bufMask;
+	int first = std::min(n, bufMask + 1 - start);
+	memcpy(buf + start, in, first * sizeof(Z));
+	memcpy(buf, in + first, (n - first) * sizeof(Z));
+}
+
+// back and ahead are how many frames older and newer than the delayed one the interpolation needs.
+// kernel(m, taps, in, out, w) gets taps[0] as the delayed frame for output 0, and fills m outputs and the m frames to store in w.
+template <typename Kernel>
+static void constantDelay(Z* buf, int32_t bufMask, int32_t& bufPos, int32_t offset, int back, int ahead,
+	int n, Z* in, int inStride, Z* out, Kernel kernel)
+{
+	Z taps[kDelayChunk + 4];
+	Z held[kDelayChunk];
+	Z w[kDelayChunk];
+	int maxChunk = std::min(kDelayChunk, (int)offset - ahead);
+	if (!inStride) std::fill(held, held + std::min(n, maxChunk), *in);
+	while (n) {
+		int m = std::min(n, maxChunk);
+		ringRead(buf, bufMask, bufPos - offset - back, m + back + ahead, taps);
+		kernel(m, taps + back, inStride ? in : held, out, w);
+		ringWrite(buf, bufMask, bufPos, m, w);
+		bufPos = (bufPos + m) & bufMask;
+		in += m * inStride;
+		out += m;
+		n -= m;
+	}
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 
@@ -45,7 +94,7 @@ public:
 	DelayN(Thread& th, Arg in, Arg delay, Z maxdelay) : Gen(th, itemTypeZ, false), in_(in), delay_(delay), maxdelay_(maxdelay)
 	{
 		sr = th.rate.sampleRate;
-		bufSize = NEXTPOWEROFTWO((int32_t)ceil(sr * maxdelay));
+		bufSize = NEXTPOWEROFTWO((int32_t)ceil(sr * maxdelay) + kDelayHeadroom);
 		bufMask = bufSize - 1;
 		bufPos = 0;
 		buf = (Z*)calloc(bufSize, sizeof(Z));
@@ -66,6 +115,18 @@ public:
 			if (in_(th, n, inStride, in) || delay_(th, n, delayStride, delay)) {
 				setDone();
 				break;
+			} else if (delayStride == 0) {
+				Z zdelay = std::clamp(*delay, -maxdelay_, maxdelay_);
+				int32_t offset = std::max(1,(int32_t)floor(zdelay * sr + .5));
+				constantDelay(buf, bufMask, bufPos, offset, 0, 0, n, in, inStride, out,
+					[](int m, Z const* taps, Z const* in, Z* out, Z* w) {
+						memcpy(out, taps, m * sizeof(Z));
+						memcpy(w, in, m * sizeof(Z));
+					});
+				in_.advance(n);
+				delay_.advance(n);
+				framesToFill -= n;
+				out += n;
 			} else {
                 for (int i = 0; i < n; ++i) {
 					Z zdelay = *delay;
@@ -122,7 +183,7 @@ public:
 	DelayL(Thread& th, Arg in, Arg delay, Z maxdelay) : Gen(th, itemTypeZ, false), in_(in), delay_(delay), maxdelay_(maxdelay)
 	{
 		sr = th.rate.sampleRate;
-		bufSize = NEXTPOWEROFTWO((int32_t)ceil(sr * maxdelay));
+		bufSize = NEXTPOWEROFTWO((int32_t)ceil(sr * maxdelay) + kDelayHeadroom);
 		bufMask = bufSize - 1;
 		bufPos = 0;
 		buf = (Z*)calloc(bufSize, sizeof(Z));
@@ -147,24 +208,24 @@ public:
                 if (delayStride == 0) {
 					Z zdelay = *delay;
 					zdelay = std::clamp(zdelay, -maxdelay_, maxdelay_);
-                    Z fpos = std::max(1., zdelay * sr);
+                    Z fpos = std::max<Z>(1., zdelay * sr);
                     Z ipos = floor(fpos);
                     Z frac = fpos - ipos;
                     int32_t offset = (int32_t)ipos;
-                    for (int i = 0; i < n; ++i) {
-                        int32_t offset2 = bufPos-offset;
-                        Z a = buf[(offset2) & bufMask];
-                        Z b = buf[(offset2-1) & bufMask];
-                        out[i] = a + frac * (b - a);
-                        buf[bufPos & bufMask] = *in;
-                        in += inStride;
-                        ++bufPos;
-                    }
+                    constantDelay(buf, bufMask, bufPos, offset, 1, 0, n, in, inStride, out,
+                        [frac](int m, Z const* taps, Z const* in, Z* out, Z* w) {
+                            for (int i = 0; i < m; ++i) {
+                                Z a = taps[i];
+                                Z b = taps[i-1];
+                                out[i] = a + frac * (b - a);
+                                w[i] = in[i];
+                            }
+                        });
                 } else {
                     for (int i = 0; i < n; ++i) {
 						Z zdelay = *delay;
 						zdelay = std::clamp(zdelay, -maxdelay_, maxdelay_);
-                        Z fpos = std::max(1., zdelay * sr);
+                        Z fpos = std::max<Z>(1., zdelay * sr);
                         Z ipos = floor(fpos);
                         Z frac = fpos - ipos;
                         int32_t offset = bufPos-(int32_t)ipos;
@@ -222,7 +283,7 @@ public:
 	DelayC(Thread& th, Arg in, Arg delay, Z maxdelay) : Gen(th, itemTypeZ, false), in_(in), delay_(delay), maxdelay_(maxdelay)
 	{
 		sr = th.rate.sampleRate;
-		bufSize = NEXTPOWEROFTWO((int32_t)ceil(sr * maxdelay));
+		bufSize = NEXTPOWEROFTWO((int32_t)ceil(sr * maxdelay) + kDelayHeadroom);
 		bufMask = bufSize - 1;
 		bufPos = 0;
 		buf = (Z*)calloc(bufSize, sizeof(Z));
@@ -247,26 +308,22 @@ public:
                 if (delayStride == 0) {
 					Z zdelay = *delay;
 					zdelay = std::clamp(zdelay, -maxdelay_, maxdelay_);
-                    Z fpos = std::max(2., zdelay * sr);
+                    Z fpos = std::max<Z>(2., zdelay * sr);
                     Z ipos = floor(fpos);
                     Z frac = fpos - ipos;
                     int32_t offset = (int32_t)ipos;
-                    for (int i = 0; i < n; ++i) {
-                        int32_t offset2 = bufPos-offset;
-                        Z a = buf[(offset2+1) & bufMask];
-                        Z b = buf[(offset2  ) & bufMask];
-                        Z c = buf[(offset2-1) & bufMask];
-                        Z d = buf[(offset2-2) & bufMask];
-                        out[i] = lagrangeInterpolate(frac, a, b, c, d);
-                        buf[bufPos & bufMask] = *in;
-                        in += inStride;
-                        ++bufPos;
-                    }
+                    constantDelay(buf, bufMask, bufPos, offset, 2, 1, n, in, inStride, out,
+                        [frac](int m, Z const* taps, Z const* in, Z* out, Z* w) {
+                            for (int i = 0; i < m; ++i) {
+                                out[i] = lagrangeInterpolate(frac, taps[i+1], taps[i], taps[i-1], taps[i-2]);
+                                w[i] = in[i];
+                            }
+                        });
                 } else {
                     for (int i = 0; i < n; ++i) {
 						Z zdelay = *delay;
 						zdelay = std::clamp(zdelay, -maxdelay_, maxdelay_);
-                        Z fpos = std::max(2., zdelay * sr);
+                        Z fpos = std::max<Z>(2., zdelay * sr);
                         Z ipos = floor(fpos);
                         Z frac = fpos - ipos;
                         int32_t offset = bufPos-(int32_t)ipos;
@@ -356,7 +413,7 @@ public:
 				for (int i = 0; i < n; ++i) {
 					Z zdelay = *delay;
 					zdelay = std::clamp(zdelay, -maxdelay_, maxdelay_);
-					Z fpos = std::max(2., zdelay * sr + fhalf);
+					Z fpos = std::max<Z>(2., zdelay * sr + fhalf);
 					Z ipos = floor(fpos);
 					Z frac = fpos - ipos;
 					int32_t offset = bufPos-(int32_t)ipos;
@@ -425,7 +482,7 @@ public:
 				for (int i = 0; i < n; ++i) {
 					Z zdelay = *delay;
 					zdelay = std::clamp(zdelay, -maxdelay_, maxdelay_);
-					Z fpos = std::max(2., zdelay * sr + fhalf);
+					Z fpos = std::max<Z>(2., zdelay * sr + fhalf);
 					Z ipos = floor(fpos);
 					Z frac = fpos - ipos;
 					int32_t offset = bufPos-(int32_t)ipos;
@@ -505,7 +562,7 @@ public:
 	CombN(Thread& th, Arg in, Arg delay, Z maxdelay, Arg decay) : Gen(th, itemTypeZ, false), in_(in), delay_(delay), decay_(decay), maxdelay_(maxdelay)
 	{
 		sr = th.rate.sampleRate;
-		bufSize = NEXTPOWEROFTWO((int32_t)ceil(sr * maxdelay + 1.));
+		bufSize = NEXTPOWEROFTWO((int32_t)ceil(sr * maxdelay + 1.) + kDelayHeadroom);
 		bufMask = bufSize - 1;
 		bufPos = 0;
 		buf = (Z*)calloc(bufSize, sizeof(Z));
@@ -527,7 +584,20 @@ public:
 				setDone();
 				break;
 			} else {
-				if (decayStride == 0) {
+				if (decayStride == 0 && delayStride == 0) {
+					double rdecay = 1. / *decay;
+					Z zdelay = std::clamp(*delay, -maxdelay_, maxdelay_);
+					Z fb = calcDecay(zdelay * rdecay);
+					int32_t offset = std::max(1,(int32_t)floor(std::abs(zdelay) * sr + .5));
+					constantDelay(buf, bufMask, bufPos, offset, 0, 0, n, in, inStride, out,
+						[fb](int m, Z const* taps, Z const* in, Z* out, Z* w) {
+							for (int i = 0; i < m; ++i) {
+								Z z = fb * taps[i];
+								out[i] = z;
+								w[i] = in[i] + z;
+							}
+						});
+				} else if (decayStride == 0) {
 					double rdecay = 1. / *decay;
 					for (int i = 0; i < n; ++i) {
 						Z zdelay = *delay;
@@ -604,7 +674,7 @@ public:
 	CombL(Thread& th, Arg in, Arg delay, Z maxdelay, Arg decay) : Gen(th, itemTypeZ, false), in_(in), delay_(delay), decay_(decay), maxdelay_(maxdelay)
 	{
 		sr = th.rate.sampleRate;
-		bufSize = NEXTPOWEROFTWO((int32_t)ceil(sr * maxdelay));
+		bufSize = NEXTPOWEROFTWO((int32_t)ceil(sr * maxdelay) + kDelayHeadroom);
 		bufMask = bufSize - 1;
 		bufPos = 0;
 		buf = (Z*)calloc(bufSize, sizeof(Z));
@@ -631,27 +701,27 @@ public:
 						Z zdelay = *delay;
 						zdelay = std::clamp(zdelay, -maxdelay_, maxdelay_);
 						Z fb = calcDecay(zdelay / *decay);
-                        Z fpos = std::max(1., zdelay * sr);
+                        Z fpos = std::max<Z>(1., zdelay * sr);
                         Z ipos = floor(fpos);
                         Z frac = fpos - ipos;
                         int32_t offset = (int32_t)ipos;
-                        for (int i = 0; i < n; ++i) {
-							int32_t offset2 = bufPos-offset;
-                            Z a = buf[(offset2) & bufMask];
-                            Z b = buf[(offset2-1) & bufMask];
-                            Z z = fb * (a + frac * (b - a));
-                            out[i] = z;
-                            buf[bufPos & bufMask] = *in + z;
-                            in += inStride;
-                            ++bufPos;
-                        }
+                        constantDelay(buf, bufMask, bufPos, offset, 1, 0, n, in, inStride, out,
+                            [fb, frac](int m, Z const* taps, Z const* in, Z* out, Z* w) {
+                                for (int i = 0; i < m; ++i) {
+                                    Z a = taps[i];
+                                    Z b = taps[i-1];
+                                    Z z = fb * (a + frac * (b - a));
+                                    out[i] = z;
+                                    w[i] = in[i] + z;
+                                }
+                            });
                     } else {
                         double rdecay = 1. / *decay;
                         for (int i = 0; i < n; ++i) {
 							Z zdelay = *delay;
 							zdelay = std::clamp(zdelay, -maxdelay_, maxdelay_);
                             Z fb = calcDecay(zdelay * rdecay);
-                            Z fpos = std::max(1., zdelay * sr);
+                            Z fpos = std::max<Z>(1., zdelay * sr);
                             Z ipos = floor(fpos);
                             Z frac = fpos - ipos;
                             int32_t offset = bufPos-(int32_t)ipos;
@@ -670,7 +740,7 @@ public:
 						Z zdelay = *delay;
 						zdelay = std::clamp(zdelay, -maxdelay_, maxdelay_);
 						Z fb = calcDecay(zdelay / *decay);
-                        Z fpos = std::max(1., zdelay * sr);
+                        Z fpos = std::max<Z>(1., zdelay * sr);
                         Z ipos = floor(fpos);
                         Z frac = fpos - ipos;
 						int32_t offset = bufPos-(int32_t)ipos;
@@ -732,7 +802,7 @@ public:
 	CombC(Thread& th, Arg in, Arg delay, Z maxdelay, Arg decay) : Gen(th, itemTypeZ, false), in_(in), delay_(delay), decay_(decay), maxdelay_(maxdelay)
 	{
 		sr = th.rate.sampleRate;
-		bufSize = NEXTPOWEROFTWO((int32_t)ceil(sr * maxdelay));
+		bufSize = NEXTPOWEROFTWO((int32_t)ceil(sr * maxdelay) + kDelayHeadroom);
 		bufMask = bufSize - 1;
 		bufPos = 0;
 		buf = (Z*)calloc(bufSize, sizeof(Z));
@@ -759,29 +829,25 @@ public:
 						Z zdelay = *delay;
 						zdelay = std::clamp(zdelay, -maxdelay_, maxdelay_);
 						Z fb = calcDecay(zdelay / *decay);
-                        Z fpos = std::max(2., zdelay * sr);
+                        Z fpos = std::max<Z>(2., zdelay * sr);
                         Z ipos = floor(fpos);
                         Z frac = fpos - ipos;
                         int32_t offset = (int32_t)ipos;
-                        for (int i = 0; i < n; ++i) {
-							int32_t offset2 = bufPos-offset;
-							Z a = buf[(offset2+1) & bufMask];
-							Z b = buf[(offset2  ) & bufMask];
-							Z c = buf[(offset2-1) & bufMask];
-							Z d = buf[(offset2-2) & bufMask];
-							Z z = fb * lagrangeInterpolate(frac, a, b, c, d);
-                            out[i] = z;
-                            buf[bufPos & bufMask] = *in + z;
-                            in += inStride;
-                            ++bufPos;
-                        }
+                        constantDelay(buf, bufMask, bufPos, offset, 2, 1, n, in, inStride, out,
+                            [fb, frac](int m, Z const* taps, Z const* in, Z* out, Z* w) {
+                                for (int i = 0; i < m; ++i) {
+                                    Z z = fb * lagrangeInterpolate(frac, taps[i+1], taps[i], taps[i-1], taps[i-2]);
+                                    out[i] = z;
+                                    w[i] = in[i] + z;
+                                }
+                            });
                     } else {
                         double rdecay = 1. / *decay;
                         for (int i = 0; i < n; ++i) {
 							Z zdelay = *delay;
 							zdelay = std::clamp(zdelay, -maxdelay_, maxdelay_);
                             Z fb = calcDecay(zdelay * rdecay);
-                            Z fpos = std::max(2., zdelay * sr);
+                            Z fpos = std::max<Z>(2., zdelay * sr);
                             Z ipos = floor(fpos);
                             Z frac = fpos - ipos;
 							int32_t offset = bufPos-(int32_t)ipos;
@@ -802,7 +868,7 @@ public:
 						Z zdelay = *delay;
 						zdelay = std::clamp(zdelay, -maxdelay_, maxdelay_);
 						Z fb = calcDecay(zdelay / *decay);
-                        Z fpos = std::max(2., zdelay * sr);
+                        Z fpos = std::max<Z>(2., zdelay * sr);
                         Z ipos = floor(fpos);
                         Z frac = fpos - ipos;
 						int32_t offset = bufPos-(int32_t)ipos;
@@ -901,7 +967,7 @@ public:
 							Z zdelay = *delay;
 							zdelay = std::clamp(zdelay, -maxdelay_, maxdelay_);
                             Z fb = calcDecay(zdelay / *decay);
-                            Z fpos = std::max(2., zdelay * sr);
+                            Z fpos = std::max<Z>(2., zdelay * sr);
                             Z ipos = floor(fpos);
                             Z frac = fpos - ipos;
                             int32_t offset = (int32_t)ipos;
@@ -925,7 +991,7 @@ public:
 								Z zdelay = *delay;
 								zdelay = std::clamp(zdelay, -maxdelay_, maxdelay_);
                                 Z fb = calcDecay(zdelay * rdecay);
-                                Z fpos = std::max(2., zdelay * sr);
+                                Z fpos = std::max<Z>(2., zdelay * sr);
                                 Z ipos = floor(fpos);
                                 Z frac = fpos - ipos;
                                 int32_t offset = bufPos-(int32_t)ipos;
@@ -947,7 +1013,7 @@ public:
 							Z zdelay = *delay;
 							zdelay = std::clamp(zdelay, -maxdelay_, maxdelay_);
                             Z fb = calcDecay(zdelay / *decay);
-                            Z fpos = std::max(2., zdelay * sr);
+                            Z fpos = std::max<Z>(2., zdelay * sr);
                             Z ipos = floor(fpos);
                             Z frac = fpos - ipos;
                             int32_t offset = bufPos-(int32_t)ipos;
@@ -970,7 +1036,7 @@ public:
 							Z zdelay = *delay;
 							zdelay = std::clamp(zdelay, -maxdelay_, maxdelay_);
                             Z fb = calcDecay(zdelay / *decay);
-                            Z fpos = std::max(2., zdelay * sr);
+                            Z fpos = std::max<Z>(2., zdelay * sr);
                             Z ipos = floor(fpos);
                             Z frac = fpos - ipos;
                             int32_t offset = (int32_t)ipos;
@@ -995,7 +1061,7 @@ public:
 								Z zdelay = *delay;
 								zdelay = std::clamp(zdelay, -maxdelay_, maxdelay_);
                                 Z fb = calcDecay(zdelay * rdecay);
-                                Z fpos = std::max(2., zdelay * sr);
+                                Z fpos = std::max<Z>(2., zdelay * sr);
                                 Z ipos = floor(fpos);
                                 Z frac = fpos - ipos;
                                 int32_t offset = bufPos-(int32_t)ipos;
@@ -1019,7 +1085,7 @@ public:
 							Z zdelay = *delay;
 							zdelay = std::clamp(zdelay, -maxdelay_, maxdelay_);
                             Z fb = calcDecay(zdelay / *decay);
-                            Z fpos = std::max(2., zdelay * sr);
+                            Z fpos = std::max<Z>(2., zdelay * sr);
                             Z ipos = floor(fpos);
                             Z frac = fpos - ipos;
                             int32_t offset = bufPos-(int32_t)ipos;
@@ -1091,7 +1157,7 @@ public:
 	AllpassN(Thread& th, Arg in, Arg delay, Z maxdelay, Arg decay) : Gen(th, itemTypeZ, false), in_(in), delay_(delay), decay_(decay), maxdelay_(maxdelay)
 	{
 		sr = th.rate.sampleRate;
-		bufSize = NEXTPOWEROFTWO((int32_t)ceil(sr * maxdelay));
+		bufSize = NEXTPOWEROFTWO((int32_t)ceil(sr * maxdelay) + kDelayHeadroom);
 		bufMask = bufSize - 1;
 		bufPos = 0;
 		buf = (Z*)calloc(bufSize, sizeof(Z));
@@ -1113,7 +1179,21 @@ public:
 				setDone();
 				break;
 			} else {
-				if (decayStride == 0) {
+				if (decayStride == 0 && delayStride == 0) {
+					double rdecay = 1. / *decay;
+					Z zdelay = std::clamp(*delay, -maxdelay_, maxdelay_);
+					Z fb = calcDecay(zdelay * rdecay);
+					int32_t offset = std::max(1,(int32_t)floor(zdelay * sr + .5));
+					constantDelay(buf, bufMask, bufPos, offset, 0, 0, n, in, inStride, out,
+						[fb](int m, Z const* taps, Z const* in, Z* out, Z* w) {
+							for (int i = 0; i < m; ++i) {
+								Z drd = taps[i];
+								Z dwr = drd * fb + in[i];
+								w[i] = dwr;
+								out[i] = drd - fb * dwr;
+							}
+						});
+				} else if (decayStride == 0) {
 					double rdecay = 1. / *decay;
 					for (int i = 0; i < n; ++i) {
 						Z zdelay = *delay;
@@ -1192,7 +1272,7 @@ public:
 	AllpassL(Thread& th, Arg in, Arg delay, Z maxdelay, Arg decay) : Gen(th, itemTypeZ, false), in_(in), delay_(delay), decay_(decay), maxdelay_(maxdelay)
 	{
 		sr = th.rate.sampleRate;
-		bufSize = NEXTPOWEROFTWO((int32_t)ceil(sr * maxdelay));
+		bufSize = NEXTPOWEROFTWO((int32_t)ceil(sr * maxdelay) + kDelayHeadroom);
 		bufMask = bufSize - 1;
 		bufPos = 0;
 		buf = (Z*)calloc(bufSize, sizeof(Z));
@@ -1219,28 +1299,28 @@ public:
 						Z zdelay = *delay;
 						zdelay = std::clamp(zdelay, -maxdelay_, maxdelay_);
 						Z fb = calcDecay(zdelay / *decay);
-                        Z fpos = std::max(1., zdelay * sr);
+                        Z fpos = std::max<Z>(1., zdelay * sr);
                         Z ipos = floor(fpos);
                         Z frac = fpos - ipos;
                         int32_t offset = (int32_t)ipos;
-                        for (int i = 0; i < n; ++i) {
-							int32_t offset2 = bufPos-offset;
-                            Z a = buf[(offset2) & bufMask];
-                            Z b = buf[(offset2-1) & bufMask];
-                            Z drd = a + frac * (b - a);
-                            Z dwr = drd * fb + *in;
-                            buf[bufPos & bufMask] = dwr;
-                            out[i] = drd - fb * dwr;
-                            in += inStride;
-                            ++bufPos;
-                        }
+                        constantDelay(buf, bufMask, bufPos, offset, 1, 0, n, in, inStride, out,
+                            [fb, frac](int m, Z const* taps, Z const* in, Z* out, Z* w) {
+                                for (int i = 0; i < m; ++i) {
+                                    Z a = taps[i];
+                                    Z b = taps[i-1];
+                                    Z drd = a + frac * (b - a);
+                                    Z dwr = drd * fb + in[i];
+                                    w[i] = dwr;
+                                    out[i] = drd - fb * dwr;
+                                }
+                            });
                     } else {
                         double rdecay = 1. / *decay;
                         for (int i = 0; i < n; ++i) {
 							Z zdelay = *delay;
 							zdelay = std::clamp(zdelay, -maxdelay_, maxdelay_);
                             Z fb = calcDecay(zdelay * rdecay);
-                            Z fpos = std::max(1., zdelay * sr);
+                            Z fpos = std::max<Z>(1., zdelay * sr);
                             Z ipos = floor(fpos);
                             Z frac = fpos - ipos;
                             int32_t offset = bufPos-(int32_t)ipos;
@@ -1260,7 +1340,7 @@ public:
 						Z zdelay = *delay;
 						zdelay = std::clamp(zdelay, -maxdelay_, maxdelay_);
 						Z fb = calcDecay(zdelay / *decay);
-                        Z fpos = std::max(1., zdelay * sr);
+                        Z fpos = std::max<Z>(1., zdelay * sr);
                         Z ipos = floor(fpos);
                         Z frac = fpos - ipos;
 						int32_t offset = bufPos-(int32_t)ipos;
@@ -1323,7 +1403,7 @@ public:
 	AllpassC(Thread& th, Arg in, Arg delay, Z maxdelay, Arg decay) : Gen(th, itemTypeZ, false), in_(in), delay_(delay), decay_(decay), maxdelay_(maxdelay)
 	{
 		sr = th.rate.sampleRate;
-		bufSize = NEXTPOWEROFTWO((int32_t)ceil(sr * maxdelay));
+		bufSize = NEXTPOWEROFTWO((int32_t)ceil(sr * maxdelay) + kDelayHeadroom);
 		bufMask = bufSize - 1;
 		bufPos = 0;
 		buf = (Z*)calloc(bufSize, sizeof(Z));
@@ -1350,30 +1430,26 @@ public:
 						Z zdelay = *delay;
 						zdelay = std::clamp(zdelay, -maxdelay_, maxdelay_);
 						Z fb = calcDecay(zdelay / *decay);
-                        Z fpos = std::max(2., zdelay * sr);
+                        Z fpos = std::max<Z>(2., zdelay * sr);
                         Z ipos = floor(fpos);
                         Z frac = fpos - ipos;
                         int32_t offset = (int32_t)ipos;
-                        for (int i = 0; i < n; ++i) {
-							int32_t offset2 = bufPos-offset;
-							Z a = buf[(offset2+1) & bufMask];
-							Z b = buf[(offset2  ) & bufMask];
-							Z c = buf[(offset2-1) & bufMask];
-							Z d = buf[(offset2-2) & bufMask];
-                            Z drd = lagrangeInterpolate(frac, a, b, c, d);
-                            Z dwr = drd * fb + *in;
-                            buf[bufPos & bufMask] = dwr;
-                            out[i] = drd - fb * dwr;
-                            in += inStride;
-                            ++bufPos;
-                        }
+                        constantDelay(buf, bufMask, bufPos, offset, 2, 1, n, in, inStride, out,
+                            [fb, frac](int m, Z const* taps, Z const* in, Z* out, Z* w) {
+                                for (int i = 0; i < m; ++i) {
+                                    Z drd = lagrangeInterpolate(frac, taps[i+1], taps[i], taps[i-1], taps[i-2]);
+                                    Z dwr = drd * fb + in[i];
+                                    w[i] = dwr;
+                                    out[i] = drd - fb * dwr;
+                                }
+                            });
                     } else {
                         double rdecay = 1. / *decay;
                         for (int i = 0; i < n; ++i) {
 							Z zdelay = *delay;
 							zdelay = std::clamp(zdelay, -maxdelay_, maxdelay_);
                             Z fb = calcDecay(zdelay * rdecay);
-                            Z fpos = std::max(2., zdelay * sr);
+                            Z fpos = std::max<Z>(2., zdelay * sr);
                             Z ipos = floor(fpos);
                             Z frac = fpos - ipos;
 							int32_t offset = bufPos-(int32_t)ipos;
@@ -1395,7 +1471,7 @@ public:
 						Z zdelay = *delay;
 						zdelay = std::clamp(zdelay, -maxdelay_, maxdelay_);
 						Z fb = calcDecay(zdelay / *decay);
-                        Z fpos = std::max(2., zdelay * sr);
+                        Z fpos = std::max<Z>(2., zdelay * sr);
                         Z ipos = floor(fpos);
                         Z frac = fpos - ipos;
 						int32_t offset = bufPos-(int32_t)ipos;
@@ -1442,6 +1518,374 @@ static void alpasc_(Thread& th, Prim* prim)
 	th.push(new List(new AllpassC(th, in, delay, maxdelay, decay)));
 }
 
+////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// interpolation for taps. place turns a delay time into a whole number of frames and a fraction,
+// interp reads around t[0], the delayed frame. t[-1] is one frame older.
+
+struct TapN
+{
+	enum { back = 0, ahead = 0 };
+	static const char* name() { return "DelayTapN"; }
+	static void place(Z zdelay, Z sr, int32_t& offset, Z& frac)
+	{
+		offset = std::max(1,(int32_t)floor(zdelay * sr + .5));
+		frac = 0.;
+	}
+	static Z interp(Z const* t, Z frac) { return t[0]; }
+};
+
+struct TapL
+{
+	enum { back = 1, ahead = 0 };
+	static const char* name() { return "DelayTapL"; }
+	static void place(Z zdelay, Z sr, int32_t& offset, Z& frac)
+	{
+		Z fpos = std::max<Z>(1., zdelay * sr);
+		Z ipos = floor(fpos);
+		frac = fpos - ipos;
+		offset = (int32_t)ipos;
+	}
+	static Z interp(Z const* t, Z frac) { return t[0] + frac * (t[-1] - t[0]); }
+};
+
+struct TapC
+{
+	enum { back = 2, ahead = 1 };
+	static const char* name() { return "DelayTapC"; }
+	static void place(Z zdelay, Z sr, int32_t& offset, Z& frac)
+	{
+		Z fpos = std::max<Z>(2., zdelay * sr);
+		Z ipos = floor(fpos);
+		frac = fpos - ipos;
+		offset = (int32_t)ipos;
+	}
+	static Z interp(Z const* t, Z frac) { return lagrangeInterpolate(frac, t[1], t[0], t[-1], t[-2]); }
+};
+
+// reads n frames of a tap whose first output is at frame p of the ring buffer and hands each to put(i, x).
+// every frame read must already be written.
+template <typename Tap, typename Put>
+static void readTap(Z const* buf, int32_t bufMask, int64_t p, Z* delay, int delayStride, Z maxdelay, Z sr, int n, Put put)
+{
+	int32_t offset;
+	Z frac;
+	if (delayStride == 0) {
+		Tap::place(std::clamp(*delay, -maxdelay, maxdelay), sr, offset, frac);
+		Z taps[kDelayChunk + 4];
+		for (int i = 0; i < n; ) {
+			int m = std::min(n - i, kDelayChunk);
+			ringRead(buf, bufMask, (int32_t)((p + i - offset - Tap::back) & bufMask), m + Tap::back + Tap::ahead, taps);
+			for (int j = 0; j < m; ++j)
+				put(i + j, Tap::interp(taps + Tap::back + j, frac));
+			i += m;
+		}
+	} else {
+		for (int i = 0; i < n; ++i) {
+			Tap::place(std::clamp(*delay, -maxdelay, maxdelay), sr, offset, frac);
+			Z w[Tap::back + Tap::ahead + 1];
+			int64_t q = p + i - offset - Tap::back;
+			for (int j = 0; j <= Tap::back + Tap::ahead; ++j)
+				w[j] = buf[(q + j) & bufMask];
+			put(i, Tap::interp(w + Tap::back, frac));
+			delay += delayStride;
+		}
+	}
+}
+
+// delays longer than this many frames are refused by delaybuf and mtapc.
+const int64_t kMaxTapDelayFrames = int64_t(1) << 28;
+
+// the frames a tap may reach behind its output frame for delays up to maxdelay.
+static int64_t tapReach(Z sr, Z maxdelay)
+{
+	return (int64_t)ceil(sr * maxdelay) + TapC::back + 1;
+}
+
+static void checkTapMaxDelay(Thread& th, Z maxdelay, const char* msg)
+{
+	if (!(maxdelay > 0.)) {
+		post("%s : maxdelay must be greater than zero\n", msg);
+		throw errOutOfRange;
+	}
+	if (!(maxdelay * th.rate.sampleRate <= kMaxTapDelayFrames)) {
+		post("%s : maxdelay must be at most %g seconds\n", msg, kMaxTapDelayFrames / th.rate.sampleRate);
+		throw errOutOfRange;
+	}
+}
+
+// a delay buffer is written once from its input and read by any number of taps, each with its own delay and interpolation.
+// taps pull the input into the buffer as far as they need it. the buffer holds maxdelay and one block, so a tap that
+// falls further than that behind the fastest tap skips ahead to the oldest frames still held. after the input ends
+// the taps read silence until maxdelay has passed.
+// taps may be pulled on different threads. as when a list is forced, the buffer stays locked while its input is pulled.
+class DelayBuffer : public Object
+{
+	ZIn in_;
+	bool inFinite_;
+	Z maxdelay_;
+	Z sr_;
+	int64_t maxOffset_;
+	int64_t bufSize;
+	int64_t bufMask;
+	Z* buf;
+	int64_t writePos; // frames written so far.
+	int64_t endPos; // frames there will be, once the input has ended.
+	LOCK_DECLARE(mSpinLock);
+
+public:
+
+	DelayBuffer(Thread& th, Arg in, Z maxdelay)
+		: in_(in), inFinite_(in.isFinite()), maxdelay_(maxdelay), writePos(0), endPos(INT64_MAX)
+	{
+		sr_ = th.rate.sampleRate;
+		maxOffset_ = tapReach(sr_, maxdelay);
+		bufSize = NEXTPOWEROFTWO(maxOffset_ + th.rate.blockSize);
+		bufMask = bufSize - 1;
+		buf = (Z*)calloc(bufSize, sizeof(Z));
+	}
+	
+	~DelayBuffer() { free(buf); }
+	
+	virtual const char* TypeName() const override { return "DelayBuffer"; }
+
+	bool inputFinite() const { return inFinite_; }
+	
+	// a new tap starts at frame zero, so the buffer must still hold the start of its input.
+	bool canAddTap() const
+	{
+		SpinLocker lock(mSpinLock);
+		return writePos + maxOffset_ <= bufSize;
+	}
+	
+	// reads up to n frames of a tap from ioPos, writing the input as far as they need, and advances ioPos.
+	// returns the number of frames read, which is zero once the input and its ring out have ended.
+	template <typename Tap, typename Put>
+	int read(Thread& th, int64_t& ioPos, int n, Z* delay, int delayStride, Put put)
+	{
+		SpinLocker lock(mSpinLock);
+		ioPos = std::max(ioPos, writePos - bufSize + maxOffset_);
+		n = (int)std::min<int64_t>(n, bufSize - maxOffset_);
+		int64_t want = std::min(ioPos + n, endPos);
+		while (writePos < want) {
+			int64_t start = writePos & bufMask;
+			int m = (int)std::min(want - writePos, bufSize - start);
+			if (endPos != INT64_MAX) {
+				memset(buf + start, 0, m * sizeof(Z));
+			} else if (in_.fill(th, m, buf + start, 1)) {
+				endPos = writePos + m + maxOffset_;
+				want = std::min(want, endPos);
+			}
+			writePos += m;
+		}
+		n = (int)std::clamp<int64_t>(want - ioPos, 0, n);
+		if (n) readTap<Tap>(buf, (int32_t)bufMask, ioPos, delay, delayStride, maxdelay_, sr_, n, put);
+		ioPos += n;
+		return n;
+	}
+};
+
+template <typename Tap>
+class DelayTap : public Gen
+{
+	P<DelayBuffer> buf_;
+	ZIn delay_;
+	int64_t pos;
+public:
+	
+	DelayTap(Thread& th, P<DelayBuffer> const& buf, Arg delay)
+		: Gen(th, itemTypeZ, buf->inputFinite() || delay.isFinite()), buf_(buf), delay_(delay), pos(0)
+	{
+	}
+	
+	virtual const char* TypeName() const override { return Tap::name(); }
+    
+	virtual void pull(Thread& th) override 
+	{
+		int framesToFill = mBlockSize;
+		Z* out = mOut->fulfillz(framesToFill);
+		while (framesToFill) {
+			int n = framesToFill;
+			int delayStride;
+			Z *delay;
+			if (delay_(th, n, delayStride, delay) || !(n = buf_->read<Tap>(th, pos, n, delay, delayStride, [out](int i, Z x) { out[i] = x; }))) {
+				setDone();
+				break;
+			} else {
+				delay_.advance(n);
+				framesToFill -= n;
+				out += n;
+			}
+		}
+		produce(framesToFill);
+	}
+};
+
+static void delaybuf_(Thread& th, Prim* prim)
+{
+	Z maxdelay = th.popFloat("delaybuf : maxdelay");
+	V in = th.popZIn("delaybuf : in");
+	
+	checkTapMaxDelay(th, maxdelay, "delaybuf");
+	
+	th.push(new DelayBuffer(th, in, maxdelay));
+}
+
+template <typename Tap>
+static void tap(Thread& th, const char* msgDelay, const char* msgBuf)
+{
+	V delay = th.popZIn(msgDelay);
+	V v = th.popValue();
+	
+	P<DelayBuffer> buf = dynamic_cast<DelayBuffer*>(v.o());
+	if (!buf) wrongType(msgBuf, "DelayBuffer", v);
+	if (!buf->canAddTap()) {
+		post("%s has already discarded the start of its input\n", msgBuf);
+		throw errFailed;
+	}
+	
+	th.push(new List(new DelayTap<Tap>(th, buf, delay)));
+}
+
+static void tapn_(Thread& th, Prim* prim) { tap<TapN>(th, "tapn : delay", "tapn : buf"); }
+static void tapl_(Thread& th, Prim* prim) { tap<TapL>(th, "tapl : delay", "tapl : buf"); }
+static void tapc_(Thread& th, Prim* prim) { tap<TapC>(th, "tapc : delay", "tapc : buf"); }
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+struct MultiTapIn
+{
+	MultiTapIn(V d, V g) : delay(d), gain(g) {}
+	
+	ZIn delay, gain;
+};
+
+// sums several cubic taps of one input, writing the input once per block. after the input ends it rings out for maxdelay.
+struct MultiTapC : public Gen
+{
+	ZIn _in;
+	std::vector<MultiTapIn> _taps;
+	Z _maxdelay;
+	Z _sr;
+	int64_t maxOffset;
+	int32_t bufSize;
+	int32_t bufMask;
+	int64_t bufPos;
+	int64_t endPos; // frames of output, once the input has ended.
+	Z* buf;
+	
+	MultiTapC(Thread& th, Arg in, V delays, V gains, Z maxdelay)
+		: Gen(th, itemTypeZ, in.isFinite()), _in(in), _maxdelay(maxdelay), _sr(th.rate.sampleRate), bufPos(0), endPos(INT64_MAX)
+	{
+		maxOffset = tapReach(_sr, maxdelay);
+		bufSize = (int32_t)NEXTPOWEROFTWO(maxOffset + mBlockSize);
+		bufMask = bufSize - 1;
+		buf = (Z*)calloc(bufSize, sizeof(Z));
+		
+		int64_t numTaps = LONG_MAX;
+		if (delays.isVList()) { 
+			delays = ((List*)delays.o())->pack(th); 
+			numTaps = std::min(numTaps, delays.length(th)); 
+		}
+		if (gains.isVList()) { 
+			gains = ((List*)gains.o())->pack(th); 
+			numTaps = std::min(numTaps, gains.length(th)); 
+		}
+		
+		if (numTaps == LONG_MAX) numTaps = 1;
+		
+		for (ssize_t i = 0; i < numTaps; ++i) {
+			_taps.push_back(MultiTapIn(delays.isVList() ? delays.at(i) : delays, gains.isVList() ? gains.at(i) : gains));
+		}
+	}
+	
+	virtual ~MultiTapC() { free(buf); }
+	
+	virtual const char* TypeName() const override { return "MultiTapC"; }
+	
+	virtual void pull(Thread& th) override
+	{
+		// write the block's input, or silence once it has ended, then read every tap from it.
+		int numInputFrames = (int)std::min<int64_t>(mBlockSize, endPos - bufPos);
+		if (numInputFrames <= 0) {
+			end();
+			return;
+		}
+		int32_t start = bufPos & bufMask;
+		int first = std::min(numInputFrames, bufSize - start);
+		int second = numInputFrames - first;
+		if (endPos != INT64_MAX) {
+			memset(buf + start, 0, first * sizeof(Z));
+			memset(buf, 0, second * sizeof(Z));
+		} else {
+			int m = first;
+			bool done = _in.fill(th, m, buf + start, 1);
+			if (done) {
+				memset(buf, 0, second * sizeof(Z));
+			} else if (second) {
+				done = _in.fill(th, second, buf, 1);
+				m += second;
+			}
+			if (done) {
+				endPos = bufPos + m + maxOffset;
+				numInputFrames = (int)std::min<int64_t>(numInputFrames, endPos - bufPos);
+			}
+		}
+		int maxToFill = 0;
+		
+		Z* out0 = mOut->fulfillz(numInputFrames);
+		memset(out0, 0, numInputFrames * sizeof(Z));
+		
+		for (size_t k = 0; k < _taps.size(); ++k) {
+			int framesToFill = numInputFrames;
+			MultiTapIn& t = _taps[k];
+			
+			int64_t p = bufPos;
+			Z* out = out0;
+			while (framesToFill) {
+				Z *delay, *gain;
+				int n, delayStride, gainStride;
+				n = framesToFill;
+				if (t.delay(th, n, delayStride, delay) || t.gain(th, n, gainStride, gain)) {
+					setDone();
+					maxToFill = std::max(maxToFill, framesToFill);
+					break;
+				}
+				
+				readTap<TapC>(buf, bufMask, p, delay, delayStride, _maxdelay, _sr, n,
+					[out, gain, gainStride](int i, Z x) { out[i] += gain[i * gainStride] * x; });
+				
+				t.delay.advance(n);
+				t.gain.advance(n);
+				framesToFill -= n;
+				out += n;
+				p += n;
+			}
+		}
+		bufPos += numInputFrames;
+		if (bufPos >= endPos) setDone();
+		produce(maxToFill);
+	}
+};
+
+static void mtapc_(Thread& th, Prim* prim)
+{
+	Z maxdelay = th.popFloat("mtapc : maxdelay");
+	V gains = th.popZInList("mtapc : gains");
+	V delays = th.popZInList("mtapc : delays");
+	V in = th.popZIn("mtapc : in");
+	
+	if (delays.isVList() && !delays.isFinite())
+		indefiniteOp("mtapc : delays", "");
+
+	if (gains.isVList() && !gains.isFinite())
+		indefiniteOp("mtapc : gains", "");
+
+	checkTapMaxDelay(th, maxdelay, "mtapc");
+	
+	th.push(new List(new MultiTapC(th, in, delays, gains, maxdelay)));
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////
 class FDN;
 
@@ -1819,6 +2263,12 @@ void AddDelayUGenOps()
 	DEFAM(alpasn, zzkz, "(in delay maxdelay decayTime --> out) all pass delay filter with no interpolation.");
 	DEFAM(alpasl, zzkz, "(in delay maxdelay decayTime --> out) all pass delay filter with linear interpolation.");
 	DEFAM(alpasc, zzkz, "(in delay maxdelay decayTime --> out) all pass delay filter with cubic interpolation.");
+
+	DEFAM(delaybuf, zk, "(in maxdelay --> buf) a delay buffer written once from in and read by any number of taps. it holds maxdelay and one block, so a tap that falls further behind the others skips ahead.");
+	DEFAM(tapn, zz, "(buf delay --> out) reads a delay buffer with no interpolation. a list of delays gives a channel per delay, all sharing buf.");
+	DEFAM(tapl, zz, "(buf delay --> out) reads a delay buffer with linear interpolation.");
+	DEFAM(tapc, zz, "(buf delay --> out) reads a delay buffer with cubic interpolation.");
+	DEFAM(mtapc, zaak, "(in delays gains maxdelay --> out) sum of taps with cubic interpolation, one per delay and gain, from a single delay line.");
 	//DEFAM(fdn, zzkkkkkk, "(in wet decayLo decayMid decayHi mindelay maxdelay rseed --> out) feedback delay network reverb.");
 }
 
@@ -792,7 +792,7 @@ struct LPF : public Gen
 			}
 			
 			if (freqStride == 0) {
-				Z w0 = std::max(1e-3, *freq) * freqmul;
+				Z w0 = std::max<Z>(1e-3, *freq) * freqmul;
 				Z sn, cs;
 				tsincosx(w0, sn, cs);
 				Z alpha = sn * alphamul;
@@ -820,7 +820,7 @@ struct LPF : public Gen
 				_in.advance(n);
 			} else {
 				for (int i = 0; i < n; ++i) {				
-					Z w0 = std::max(1e-3, *freq) * freqmul;
+					Z w0 = std::max<Z>(1e-3, *freq) * freqmul;
 					Z sn, cs;
 					tsincosx(w0, sn, cs);
 					Z alpha = sn * alphamul;
@@ -900,7 +900,7 @@ struct LPF2 : public Gen
 			}
 			
 			if (freqStride == 0) {
-				Z w0 = std::max(1e-3, *freq) * freqmul;
+				Z w0 = std::max<Z>(1e-3, *freq) * freqmul;
 				Z sn, cs;
 				tsincosx(w0, sn, cs);
 				Z alpha = sn * alphamul;
@@ -934,7 +934,7 @@ struct LPF2 : public Gen
 				_in.advance(n);
 			} else {
 				for (int i = 0; i < n; ++i) {
-					Z w0 = std::max(1e-3, *freq) * freqmul;
+					Z w0 = std::max<Z>(1e-3, *freq) * freqmul;
 					Z sn, cs;
 					tsincosx(w0, sn, cs);
 					Z alpha = sn * alphamul;
@@ -33,7 +33,7 @@ V BinaryOp::makeVList(Thread& th, Arg a, Arg b)
 
 V BinaryOp::makeZList(Thread& th, Arg a, Arg b)
 {
-	return new List(new BinaryOpZGen(th, this, a, b));
+	return newBinaryOpZList(th, this, a, b);
 }
 
 V BinaryOpLink::makeVList(Thread& th, Arg a, Arg b)
@@ -161,6 +161,148 @@ void BinaryOpZGen::pull(Thread& th)
 	produce(framesToFill);
 }
 
+bool FusedOpProgram::addInput(ZIn const& in)
+{
+	if (mNumInputs >= kMaxFusedOpInputs || mNumNodes >= kMaxFusedOpNodes)
+		return false;
+	mNodes[mNumNodes++] = { nullptr, nullptr, mNumInputs };
+	mInputs[mNumInputs++] = in;
+	return true;
+}
+
+bool FusedOpProgram::addOp(UnaryOp* op)
+{
+	if (mNumNodes >= kMaxFusedOpNodes)
+		return false;
+	mNodes[mNumNodes++] = { op, nullptr, -1 };
+	return true;
+}
+
+bool FusedOpProgram::addOp(BinaryOp* op)
+{
+	if (mNumNodes >= kMaxFusedOpNodes)
+		return false;
+	mNodes[mNumNodes++] = { nullptr, op, -1 };
+	return true;
+}
+
+bool FusedOpProgram::addProgram(FusedOpProgram const& p)
+{
+	if (mNumInputs + p.mNumInputs > kMaxFusedOpInputs || mNumNodes + p.mNumNodes > kMaxFusedOpNodes)
+		return false;
+	for (int i = 0; i < p.mNumNodes; ++i) {
+		FusedOpNode node = p.mNodes[i];
+		if (node.input >= 0) node.input += mNumInputs;
+		mNodes[mNumNodes++] = node;
+	}
+	for (int i = 0; i < p.mNumInputs; ++i) {
+		mInputs[mNumInputs++] = p.mInputs[i];
+	}
+	return true;
+}
+
+// an operand that is a not yet evaluated element-wise op, held by no one else, has its expression inlined.
+// otherwise it becomes an input. a list referenced elsewhere, e.g. bound to a name, is not inlined so that its work is not repeated.
+// the refcount can't tell this here because the calls that dispatch the op hold references of their own,
+// so the op prims record the operands they popped while holding the only reference.
+bool FusedOpProgram::addOperand(Thread& th, Arg a)
+{
+	if (a.isZList()) {
+		List* list = (List*)a.o();
+		Gen* gen = list->mGen();
+		bool owned = list == th.ownedOperands[0] || list == th.ownedOperands[1];
+		if (owned && gen && !list->mArray && !gen->done()) {
+			if (UnaryOpZGen* g = dynamic_cast<UnaryOpZGen*>(gen)) {
+				mAbsorbed = true;
+				return addInput(g->_a) && addOp(g->op);
+			}
+			if (BinaryOpZGen* g = dynamic_cast<BinaryOpZGen*>(gen)) {
+				mAbsorbed = true;
+				return addInput(g->_a) && addInput(g->_b) && addOp(g->op);
+			}
+			if (FusedOpZGen* g = dynamic_cast<FusedOpZGen*>(gen)) {
+				mAbsorbed = true;
+				return addProgram(g->mProgram);
+			}
+		}
+	}
+	return addInput(ZIn(a));
+}
+
+void FusedOpProgram::eval(int n, Z** in, int* instride, Z* out)
+{
+	Z scratch[kMaxFusedOpNodes][kFusedOpChunkSize];
+	Z* stack[kMaxFusedOpNodes];
+	int stride[kMaxFusedOpNodes];
+	int depth = 0;
+	int last = mNumNodes - 1;
+	for (int i = 0; i <= last; ++i) {
+		FusedOpNode& node = mNodes[i];
+		if (node.unop) {
+			Z* result = i == last ? out : scratch[depth-1];
+			node.unop->loopz(n, stack[depth-1], stride[depth-1], result);
+			stack[depth-1] = result;
+			stride[depth-1] = 1;
+		} else if (node.binop) {
+			Z* result = i == last ? out : scratch[depth-2];
+			node.binop->loopz(n, stack[depth-2], stride[depth-2], stack[depth-1], stride[depth-1], result);
+			--depth;
+			stack[depth-1] = result;
+			stride[depth-1] = 1;
+		} else {
+			stack[depth] = in[node.input];
+			stride[depth] = instride[node.input];
+			++depth;
+		}
+	}
+}
+
+void FusedOpZGen::pull(Thread& th)
+{
+	int framesToFill = mBlockSize;
+	Z* out = mOut->fulfillz(framesToFill);
+	FusedOpProgram& p = mProgram;
+	Z* in[kMaxFusedOpInputs];
+	int instride[kMaxFusedOpInputs];
+	while (framesToFill) {
+		int n = std::min(framesToFill, kFusedOpChunkSize);
+		bool done = false;
+		for (int j = 0; j < p.mNumInputs; ++j) {
+			if (p.mInputs[j](th, n, instride[j], in[j])) {
+				done = true;
+				break;
+			}
+		}
+		if (done) {
+			setDone();
+			break;
+		}
+		p.eval(n, in, instride, out);
+		for (int j = 0; j < p.mNumInputs; ++j) {
+			p.mInputs[j].advance(n);
+		}
+		framesToFill -= n;
+		out += n;
+	}
+	produce(framesToFill);
+}
+
+V newUnaryOpZList(Thread& th, UnaryOp* op, Arg a)
+{
+	FusedOpProgram p;
+	if (p.addOperand(th, a) && p.mAbsorbed && p.addOp(op))
+		return new List(new FusedOpZGen(th, p, a.isFinite()));
+	return new List(new UnaryOpZGen(th, op, a));
+}
+
+V newBinaryOpZList(Thread& th, BinaryOp* op, Arg a, Arg b)
+{
+	FusedOpProgram p;
+	if (p.addOperand(th, a) && p.addOperand(th, b) && p.mAbsorbed && p.addOp(op))
+		return new List(new FusedOpZGen(th, p, mostFinite(a, b)));
+	return new List(new BinaryOpZGen(th, op, a, b));
+}
+
 void BinaryOpLinkZGen::pull(Thread& th)
 {
 	int framesToFill = mBlockSize;
@@ -355,10 +497,32 @@ static void DoIReduce(Thread& th, BinaryOp* op)
 	}
 }
 
+// marks the popped operands that nothing else refers to for the duration of the op.
+class OwnedOperands
+{
+	Thread& th;
+	Object* saved[2];
+	static Object* sole(Arg v) { return v.o() && v.o()->getRefcount() == 1 ? v.o() : nullptr; }
+public:
+	OwnedOperands(Thread& inThread, Arg a, Arg b) : th(inThread)
+	{
+		saved[0] = th.ownedOperands[0];
+		saved[1] = th.ownedOperands[1];
+		th.ownedOperands[0] = sole(a);
+		th.ownedOperands[1] = sole(b);
+	}
+	~OwnedOperands()
+	{
+		th.ownedOperands[0] = saved[0];
+		th.ownedOperands[1] = saved[1];
+	}
+};
+
 #define UNARY_OP_PRIM(NAME) \
 	static void NAME##_(Thread& th, Prim* prim) \
 	{ \
 		V a = th.pop(); \
+		OwnedOperands owned(th, a, 0.); \
 		V c = a.unaryOp(th, &gUnaryOp_##NAME); \
 		th.push(c); \
 	} \
@@ -369,6 +533,7 @@ static void DoIReduce(Thread& th, BinaryOp* op)
 	{ \
 		V b = th.pop(); \
 		V a = th.pop(); \
+		OwnedOperands owned(th, a, b); \
 		V c = a.binaryOp(th, &gBinaryOp_##NAME, b); \
 		th.push(c); \
 	} \
@@ -776,6 +941,7 @@ DEFINE_UNOP_BOOL_FLOAT(isint, (a - floor(a)) == 0.)
 DEFINE_UNOP_BOOL_INT(iseven, !(a & 1))
 DEFINE_UNOP_BOOL_INT(isodd, (a & 1))
 DEFINE_UNOP_BOOL_INT(isprime, isprime(a))
+DEFINE_UNOP_INT(nthprime, nthPrime(a))
 
 DEFINE_UNOP_BOOL_FLOAT(isfinite, std::isfinite(a))
 DEFINE_UNOP_BOOL_FLOAT(isinf, std::isinf(a))
@@ -873,8 +1039,8 @@ DEFINE_UNOP_FLOATVV2(twice, a*2., Z b = 2.; vDSP_vsmulD(const_cast<Z*>(aa), astr
 
 DEFINE_UNOP_FLOATVV2(biuni, a*.5+.5, Z b = .5; vDSP_vsmulD(const_cast<Z*>(aa), astride, &b, out, 1, n); vDSP_vsaddD(out, 1, &b, out, 1, n))
 DEFINE_UNOP_FLOATVV2(unibi, a*2.-1., Z b = 2.; Z c = -1.; vDSP_vsmulD(aa, astride, &b, out, 1, n); vDSP_vsaddD(out, 1, &c, out, 1, n))
-DEFINE_UNOP_FLOATVV2(biunic, std::clamp(a,-1.,1.)*.5+.5, Z b = .5; sc_clipv(n, aa, out, -1., 1.); vDSP_vsmulD(out, astride, &b, out, 1, n); vDSP_vsaddD(out, 1, &b, out, 1, n))
-DEFINE_UNOP_FLOATVV2(unibic, std::clamp(a,0.,1.)*2.-1., Z b = 2.; Z c = -1.; sc_clipv(n, aa, out, 0., 1.); vDSP_vsmulD(out, astride, &b, out, 1, n); vDSP_vsaddD(out, 1, &c, out, 1, n))
+DEFINE_UNOP_FLOATVV2(biunic, std::clamp<Z>(a,-1.,1.)*.5+.5, Z b = .5; sc_clipv(n, aa, out, -1., 1.); vDSP_vsmulD(out, astride, &b, out, 1, n); vDSP_vsaddD(out, 1, &b, out, 1, n))
+DEFINE_UNOP_FLOATVV2(unibic, std::clamp<Z>(a,0.,1.)*2.-1., Z b = 2.; Z c = -1.; sc_clipv(n, aa, out, 0., 1.); vDSP_vsmulD(out, astride, &b, out, 1, n); vDSP_vsaddD(out, 1, &c, out, 1, n))
 DEFINE_UNOP_FLOAT(cmpl, 1.-a)
 
 DEFINE_UNOP_FLOATVV2(ampdb,     sc_ampdb(a), Z b = 1.; vDSP_vdbconD(const_cast<Z*>(aa), astride, &b, out, 1, n, 1))
@@ -975,7 +1141,7 @@ DEFINE_BINOP_FLOATVV1(nextafter, nextafter(a, b), vvnextafter(out, const_cast<Z*
 			z = a;
 		}
 		virtual void reducez(int n, Z& z, Z *aa, int astride) {
-			Z a = z;
+			double a = z; // a long sum of single precision samples drifts unless accumulated in double.
 			LOOP(i,n) { Z b = *aa; a = a + b; aa += astride; }
 			z = a;
 		}
@@ -990,7 +1156,7 @@ DEFINE_BINOP_FLOATVV1(nextafter, nextafter(a, b), vvnextafter(out, const_cast<Z*
 		{
 			if (a.isReal() && a.f == 0.) return b;
 			if (b.isReal() && b.f == 0.) return a;
-			return new List(new BinaryOpZGen(th, this, a, b));
+			return newBinaryOpZList(th, this, a, b);
 		}
 	};
 	BinaryOp_plus gBinaryOp_plus;
@@ -1127,9 +1293,9 @@ DEFINE_BINOP_FLOATVV1(nextafter, nextafter(a, b), vvnextafter(out, const_cast<Z*
 
 		virtual V makeZList(Thread& th, Arg a, Arg b)
 		{
-			if (a.isReal() && a.f == 0.) return new List(new UnaryOpZGen(th, &gUnaryOp_neg, b));
+			if (a.isReal() && a.f == 0.) return newUnaryOpZList(th, &gUnaryOp_neg, b);
 			if (b.isReal() && b.f == 0.) return a;
-			return new List(new BinaryOpZGen(th, this, a, b));
+			return newBinaryOpZList(th, this, a, b);
 		}
 	};
 	BinaryOp_minus gBinaryOp_minus;
@@ -1211,15 +1377,15 @@ DEFINE_BINOP_FLOATVV1(nextafter, nextafter(a, b), vvnextafter(out, const_cast<Z*
 		{
 			if (a.isReal()) {
 				if (a.f == 1.) return b;
-				if (a.f == 0.) return new List(new UnaryOpZGen(th, &gUnaryOp_ToZero, b));
-				if (a.f == -1.) return new List(new UnaryOpZGen(th, &gUnaryOp_neg, b));
+				if (a.f == 0.) return newUnaryOpZList(th, &gUnaryOp_ToZero, b);
+				if (a.f == -1.) return newUnaryOpZList(th, &gUnaryOp_neg, b);
 			}
 			if (b.isReal()) {
 				if (b.f == 1.) return a;
-				if (b.f == 0.) return new List(new UnaryOpZGen(th, &gUnaryOp_ToZero, a));
-				if (b.f == -1.) return new List(new UnaryOpZGen(th, &gUnaryOp_neg, a));
+				if (b.f == 0.) return newUnaryOpZList(th, &gUnaryOp_ToZero, a);
+				if (b.f == -1.) return newUnaryOpZList(th, &gUnaryOp_neg, a);
 			}
-			return new List(new BinaryOpZGen(th, this, a, b));
+			return newBinaryOpZList(th, this, a, b);
 		}
 	};
 	BinaryOp_mul gBinaryOp_mul;
@@ -1276,9 +1442,9 @@ DEFINE_BINOP_FLOATVV1(nextafter, nextafter(a, b), vvnextafter(out, const_cast<Z*
 
 		virtual V makeZList(Thread& th, Arg a, Arg b)
 		{
-			if (a.isReal() && a.f == 0.) return new List(new UnaryOpZGen(th, &gUnaryOp_ToZero, b));
+			if (a.isReal() && a.f == 0.) return newUnaryOpZList(th, &gUnaryOp_ToZero, b);
 			if (b.isReal() && b.f == 1.) return a;
-			return new List(new BinaryOpZGen(th, this, a, b));
+			return newBinaryOpZList(th, this, a, b);
 		}
 	};
 	BinaryOp_div gBinaryOp_div;
@@ -1330,7 +1496,7 @@ DEFINE_BINOP_INT(iwrap2, sc_iwrap(a, -b, b))
 DEFINE_BINOP_INT(ifold2, sc_ifold(a, -b, b))
 DEFINE_BINOP_FLOAT(excess, a - std::clamp(a, -b, b))
 
-DEFINE_BINOP_FLOAT(clip0, std::clamp(a, 0., b))
+DEFINE_BINOP_FLOAT(clip0, std::clamp<Z>(a, 0., b))
 DEFINE_BINOP_FLOAT(wrap0, sc_wrap(a, 0., b))
 DEFINE_BINOP_FLOAT(fold0, sc_fold(a, 0., b))
 
@@ -1362,6 +1528,8 @@ void AddMathOps()
 	fillDecayTable();
     fillFirstOrderCoeffTable();
 
+	vm.defPure = true;
+
 	vm.addBifHelp("\n*** unary math ops ***");
 	DEF(isalnum, "return whether an ASCII value is alphanumeric.")
 	DEF(isalpha, "return whether an ASCII value is alphabetic.")
@@ -1389,6 +1557,7 @@ void AddMathOps()
 	DEFN(iseven, "even?", "is even.")
 	DEFN(isodd, "odd?", "is odd.")
 	DEFN(isprime, "prime?", "is prime.")
+	DEF(nthprime, "the nth prime number, counting from zero.")
 	DEFN(isint, "int?", "is integer.")
 	
 	DEF(isfinite, "is x a finite number.")
@@ -1593,5 +1762,6 @@ void AddMathOps()
 	DEF2(roundUp, "round x to nearest multiple of y >= x.")
 	DEF2(trunc, "round x to nearest multiple of y <= x")
 
+	vm.defPure = false;
 }
 
@@ -21,12 +21,40 @@
 #include "Opcode.hpp"
 #include <algorithm>
 #include <cstdarg>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static thread_local std::string* gPostCapture = nullptr;
+
+PostCapture::PostCapture(std::string& out) : mSaved(gPostCapture) { gPostCapture = &out; }
+PostCapture::~PostCapture() { gPostCapture = mSaved; }
 
 void post(const char* fmt, ...)
 {
     va_list vargs;
     va_start(vargs, fmt);
-    vprintf(fmt, vargs);
+	if (gPostCapture) {
+		char s[1024];
+		va_list vargs2;
+		va_copy(vargs2, vargs);
+		int n = vsnprintf(s, sizeof(s), fmt, vargs);
+		if (n >= (int)sizeof(s)) {
+			std::vector<char> big(n + 1);
+			vsnprintf(big.data(), n + 1, fmt, vargs2);
+			gPostCapture->append(big.data(), n);
+		} else if (n > 0) {
+			gPostCapture->append(s, n);
+		}
+		va_end(vargs2);
+	} else {
+		vprintf(fmt, vargs);
+	}
+	va_end(vargs);
 }
 
 void zprintf(std::string& out, const char* fmt, ...)
@@ -370,6 +398,113 @@ bool Form::get(Thread& th, Arg key, V& value) const
     return false;
 }
 
+bool Form::get(Thread& th, Arg key, V& value, FormLookupCache& cache) const
+{
+	if (cache.lookup(this, value))
+		return true;
+
+	const Form* e = this;
+	int64_t hash = key.Hash();
+	int depth = 0;
+	do {
+		size_t index;
+		if (e->mTable() && e->mTable->mMap->getIndex(key, hash, index)) {
+			value = e->mTable->mValues[index];
+			cache.update(this, depth, index);
+			return true;
+		}
+		e = (Form*)e->mNextForm();
+		++depth;
+	} while (e);
+	return false;
+}
+
+bool Form::dot(Thread& th, Arg key, V& ioValue, FormLookupCache& cache)
+{
+	V value;
+	if (get(th, key, value, cache)) {
+		ioValue = value.msgSend(th, V(this));
+		return true;
+	} else {
+		return false;
+	}
+}
+
+bool FormLookupCache::lookup(const Form* form, V& outValue) const
+{
+	uint32_t seq = mSeq.load(std::memory_order_acquire);
+	if (seq & 1) return false;
+	int depth = mDepth.load(std::memory_order_relaxed);
+	if (depth < 0) return false;
+
+	const Form* e = form;
+	for (int i = 0; ; ++i) {
+		Table* table = e->mTable();
+		if (!table || table->mMap->mShapeId != mShapeIds[i].load(std::memory_order_relaxed))
+			return false;
+		if (i == depth) break;
+		e = e->mNextForm();
+		if (!e) return false;
+	}
+	size_t index = mIndex.load(std::memory_order_relaxed);
+
+	std::atomic_thread_fence(std::memory_order_acquire);
+	if (mSeq.load(std::memory_order_relaxed) != seq)
+		return false;
+
+	// the map at this depth is the one the index was found in, so the index is in range.
+	outValue = e->mTable->mValues[index];
+	return true;
+}
+
+void FormLookupCache::update(const Form* form, int depth, size_t index)
+{
+	if (depth >= kFormLookupCacheDepth) return;
+
+	uint32_t seq = mSeq.load(std::memory_order_relaxed);
+	if ((seq & 1) || !mSeq.compare_exchange_strong(seq, seq + 1, std::memory_order_acquire))
+		return; // another thread is updating.
+
+	const Form* e = form;
+	for (int i = 0; i <= depth; ++i) {
+		mShapeIds[i].store(e->mTable->mMap->mShapeId, std::memory_order_relaxed);
+		e = e->mNextForm();
+	}
+	mDepth.store(depth, std::memory_order_relaxed);
+	mIndex.store(index, std::memory_order_relaxed);
+
+	mSeq.store(seq + 2, std::memory_order_release);
+}
+
+bool InheritanceMemo::find(size_t numArgs, V* args, P<Form>& outResult)
+{
+	if (numArgs > kMaxParents) return false;
+	for (Entry& entry : entries) {
+		if (entry.numParents != numArgs) continue;
+		size_t i = 0;
+		for (; i < numArgs; ++i) {
+			if (args[i].o() != entry.parents[i]()) break;
+		}
+		if (i == numArgs) {
+			outResult = entry.result;
+			return true;
+		}
+	}
+	return false;
+}
+
+void InheritanceMemo::add(size_t numArgs, V* args, P<Form> const& result)
+{
+	if (numArgs > kMaxParents) return;
+	Entry& entry = entries[next];
+	next = (next + 1) % kNumEntries;
+	
+	entry.numParents = numArgs;
+	for (size_t i = 0; i < kMaxParents; ++i) {
+		entry.parents[i] = i < numArgs ? P<Form>((Form*)args[i].o()) : nullptr;
+	}
+	entry.result = result;
+}
 
 V Form::mustGet(Thread& th, Arg key) const
 {
@@ -616,7 +751,7 @@ V List::unaryOp(Thread& th, UnaryOp* op)
 	if (isVList())
 		return new List(new UnaryOpGen(th, op, this));
 	else
-		return new List(new UnaryOpZGen(th, op, this));
+		return newUnaryOpZList(th, op, this);
 		
 }
 
@@ -948,7 +1083,8 @@ void V::printDebug(Thread& th, int depth) const
 }
 
 Gen::Gen(Thread& th, int inItemType, bool inFinite)
-	: mDone(false), mOut(0), mBlockSize(inItemType == itemTypeV ? vm.VblockSize : th.rate.blockSize)
+	: mDone(false), mReadAhead(inItemType != itemTypeV), mOut(0),
+	mBlockSize(inItemType == itemTypeV ? vm.VblockSize : th.rate.blockSize), mMaxBlockSize(mBlockSize)
 {
 	elemType = inItemType;
 	setFinite(inFinite);
@@ -983,6 +1119,37 @@ void Gen::produce(int shrinkBy)
 	mOut = mOut->nextp();
 }
 
+void Gen::setReadAhead()
+{
+	mReadAhead = true;
+	if (elemType == itemTypeV)
+		mMaxBlockSize = std::max(mBlockSize, kMaxVBlockSize);
+}
+
+void Gen::setReadAhead(Arg a)
+{
+	if (canReadAhead(a)) setReadAhead();
+}
+
+void Gen::setReadAhead(Arg a, Arg b)
+{
+	if (canReadAhead(a) && canReadAhead(b)) setReadAhead();
+}
+
+const int kMaxReadAheadProbe = 64;
+
+bool canReadAhead(Arg a)
+{
+	if (!a.isList()) return true;
+	List* list = (List*)a.o();
+	for (int i = 0; list && i < kMaxReadAheadProbe; ++i) {
+		SpinLocker lock(list->mSpinLock);
+		if (list->mGen) return list->mGen->readsAhead();
+		list = list->nextp();
+	}
+	return !list;
+}
+
 void List::end()
 {
 	assert(mGen);
@@ -1068,6 +1235,7 @@ void List::force(Thread& th)
 			gen->end();
 		} else {
 			gen->pull(th);
+			gen->grow();
 		}
 		// mGen should be NULL at this point because one of the following should have been called: fulfill, link, end.
 	}
@@ -1095,6 +1263,9 @@ Array::~Array()
 {
 	if (isV()) {
 		delete [] vv;
+	} else if (mMapBytes) {
+		munmap(p, mMapBytes);
+		if (mFd >= 0) close(mFd);
 	} else {
 		free(p);
 	}
@@ -1110,11 +1281,125 @@ void Array::alloc(int64_t inCap)
 		for (int64_t i = 0; i < size(); ++i) 
 			vv[i] = oldv[i];
 		delete [] oldv;
+	} else if (mMapBytes || mCap * (int64_t)sizeof(Z) >= kMinMappedArrayBytes) {
+		allocMapped();
 	} else {
 		p = realloc(p, mCap * elemSize());
 	}
 }
 
+static int openSpillFile()
+{
+	const char* dir = getenv("SAPF_SPILL");
+	if (!dir || strlen(dir)==0) dir = "/tmp";
+	char path[1024];
+	snprintf(path, sizeof(path), "%s/sapf-spill-XXXXXX", dir);
+	int fd = mkstemp(path);
+	if (fd >= 0) unlink(path);
+	return fd;
+}
+
+// a spill file is mapped shared, so a write to a page the file system can't back raises SIGBUS.
+// its blocks are reserved up front instead, so that a full disk is seen here.
+static bool reserveSpill(int fd, size_t bytes)
+{
+#if __APPLE__
+	struct stat st;
+	if (fstat(fd, &st)) return false;
+	if ((off_t)bytes > st.st_size) {
+		fstore_t store = { F_ALLOCATEALL, F_PEOFPOSMODE, 0, (off_t)bytes - st.st_size, 0 };
+		if (fcntl(fd, F_PREALLOCATE, &store) == -1) return false;
+	}
+	return ftruncate(fd, bytes) == 0;
+#else
+	return posix_fallocate(fd, 0, bytes) == 0;
+#endif
+}
+
+void Array::allocMapped()
+{
+	size_t pageSize = sysconf(_SC_PAGESIZE);
+	size_t bytes = (mCap * sizeof(Z) + pageSize - 1) & ~(pageSize - 1);
+
+	void* newp = MAP_FAILED;
+	if (mFd >= 0) {
+		// the spill file keeps the contents, so growing only needs a longer file and a new mapping.
+		if (reserveSpill(mFd, bytes))
+			newp = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, mFd, 0);
+		if (newp != MAP_FAILED) {
+			munmap(p, mMapBytes);
+			p = newp;
+			mMapBytes = bytes;
+			return;
+		}
+	}
+
+	// moving from the heap, a mapped input file or a spill file that could not grow, to a new spill file.
+	int fd = openSpillFile();
+	if (fd >= 0) {
+		if (reserveSpill(fd, bytes))
+			newp = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		if (newp == MAP_FAILED) {
+			close(fd);
+			fd = -1;
+		}
+	}
+	if (newp == MAP_FAILED) {
+		// no room for a spill file. keep the array on the heap.
+		if (!mMapBytes) {
+			newp = realloc(p, mCap * sizeof(Z));
+			if (!newp) throw std::bad_alloc();
+			p = newp;
+			return;
+		}
+		newp = malloc(mCap * sizeof(Z));
+		if (!newp) throw std::bad_alloc();
+		bytes = 0;
+	}
+	memcpy(newp, p, mSize * sizeof(Z));
+	if (mMapBytes) munmap(p, mMapBytes);
+	else free(p);
+	if (mFd >= 0) close(mFd);
+	p = newp;
+	mMapBytes = bytes;
+	mFd = fd;
+}
+
+P<Array> Array::mapZFile(const char* path)
+{
+	int fd = open(path, O_RDONLY);
+	if (fd < 0) {
+		post("could not open '%s'\n", path);
+		throw errFailed;
+	}
+	struct stat st;
+	if (fstat(fd, &st)) {
+		close(fd);
+		throw errFailed;
+	}
+	if (st.st_size % sizeof(Z)) {
+		close(fd);
+		post("'%s' is not a whole number of %d byte samples\n", path, (int)sizeof(Z));
+		throw errFailed;
+	}
+	P<Array> a = new Array(itemTypeZ, 0);
+	if (st.st_size == 0) {
+		close(fd);
+		return a;
+	}
+	void* m = mmap(nullptr, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (m == MAP_FAILED) {
+		post("could not map '%s'\n", path);
+		throw errFailed;
+	}
+	free(a->p);
+	a->p = m;
+	a->mMapBytes = st.st_size;
+	a->mCap = a->mSize = st.st_size / sizeof(Z);
+	return a;
+}
+
 void Array::add(Arg inItem)
 {
 	if (mSize >= mCap)
@@ -1274,6 +1559,9 @@ void ZIn::set(Arg inValue)
 		mList = nullptr;
 		mConstant = inValue;
 		mIsConstant = true;
+#if !SAMPLE_IS_DOUBLE
+		mConstantZ = mConstant.f;
+#endif
 	}
 }
 
@@ -1311,7 +1599,11 @@ bool ZIn::operator()(Thread& th, int& ioNum, int& outStride, Z*& outBuffer)
 {
 	if (mIsConstant) {
 		outStride = 0;
+#if SAMPLE_IS_DOUBLE
 		outBuffer = &mConstant.f;
+#else
+		outBuffer = &mConstantZ;
+#endif
 		return false;
 	}
 	if (mList) {
@@ -1334,7 +1626,12 @@ bool ZIn::operator()(Thread& th, int& ioNum, int& outStride, Z*& outBuffer)
 	}
 	mConstant = 0.;
 	outStride = 0;
+#if SAMPLE_IS_DOUBLE
 	outBuffer = &mConstant.f;
+#else
+	mConstantZ = 0.;
+	outBuffer = &mConstantZ;
+#endif
     ioNum = 0;
 	mDone = true;
 	return true;
@@ -1596,10 +1893,14 @@ bool ZIn::fill(Thread& th, int& ioNum, Z* outBuffer, int outStride)
 			ioNum = framesFilled;
 			return true;
 		}
-		for (int i = 0, j = 0, k = 0; i < n; ++i)	{
-			outBuffer[k] = a[j];
-			j += astride;
-			k += outStride;
+		if (astride == 1 && outStride == 1) {
+			memcpy(outBuffer, a, n * sizeof(Z));
+		} else {
+			for (int i = 0, j = 0, k = 0; i < n; ++i)	{
+				outBuffer[k] = a[j];
+				j += astride;
+				k += outStride;
+			}
 		}
 		framesToFill -= n;
 		framesFilled += n;
@@ -1610,6 +1911,7 @@ bool ZIn::fill(Thread& th, int& ioNum, Z* outBuffer, int outStride)
 	return false;
 }
 
+#if SAMPLE_IS_DOUBLE
 bool ZIn::fill(Thread& th, int& ioNum, float* outBuffer, int outStride)
 {
 	int framesToFill = ioNum;
@@ -1639,6 +1941,7 @@ bool ZIn::fill(Thread& th, int& ioNum, float* outBuffer, int outStride)
 	ioNum = framesFilled;
 	return false;
 }
+#endif
 
 void ZIn::hop(Thread& th, int framesToAdvance)
 {
@@ -1922,13 +2225,90 @@ List::List(P<Array> const& inArray, P<List> const& inNext)
 	setFinite(!mNext || mNext->isFinite());
 }
 
+// dropping a long signal frees every node, array and generator in the chain.
+// past the first few nodes that work is handed to a reclaimer thread, which frees the chains it is given.
+// ~List can run on the audio thread, so handing a chain over neither locks nor allocates. chains go through a fixed size
+// lock free queue, and are freed where they are dropped when the queue is full or the reclaimer has not been started.
+const int kMaxInlineListFree = 64;
+const int kListReclaimerQueueSize = 1024; // a power of two.
+
+static thread_local bool gReclaiming = false;
+
+class ListReclaimer
+{
+	// a cell's sequence number is its position in the queue while it is free to write,
+	// and one past its position once it holds a chain for the reclaimer.
+	struct Cell
+	{
+		std::atomic<int64_t> seq;
+		P<List> list;
+	};
+	Cell mCells[kListReclaimerQueueSize];
+	std::atomic<int64_t> mWritePos;
+	int64_t mReadPos; // only used by the reclaimer thread.
+
+	void run()
+	{
+		gReclaiming = true;
+		while (true) {
+			Cell& cell = mCells[mReadPos & (kListReclaimerQueueSize - 1)];
+			if (cell.seq.load(std::memory_order_acquire) != mReadPos + 1) {
+				std::this_thread::sleep_for(std::chrono::milliseconds(2));
+				continue;
+			}
+			P<List> list = std::move(cell.list);
+			cell.seq.store(mReadPos + kListReclaimerQueueSize, std::memory_order_release);
+			++mReadPos;
+		}
+	}
+public:
+	ListReclaimer() : mWritePos(0), mReadPos(0)
+	{
+		for (int i = 0; i < kListReclaimerQueueSize; ++i)
+			mCells[i].seq.store(i, std::memory_order_relaxed);
+		std::thread([this]{ run(); }).detach();
+	}
+
+	// takes the chain and returns true, or returns false if the queue is full.
+	bool add(P<List>& list)
+	{
+		int64_t pos = mWritePos.load(std::memory_order_relaxed);
+		while (true) {
+			Cell& cell = mCells[pos & (kListReclaimerQueueSize - 1)];
+			int64_t seq = cell.seq.load(std::memory_order_acquire);
+			if (seq == pos) {
+				if (mWritePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+					cell.list = std::move(list);
+					cell.seq.store(pos + 1, std::memory_order_release);
+					return true;
+				}
+			} else if (seq < pos) {
+				return false;
+			} else {
+				pos = mWritePos.load(std::memory_order_relaxed);
+			}
+		}
+	}
+};
+
+// never destroyed, so that the reclaimer thread can outlive static destruction at exit.
+static ListReclaimer* gListReclaimer = nullptr;
+
+void startListReclaimer()
+{
+	if (!gListReclaimer) gListReclaimer = new ListReclaimer;
+}
+
 List::~List()
 {
 	// free as much tail as possible at once in order to prevent stack overflow.
 	P<List> list = mNext;
 	mNext = nullptr;
-	while (list) {
+	for (int i = 0; list; ++i) {
 		if (list->getRefcount() > 1) break;
+		if (i == kMaxInlineListFree && !gReclaiming && gListReclaimer && gListReclaimer->add(list)) {
+			break;
+		}
 		P<List> next = list->mNext;
 		list->mNext = nullptr;
 		list = next;
@@ -1958,7 +2338,7 @@ List* List::pack(Thread& th)
 	if (isPacked())
 		return this;
 		
-	int cap = 0;
+	int64_t cap = 0;
 	P<List> list = this;
 	while(list) {
 		list->force(th);
@@ -1985,7 +2365,7 @@ List* List::packz(Thread& th)
 	if (isPacked() && isZ())
 		return this;
 		
-	int cap = 0;
+	int64_t cap = 0;
 	P<List> list = this;
 	while(list) {
 		list->force(th);
@@ -2012,7 +2392,7 @@ List* List::pack(Thread& th, int limit)
 	if (isPacked())
 		return this;
 		
-	int cap = 0;
+	int64_t cap = 0;
 	P<List> list = this;
 	while(list) {
 		list->force(th);
@@ -2109,8 +2489,10 @@ V Fun::msgSend(Thread& th, Arg receiver)
 	}
 }
 	
+std::atomic<int64_t> gTableMapShapeId(0);
+
 TableMap::TableMap(size_t inSize)
-	: mSize(inSize)
+	: mSize(inSize), mShapeId(++gTableMapShapeId)
 {
 	if (inSize == 0) {
 		mMask = 0;
@@ -2125,7 +2507,7 @@ TableMap::TableMap(size_t inSize)
 }
 
 TableMap::TableMap(Arg inKey)
-	: mSize(1)
+	: mSize(1), mShapeId(++gTableMapShapeId)
 {
 	mMask = 1;
 	mIndices = new size_t[2]();
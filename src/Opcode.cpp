@@ -149,14 +149,28 @@ void Thread::run(Opcode* opc)
 
 				case opDot : {
 					V ioValue;
-					if (!pop().dot(th, v, ioValue))
+					V receiver = pop();
+					bool found = receiver.isForm()
+						? ((Form*)receiver.o())->dot(th, v, ioValue, *opc->cache)
+						: receiver.dot(th, v, ioValue);
+					if (!found)
 						notFound(v);
 					push(ioValue);
 					break;
 				}
-				case opComma :
-					push(pop().comma(th, v));
-					break;
+				case opComma : {
+					V receiver = pop();
+					if (receiver.isForm()) {
+						V value;
+						if (!((Form*)receiver.o())->get(th, v, value, *opc->cache)) {
+							post("not found: ");
+							throw errNotFound;
+						}
+						push(value);
+					} else {
+						push(receiver.comma(th, v));
+					}
+				} break;
 					
 				case opBindLocal :
 					getLocal(v.i) = pop();
@@ -164,7 +178,7 @@ void Thread::run(Opcode* opc)
 				case opBindWorkspaceVar : {
                     V value = pop();
                     if (value.isList() && !value.isFinite()) {
-                        post("WARNING: binding a possibly infinite list at the top level can leak unbounded memory!\n");
+                        post("WARNING: binding a possibly infinite list at the top level can leak unbounded memory! bind it through live to let read blocks go.\n");
                     } else if (value.isFun()) {
 						const char* mask = value.GetAutoMapMask();
 						const char* help = value.OneLineHelp();
@@ -196,7 +210,7 @@ void Thread::run(Opcode* opc)
 							} else if (opc->op == opBindWorkspaceVarFromList) {
 								v = opc->v;
 								if (value.isList() && !value.isFinite()) {
-									post("WARNING: binding a possibly infinite list at the top level can leak unbounded memory!\n");
+									post("WARNING: binding a possibly infinite list at the top level can leak unbounded memory! bind it through live to let read blocks go.\n");
 								} else if (value.isFun()) {
 									const char* mask = value.GetAutoMapMask();
 									const char* help = value.OneLineHelp();
@@ -308,6 +322,9 @@ void Code::shrinkToFit()
 void Code::add(int _op, Arg v)
 {
 	ops.push_back(Opcode(_op, v));
+	if (_op == opDot || _op == opComma) {
+		ops.back().cache = new FormLookupCache();
+	}
 }
 
 void Code::add(int _op, double f)
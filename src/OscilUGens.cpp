@@ -21,11 +21,14 @@
 #include "VM.hpp"
 #include "clz.hpp"
 #include "dsp.hpp"
+#include "WaveTableCache.hpp"
 #include <climits>
 #include <cmath>
 #include <float.h>
 #include <vector>
+#include <memory>
 #include <algorithm>
+#include <thread>
 #ifdef SAPF_ACCELERATE
 #include <Accelerate/Accelerate.h>
 #else
@@ -81,7 +84,7 @@ static void normalize(int n, Z* buf)
 {
 	Z maxabs = 0.;
 	for (int i = 0; i < n; ++i) {
-		maxabs = std::max(maxabs, fabs(buf[i]));
+		maxabs = std::max<Z>(maxabs, fabs(buf[i]));
 	}
 	if (maxabs > 0.) {
 		Z scale = 1. / maxabs;
@@ -91,15 +94,17 @@ static void normalize(int n, Z* buf)
 	}
 }
 
-static void fillWaveTable(int n, Z* amps, int ampStride, Z* phases, int phaseStride, Z smooth, Z* table)
+const int kWaveTableScratchSize = 3 * kWaveTableSize;
+
+static void fillWaveTable(FFT& fft, Z* scratch, int n, const Z* amps, int ampStride, const Z* phases, int phaseStride, Z smooth, Z* table)
 {
 	const size_t kWaveTableSize2 = kWaveTableSize / 2;
 	const Z two_pi = 2. * M_PI;
 	
-	Z real[kWaveTableSize2];
-	Z imag[kWaveTableSize2];
-	Z polar[kWaveTableSize];
-	Z rect[kWaveTableSize];
+	Z* real = scratch;
+	Z* imag = real + kWaveTableSize2;
+	Z* polar = imag + kWaveTableSize2;
+	Z* rect = polar + kWaveTableSize;
 	
 	zeroTable(kWaveTableSize2, real);
 	zeroTable(kWaveTableSize2, imag);
@@ -132,33 +137,88 @@ static void fillWaveTable(int n, Z* amps, int ampStride, Z* phases, int phaseStr
 		imag[i] = radius * sin(angle);
 	}
 #endif // SAPF_ACCELERATE
-	rifft(kWaveTableSize, real, imag, table);
+	fft.backward_real(real, imag, table);
 }
 
-static void fill3rdOctaveTables(int n, Z* amps, int ampStride, Z* phases, int phaseStride, Z smooth, Z* tables)
+static void fill3rdOctaveTables(int n, const Z* amps, int ampStride, const Z* phases, int phaseStride, Z smooth, Z* tables)
 {	
 	// tables is assumed to be allocated to kNumTables * kWaveTableSize samples
-	for (int i = 0; i < kNumTables; ++i) {
-		int numHarmonics = std::min(n, gNumHarmonicsForTable[i]);
-		fillWaveTable(numHarmonics, amps, ampStride, phases, phaseStride, smooth, tables + i * kWaveTableSize);
+	// the tables are independent, so they are divided among several threads.
+	// each thread has its own FFT because an FFT keeps its work buffers in the object.
+	const int log2n = 64 - __builtin_clzll(kWaveTableSize - 1);
+	int numThreads = std::clamp((int)std::thread::hardware_concurrency(), 1, kNumTables);
+	std::vector<FFT> ffts(numThreads);
+	for (FFT& fft : ffts) fft.init(log2n);
+	
+	auto fillSome = [&](int first) {
+		std::vector<Z> scratch(kWaveTableScratchSize);
+		for (int i = first; i < kNumTables; i += numThreads) {
+			int numHarmonics = std::min(n, gNumHarmonicsForTable[i]);
+			fillWaveTable(ffts[first], scratch.data(), numHarmonics, amps, ampStride, phases, phaseStride, smooth, tables + i * kWaveTableSize);
+		}
+	};
+	
+	std::vector<std::thread> threads;
+	for (int i = 1; i < numThreads; ++i) {
+		threads.emplace_back(fillSome, i);
+	}
+	fillSome(0);
+	for (std::thread& thread : threads) {
+		thread.join();
 	}
 	
 	normalize(kWaveTableTotalSize, tables);
 }
 
-static P<List> makeWavetable(int n, Z* amps, int ampStride, Z* phases, int phaseStride, Z smooth)
+static P<List> makeWavetable(int n, const Z* amps, int ampStride, const Z* phases, int phaseStride, Z smooth)
 {
 	P<List> list = new List(itemTypeZ, kWaveTableTotalSize);
 	P<Array> array = list->mArray;
 	
 	Z* tables = array->z();
-		
-	fill3rdOctaveTables(n, amps, ampStride, phases, phaseStride, smooth, tables);
+	
+	int64_t key = hashWaveTableSpec(n, amps, ampStride, phases, phaseStride, smooth, kWaveTableSize, kNumTables);
+	if (!readWaveTableCache(key, tables, kWaveTableTotalSize)) {
+		fill3rdOctaveTables(n, amps, ampStride, phases, phaseStride, smooth, tables);
+		writeWaveTableCache(key, tables, kWaveTableTotalSize);
+	}
 	array->setSize(kWaveTableTotalSize);
 	
 	return list;
 }
 
+// a wave table that is not computed until it is first used.
+class WaveTableGen : public Gen
+{
+	std::vector<Z> mAmps;
+	std::vector<Z> mPhases;
+	Z mSmooth;
+	
+public:
+	WaveTableGen(Thread& th, int n, const Z* amps, int ampStride, const Z* phases, int phaseStride, Z smooth)
+		: Gen(th, itemTypeZ, true), mAmps(n), mPhases(n), mSmooth(smooth)
+	{
+		for (int i = 0; i < n; ++i) {
+			mAmps[i] = amps[i * ampStride];
+			mPhases[i] = phases[i * phaseStride];
+		}
+	}
+	
+	virtual const char* TypeName() const override { return "WaveTableGen"; }
+	
+	virtual void pull(Thread& th) override
+	{
+		P<List> list = makeWavetable((int)mAmps.size(), mAmps.data(), 1, mPhases.data(), 1, mSmooth);
+		setDone();
+		mOut->link(th, list());
+	}
+};
+
+static P<List> makeLazyWavetable(Thread& th, int n, const Z* amps, int ampStride, const Z* phases, int phaseStride, Z smooth)
+{
+	return new List(new WaveTableGen(th, n, amps, ampStride, phases, phaseStride, smooth));
+}
+
 static void wavefill_(Thread& th, Prim* prim)
 {
 	Z smooth = th.popFloat("wavefill : smooth");
@@ -168,6 +228,7 @@ static void wavefill_(Thread& th, Prim* prim)
 	P<List> ampl;
 	P<List> phasel;
 	Z *phasez, *ampz;
+	Z phase1, amp1;
 	int phaseStride, ampStride; 
 	int64_t n = kMaxHarmonics;
 	if (phases.isZList()) {
@@ -175,7 +236,8 @@ static void wavefill_(Thread& th, Prim* prim)
 		phasez = phasel->mArray->z();
 		phaseStride = 1;
 	} else {
-		phasez = &phases.f;
+		phase1 = phases.f;
+		phasez = &phase1;
 		phaseStride = 0;
 	}
 	
@@ -184,7 +246,8 @@ static void wavefill_(Thread& th, Prim* prim)
 		ampz = ampl->mArray->z();
 		ampStride = 1;
 	} else {
-		ampz = &amps.f;
+		amp1 = amps.f;
+		ampz = &amp1;
 		ampStride = 0;
 	}
 	
@@ -199,7 +262,8 @@ P<List> gSawtoothTable;
 
 static void makeClassicWavetables()
 {
-	//fprintf(stdout, "computing wave tables\n");
+	// the classic tables are described here and computed when first played.
+	Thread th;
 	Z amps[kMaxHarmonics+1];
 	Z phases[kMaxHarmonics+1];
 	Z smooth = 0.;
@@ -208,7 +272,7 @@ static void makeClassicWavetables()
 		amps[i] = 1. / (i*i);		++i;
 	}
 	phases[0] = .25;
-	gParabolicTable = makeWavetable(kMaxHarmonics, amps+1, 1, phases, 0, smooth);
+	gParabolicTable = makeLazyWavetable(th, kMaxHarmonics, amps+1, 1, phases, 0, smooth);
 
 	for (int i = 1; i <= kMaxHarmonics; ) {
 		amps[i] = 1. / (i*i);		++i; if (i > kMaxHarmonics) break;
@@ -218,14 +282,14 @@ static void makeClassicWavetables()
 	}
 
 	phases[0] = 0.;
-	gTriangleTable = makeWavetable(kMaxHarmonics, amps+1, 1, phases, 0, smooth);
+	gTriangleTable = makeLazyWavetable(th, kMaxHarmonics, amps+1, 1, phases, 0, smooth);
 	
 	for (int i = 1; i <= kMaxHarmonics; ) {
 		amps[i] = 1. / i;		++i;  if (i > kMaxHarmonics) break;
 		amps[i] = 0.;			++i;
 	}
 	phases[0] = 0.;
-	gSquareTable = makeWavetable(kMaxHarmonics, amps+1, 1, phases, 0, smooth);
+	gSquareTable = makeLazyWavetable(th, kMaxHarmonics, amps+1, 1, phases, 0, smooth);
 	
 	for (int i = 1; i <= kMaxHarmonics; ) {
 		amps[i] = 1. / i;		++i;
@@ -234,15 +298,13 @@ static void makeClassicWavetables()
 		phases[i] = 0.;		++i;
 		phases[i] = .5;		++i;
 	}
-	gSawtoothTable = makeWavetable(kMaxHarmonics, amps+1, 1, phases+1, 1, smooth);
+	gSawtoothTable = makeLazyWavetable(th, kMaxHarmonics, amps+1, 1, phases+1, 1, smooth);
 	
 	vm.addBifHelp("\n*** classic wave tables ***");
 	vm.def("parTbl", gParabolicTable);		vm.addBifHelp("parTbl - parabolic wave table.");
 	vm.def("triTbl", gTriangleTable);		vm.addBifHelp("triTbl - triangle wave table.");
 	vm.def("sqrTbl", gSquareTable);			vm.addBifHelp("sqrTbl - square wave table.");
 	vm.def("sawTbl", gSawtoothTable);		vm.addBifHelp("sawTbl - sawtooth wave table.");
-
-	//fprintf(stdout, "done computing wave tables\n");
 }
 
 
@@ -444,6 +506,7 @@ struct OscFMPM : public TwoInputUGen<OscFMPM>
 
 static void newOsc(Thread& th, Arg freq, Arg phase, P<List> const& tables)
 {
+	tables->force(th);
 	if (freq.isZList()) {
 		if (phase.isZList()) {
 			th.push(new List(new OscFMPM(th, tables->mArray, freq, phase)));
@@ -466,6 +529,7 @@ static void osc_(Thread& th, Prim* prim)
 	V phase = th.popZIn("osc : phase");
 	V freq = th.popZIn("osc : freq");
 
+	tables->force(th);
 	if (!tables->isPacked() || tables->length(th) != kWaveTableTotalSize) {
 		post("osc : tables is not a wave table. must be a signal of %d x %d samples.", kNumTables, kWaveTableSize);
 		throw errWrongType;
@@ -611,7 +675,7 @@ struct VarSaw : public ThreeInputUGen<VarSaw>
 			int index1 = (int)iphase1;
 			Z fracphase1 = pphase1 - iphase1;
 			
-			Z zduty = std::clamp(*duty, .01, .99);
+			Z zduty = std::clamp<Z>(*duty, .01, .99);
 			Z pphase2 = pphase1 + zduty * kWaveTableSizeF;
 			Z iphase2 = floor(pphase2);
 			int index2 = (int)iphase2;
@@ -643,6 +707,7 @@ static void oscp_(Thread& th, Prim* prim)
 	V phase = th.popZIn("oscp : phase");
 	V freq = th.popZIn("oscp : freq");
 
+	tables->force(th);
 	if (!tables->isPacked() || tables->length(th) != kWaveTableTotalSize) {
 		post("oscp : tables is not a wave table. must be a signal of %d x %d samples.", kNumTables, kWaveTableSize);
 		throw errWrongType;
@@ -658,6 +723,7 @@ static void pulse_(Thread& th, Prim* prim)
 	V freq = th.popZIn("pulse : freq");
 
 	P<List> tables = gSawtoothTable;
+	tables->force(th);
 
 	th.push(new List(new OscPWM(th, tables->mArray, freq, phase, duty)));
 }
@@ -669,6 +735,7 @@ static void vsaw_(Thread& th, Prim* prim)
 	V freq = th.popZIn("vsaw : freq");
 
 	P<List> tables = gParabolicTable;
+	tables->force(th);
 
 	th.push(new List(new VarSaw(th, tables->mArray, freq, phase, duty)));
 }
@@ -777,6 +844,7 @@ static void ssaw_(Thread& th, Prim* prim)
 	V freq1 = th.popZIn("ssaw : freq1");
 
 	P<List> tables = gSawtoothTable;
+	tables->force(th);
 
 	th.push(new List(new SyncOsc(th, tables->mArray, freq1, freq2)));
 }
@@ -787,6 +855,7 @@ static void sosc_(Thread& th, Prim* prim)
 	V freq2 = th.popZIn("sosc : freq2");
 	V freq1 = th.popZIn("sosc : freq1");
 
+	tables->force(th);
 	if (!tables->isPacked() || tables->length(th) != kWaveTableTotalSize) {
 		post("sosc : tables is not a wave table. must be a signal of %d x %d samples.", kNumTables, kWaveTableSize);
 		throw errWrongType;
@@ -809,7 +878,8 @@ struct LFSaw : public OneInputUGen<LFSaw>
 	
 	virtual const char* TypeName() const override { return "LFSaw"; }
 	
-	void calc(int n, Z* out, Z* freq, int freqStride) 
+	template <typename SF>
+	void calc(int n, Z* out, Z* freq, SF freqStride)
 	{
 		for (int i = 0; i < n; ++i) {
 			out[i] = phase;
@@ -1164,7 +1234,8 @@ struct SinOsc : public OneInputUGen<SinOsc>
 	
 	virtual const char* TypeName() const override { return "SinOsc"; }
 		
-	void calc(int n, Z* out, Z* freq, int freqStride) 
+	template <typename SF>
+	void calc(int n, Z* out, Z* freq, SF freqStride)
 	{
 #if SAPF_ACCELERATE
 		for (int i = 0; i < n; ++i) {
@@ -1589,7 +1660,7 @@ struct DSF3 : public FourInputUGen<DSF3>
 
 			//f(x)=x-x*sqrt(c^2+1)/sqrt(c^2*x^2+1)
 
-			Z a = std::clamp(*coef, -.9999, .9999);
+			Z a = std::clamp<Z>(*coef, -.9999, .9999);
 			Z a2 = a*a;
 			Z an1 = pow(a, N1);
 			Z scalePeak = (a - 1.)/(2.*an1 - a - 1.);
@@ -1647,9 +1718,229 @@ struct KlangOsc
 	Z phase;
 };
 
+// Partials whose frequency and amplitude are both constant are computed together by an oscillator bank.
+// Small banks use recursive quadrature oscillators in struct of arrays form, kKlangLanes partials at a time, which the compiler vectorizes.
+// Large banks are synthesized in the frequency domain: each partial is added to a spectrum as a few bins of the spectrum of a Hann window,
+// and the spectra are inverse transformed and overlap added. The window is Hann squared, whose side lobes fall off quickly enough that
+// a partial only needs a few bins. The cost per partial is then per frame rather than per sample.
+
+const int kKlangLanes = 8;
+const int kKlangFFTThreshold = 256; // constant partials at which the bank switches to inverse FFT synthesis.
+const int kKlangFFTLogSize = 10;
+const int kKlangFFTSize = 1 << kKlangFFTLogSize;
+const int kKlangFFTOverlap = 4;
+const int kKlangFFTHop = kKlangFFTSize / kKlangFFTOverlap;
+const int kKlangKernelHalfWidth = 8; // bins on each side of a partial.
+const int kKlangKernelRes = 512; // table points per bin.
+const int kKlangKernelSize = (kKlangKernelHalfWidth + 2) * kKlangKernelRes;
+
+static double gKlangKernel[kKlangKernelSize + 2];
+
+static double klangDirichlet(double d)
+{
+	const double N = kKlangFFTSize;
+	double den = sin(M_PI * d / N);
+	if (fabs(den) < 1e-12) return N - 1.;
+	return sin(M_PI * d * (N - 1.) / N) / den;
+}
+
+static void fillKlangKernel()
+{
+	// the spectrum of a centered periodic Hann squared window, 3/8 + 1/2 cos(x) + 1/8 cos(2x).
+	// overlapped by four, the windows sum to 3/2. the table is scaled for that and for rifft.
+	const double scale = (2. / 3.) / kKlangFFTSize;
+	for (int i = 0; i <= kKlangKernelSize + 1; ++i) {
+		double d = (double)i / kKlangKernelRes;
+		double k = .375 * klangDirichlet(d)
+				+ .25 * (klangDirichlet(d + 1.) + klangDirichlet(d - 1.))
+				+ .0625 * (klangDirichlet(d + 2.) + klangDirichlet(d - 2.));
+		gKlangKernel[i] = k * scale;
+	}
+}
+
+static inline double klangKernel(double d)
+{
+	double x = fabs(d) * kKlangKernelRes;
+	int i = (int)x;
+	if (i >= kKlangKernelSize) return 0.;
+	return lut(gKlangKernel, i, x - i);
+}
+
+class KlangBank
+{
+	// recursive oscillator state is kept in double in either build, so that it does not drift.
+	std::vector<double> mAmp, mCos, mSin, mCosW, mSinW;
+	
+public:
+	size_t size() const { return mAmp.size(); }
+
+	void add(double w, double amp, double phase)
+	{
+		mAmp.push_back(amp);
+		mCos.push_back(cos(phase));
+		mSin.push_back(sin(phase));
+		mCosW.push_back(cos(w));
+		mSinW.push_back(sin(w));
+	}
+	
+	void pad()
+	{
+		while (mAmp.size() % kKlangLanes) add(0., 0., 0.);
+	}
+
+	void fill(int n, Z* out)
+	{
+		for (size_t g = 0; g < mAmp.size(); g += kKlangLanes) {
+			double a[kKlangLanes], c[kKlangLanes], s[kKlangLanes], cw[kKlangLanes], sw[kKlangLanes];
+			for (int j = 0; j < kKlangLanes; ++j) {
+				a[j] = mAmp[g+j]; c[j] = mCos[g+j]; s[j] = mSin[g+j]; cw[j] = mCosW[g+j]; sw[j] = mSinW[g+j];
+			}
+			for (int i = 0; i < n; ++i) {
+				double p[kKlangLanes];
+				for (int j = 0; j < kKlangLanes; ++j) {
+					p[j] = a[j] * s[j];
+					double c1 = c[j] * cw[j] - s[j] * sw[j];
+					s[j] = c[j] * sw[j] + s[j] * cw[j];
+					c[j] = c1;
+				}
+				out[i] += ((p[0] + p[1]) + (p[2] + p[3])) + ((p[4] + p[5]) + (p[6] + p[7]));
+			}
+			// pull the oscillators back onto the unit circle.
+			for (int j = 0; j < kKlangLanes; ++j) {
+				double k = 1.5 - .5 * (c[j] * c[j] + s[j] * s[j]);
+				mCos[g+j] = c[j] * k;
+				mSin[g+j] = s[j] * k;
+			}
+		}
+	}
+};
+
+class KlangFFTBank
+{
+	std::vector<double> mBin; // frequency in bins
+	std::vector<double> mW;
+	std::vector<double> mAmp;
+	std::vector<double> mPhase; // phase at the start of the next frame
+	std::vector<Z> mOLA; // kKlangFFTSize
+	std::vector<Z> mFrame, mReal, mImag;
+	std::unique_ptr<FFT> mFFT; // not the shared ffts[], which other threads may be using.
+	int mReadPos = kKlangFFTHop;
+
+	void addFrame();
+	
+public:
+	size_t size() const { return mAmp.size(); }
+
+	void add(double w, double amp, double phase)
+	{
+		// a negative frequency is the same partial with the phase and sign reversed.
+		if (w < 0.) {
+			w = -w;
+			phase = -phase;
+			amp = -amp;
+		}
+		mBin.push_back(w * kKlangFFTSize / kTwoPi);
+		mW.push_back(w);
+		mAmp.push_back(amp);
+		mPhase.push_back(phase);
+	}
+	
+	void start();
+	void fill(int n, Z* out);
+};
+
+void KlangFFTBank::start()
+{
+	mOLA.assign(kKlangFFTSize, 0.);
+	mFrame.assign(kKlangFFTSize, 0.);
+	mReal.assign(kKlangFFTSize / 2, 0.);
+	mImag.assign(kKlangFFTSize / 2, 0.);
+	mFFT.reset(new FFT);
+	mFFT->init(kKlangFFTLogSize);
+	
+	// the frames that begin before the first sample also overlap the first hop of output.
+	for (size_t p = 0; p < mPhase.size(); ++p) {
+		mPhase[p] = sc_wrap(mPhase[p] - mW[p] * (kKlangFFTSize - kKlangFFTHop), 0., kTwoPi);
+	}
+	for (int i = 1; i < kKlangFFTOverlap; ++i) {
+		addFrame();
+		memmove(mOLA.data(), mOLA.data() + kKlangFFTHop, (kKlangFFTSize - kKlangFFTHop) * sizeof(Z));
+		memset(mOLA.data() + kKlangFFTSize - kKlangFFTHop, 0, kKlangFFTHop * sizeof(Z));
+	}
+	addFrame();
+	mReadPos = 0;
+}
+
+void KlangFFTBank::addFrame()
+{
+	const int N = kKlangFFTSize;
+	const int N2 = N / 2;
+	Z* re = mReal.data();
+	Z* im = mImag.data();
+	memset(re, 0, N2 * sizeof(Z));
+	memset(im, 0, N2 * sizeof(Z));
+	
+	for (size_t p = 0; p < mAmp.size(); ++p) {
+		// the window is centered in the frame, which makes its spectrum real.
+		double psi = mPhase[p] + mW[p] * N2;
+		double ar = mAmp[p] * sin(psi);
+		double ai = -mAmp[p] * cos(psi);
+		double bin = mBin[p];
+		int b0 = (int)floor(bin);
+		for (int j = b0 - kKlangKernelHalfWidth; j <= b0 + kKlangKernelHalfWidth + 1; ++j) {
+			double k = klangKernel(bin - j);
+			if (j & 1) k = -k;
+			double zr = k * ar, zi = k * ai;
+			int m = j & (N - 1);
+			// the spectrum of a real signal is the average of a component and its mirror image. the nyquist bin is dropped.
+			if (m < N2) {
+				re[m] += zr;
+				im[m] += zi;
+			}
+			if (m > N2 || m == 0) {
+				int m2 = (N - m) & (N - 1);
+				re[m2] += zr;
+				im[m2] -= zi;
+			}
+		}
+		mPhase[p] = sc_wrap(mPhase[p] + mW[p] * kKlangFFTHop, 0., kTwoPi);
+	}
+	im[0] = 0.;
+	
+	mFFT->backward_real(re, im, mFrame.data());
+	
+	Z* ola = mOLA.data();
+	const Z* frame = mFrame.data();
+	for (int i = 0; i < N; ++i) {
+		ola[i] += frame[i];
+	}
+}
+
+void KlangFFTBank::fill(int n, Z* out)
+{
+	while (n) {
+		if (mReadPos == kKlangFFTHop) {
+			memmove(mOLA.data(), mOLA.data() + kKlangFFTHop, (kKlangFFTSize - kKlangFFTHop) * sizeof(Z));
+			memset(mOLA.data() + kKlangFFTSize - kKlangFFTHop, 0, kKlangFFTHop * sizeof(Z));
+			addFrame();
+			mReadPos = 0;
+		}
+		int m = std::min(n, kKlangFFTHop - mReadPos);
+		const Z* ola = mOLA.data() + mReadPos;
+		for (int i = 0; i < m; ++i) {
+			out[i] += ola[i];
+		}
+		mReadPos += m;
+		out += m;
+		n -= m;
+	}
+}
+
 struct Klang : public Gen
 {
-	std::vector<KlangOsc> _oscs;
+	std::vector<KlangOsc> _oscs; // partials with a modulated frequency or amplitude
+	KlangBank _bank;
+	KlangFFTBank _fftBank;
 	Z _freqmul, _K;
 	Z _nyq, _cutoff, _slope;
 	
@@ -1677,11 +1968,36 @@ struct Klang : public Gen
 		
 		if (numOscs == LONG_MAX) numOscs = 1;
 		
+		int64_t numConstant = 0;
+		for (int64_t i = 0; i < numOscs; ++i) {
+			if (!freqs.at(i).isList() && !amps.at(i).isList()) ++numConstant;
+		}
+		bool useFFT = numConstant >= kKlangFFTThreshold;
+		
 		for (int64_t i = 0; i < numOscs; ++i) {
 			KlangOsc kf(freqs.at(i), amps.at(i), phases.atz(i));
-			_oscs.push_back(kf);
+			if (kf.freq.isConstant() && kf.amp.isConstant()) {
+				Z ffreq = kf.freq.mConstant.f;
+				Z amp = kf.amp.mConstant.f * nyquistFade(ffreq);
+				if (amp == 0.) continue;
+				if (useFFT) _fftBank.add(ffreq * _freqmul, amp, kf.phase);
+				else _bank.add(ffreq * _freqmul, amp, kf.phase);
+			} else {
+				_oscs.push_back(kf);
+			}
 		}
 		
+		_bank.pad();
+		if (_fftBank.size()) _fftBank.start();
+	}
+	
+	// partials fade out between 80% of nyquist and nyquist.
+	Z nyquistFade(Z ffreq) const
+	{
+		ffreq = fabs(ffreq);
+		if (ffreq <= _cutoff) return 1.;
+		if (ffreq >= _nyq) return 0.;
+		return (_nyq - ffreq) * _slope;
 	}
 		
 	virtual const char* TypeName() const override { return "Klang"; }
@@ -1692,6 +2008,9 @@ struct Klang : public Gen
 		memset(out0, 0, mBlockSize * sizeof(Z));
 		int maxToFill = 0;
 		
+		_bank.fill(mBlockSize, out0);
+		if (_fftBank.size()) _fftBank.fill(mBlockSize, out0);
+		
 		Z freqmul = _freqmul;
 		Z nyq = _nyq;
 		Z cutoff = _cutoff;
@@ -1714,9 +2033,10 @@ struct Klang : public Gen
 				
 				for (int i = 0; i < n; ++i) {
 					Z ffreq = *freq;
-					if (ffreq > cutoff) {
-						if (ffreq < nyq) {
-							out[i] +=  (cutoff - ffreq) * slope * *amp * tsin(phase);
+					Z afreq = fabs(ffreq);
+					if (afreq > cutoff) {
+						if (afreq < nyq) {
+							out[i] +=  (nyq - afreq) * slope * *amp * tsin(phase);
 						}
 					} else {
 						out[i] += *amp * tsin(phase);
@@ -1766,6 +2086,7 @@ static void klang_(Thread& th, Prim* prim)
 void AddOscilUGenOps()
 {
 	fillHarmonicsTable();
+	fillKlangKernel();
 
 	vm.addBifHelp("\n*** wavetable generation ***");
 	DEFAM(wavefill, aak, "(amps phases smooth -> wavetable) generates a set 1/3 octave wavetables for table lookup oscillators. sin(i*theta + phases[i])*amps[i]*pow(cos(pi*i/n), smooth). smoothing reduces Gibb's phenomenon. zero is no smoothing")
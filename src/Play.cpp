@@ -24,10 +24,13 @@
 #endif
 #include <pthread.h>
 #include <atomic>
+#include <chrono>
 #include <thread>
 
 #include "SoundFiles.hpp"
 
+const int kMaxChannels = 32;
+
 #if defined(SAPF_AUDIOTOOLBOX)
 static OSStatus inputCallback(
 	void *inRefCon,
@@ -151,6 +154,8 @@ public:
 
 typedef AUBuffers Buffers;
 #else
+struct Player;
+
 int rtPlayerBackendCallback(
 	void *outputBuffer,
 	void *inputBuffer,
@@ -160,51 +165,86 @@ int rtPlayerBackendCallback(
 	void *userData
 );
 
-class RtPlayerBackend {
+const int kOutputBufferFrames = 256;
+const int kNumTimingBuckets = 16;
+const int kNumLoadBuckets = 101;
+const int kAudioStatsInterval = 10; // seconds between lines written to SAPF_AUDIO_STATS.
+
+// log2 histograms of callback time and jitter in microseconds, and a histogram of callback time
+// as a percentage of the buffer period, the last bucket collecting everything from 100% up.
+// written only by the thread running the callbacks, read by anyone.
+struct TimingStats {
+	TimingStats() { reset(); }
+
+	void reset();
+	void add(int64_t jitterNanos, int64_t callbackNanos, int64_t periodNanos, bool xrun);
+	double loadPercentile(double p);
+	void report(const char* name, int frames, int64_t periodNanos);
+	void summarize(FILE* f, int64_t periodNanos);
+
+	std::atomic<uint64_t> count;
+	std::atomic<uint64_t> xruns;
+	std::atomic<uint64_t> totalCallback;
+	std::atomic<uint64_t> maxCallback;
+	std::atomic<uint64_t> maxJitter;
+	std::atomic<uint64_t> callbackHist[kNumTimingBuckets];
+	std::atomic<uint64_t> jitterHist[kNumTimingBuckets];
+	std::atomic<uint64_t> loadHist[kNumLoadBuckets];
+};
+
+// the signals the players are reading, copied by the callback for a heap walk.
+// storage is allocated by the requester so that the callback only assigns.
+struct PlayerSnapshot {
+	PlayerSnapshot(int inMaxPlayers)
+		: maxPlayers(inMaxPlayers), numPlayers(0), inputs(inMaxPlayers * kMaxChannels), channels(inMaxPlayers), served(false) {}
+
+	void take(Player* players);
+
+	int maxPlayers;
+	int numPlayers;
+	std::vector<V> inputs; // kMaxChannels per player.
+	std::vector<int> channels;
+	std::atomic<bool> served;
+};
+
+// one device stream shared by every player. the callback mixes all active players into it,
+// so starting a player does not open a stream, and players are added and removed without locking the callback.
+// with SAPF_AUDIO=null there is no device. a timer thread runs the callback at the buffer rate instead,
+// optionally writing the output to SAPF_AUDIO_FILE, and keeps timing statistics.
+class OutputEngine {
 public:
-	RtPlayerBackend(int inNumChannels)
-		: player(nullptr), numChannels(inNumChannels)
-	{}
-	
-	int32_t createGraph() {
-		if(this->audio.getDeviceCount() < 1) {
-			std::cout << "\nNo audio devices found!\n";
-			exit(0);
-		}
+	OutputEngine();
 
-		RtAudio::StreamParameters parameters;
-		parameters.deviceId = this->audio.getDefaultOutputDevice();
-		parameters.nChannels = this->numChannels;
-		parameters.firstChannel = 0;
-		unsigned int sampleRate = vm.ar.sampleRate;
-		unsigned int bufferFrames = 256; // 256 sample frames
-		RtAudio::StreamOptions options;
-		options.flags = RTAUDIO_NONINTERLEAVED /* | RTAUDIO_MINIMIZE_LATENCY | RTAUDIO_SCHEDULE_REALTIME */;
- 
-		this->audio.openStream(&parameters, NULL, RTAUDIO_FLOAT32, sampleRate, &bufferFrames, &rtPlayerBackendCallback, this->player, &options);
-		this->audio.startStream();
+	int32_t open(int inNumChannels);
+	void add(Player* player);
+	void remove(Player* player);
+	void mix(float* out, int n);
+
+	bool isOpen();
+	const char* name() { return simulated ? "null output" : "output"; }
+	void startClock();
+	void stopClock();
+	void runClock();
 
-		post("start output unit OK\n");
- 
-		return 0;
-	}
-	
-	void stop() {
-		if(this->audio.isStreamRunning()) {
-			this->audio.stopStream();  // or could call this->audio.abortStream();
-		}
- 
-		if(this->audio.isStreamOpen()) {
-			this->audio.closeStream();
-		}		
-	}
-	
-	void *player;
 	int numChannels;
+	int scratchFrames;
+	std::vector<float> scratch;
+	std::atomic<Player*> active; // mixed players, linked through Player::mixNext.
+	std::atomic<uint64_t> callbacks; // odd while the callback is running.
+	std::atomic<PlayerSnapshot*> snapshotRequest; // taken by the next callback.
 	RtAudio audio;
+	int64_t periodNanos;
+	std::chrono::steady_clock::time_point lastCallback; // only used by the device callback.
+
+	bool simulated;
+	FILE* simFile;
+	std::thread clock;
+	std::atomic<bool> clockRunning;
+	TimingStats stats;
 };
 
-typedef RtPlayerBackend PlayerBackend;
+// never destroyed, so that the stream is not torn down under a running callback at exit.
+static OutputEngine& gOutputEngine = *new OutputEngine;
 
 class RtBuffers {
 public:
@@ -232,8 +272,6 @@ public:
 typedef RtBuffers Buffers;
 #endif
 
-const int kMaxChannels = 32;
-
 struct Player {
 	Player(Thread& inThread, int numChannels);
 	~Player();
@@ -244,10 +282,15 @@ struct Player {
 	
 	Thread th;
 	int count; // unused?
-	bool done;
+	std::atomic<bool> done;
 	Player* prev;
 	Player* next;
+#ifdef SAPF_AUDIOTOOLBOX
 	PlayerBackend backend;
+#else
+	int channels;
+	std::atomic<Player*> mixNext;
+#endif
 	// AudioComponentInstance outputUnit;
 	ZIn in[kMaxChannels];
 	// ExtAudioFileRef xaf = nullptr;
@@ -258,6 +301,7 @@ static bool fillBufferList(Player *player, int inNumberFrames, Buffers *buffers)
 
 struct Player* gAllPlayers = nullptr;
 
+#ifdef SAPF_AUDIOTOOLBOX
 Player::Player(Thread& inThread, int inNumChannels)
 	: th(inThread), count(0), done(false), prev(nullptr), next(gAllPlayers), backend(inNumChannels)
 {
@@ -265,6 +309,14 @@ Player::Player(Thread& inThread, int inNumChannels)
 	gAllPlayers = this;
 	if (next) next->prev = this; 
 }
+#else
+Player::Player(Thread& inThread, int inNumChannels)
+	: th(inThread), count(0), done(false), prev(nullptr), next(gAllPlayers), channels(inNumChannels), mixNext(nullptr)
+{
+	gAllPlayers = this;
+	if (next) next->prev = this; 
+}
+#endif
 
 Player::~Player() {
 	if (next) next->prev = prev;
@@ -280,6 +332,7 @@ Player::~Player() {
 	// }
 }
 
+#ifdef SAPF_AUDIOTOOLBOX
 int Player::numChannels() {
 	return this->backend.numChannels;
 }
@@ -291,6 +344,22 @@ int32_t Player::createGraph() {
 void Player::stop() {
 	this->backend.stop();
 }
+#else
+int Player::numChannels() {
+	return this->channels;
+}
+
+int32_t Player::createGraph() {
+	int32_t err = gOutputEngine.open(this->channels);
+	if (err) return err;
+	gOutputEngine.add(this);
+	return 0;
+}
+
+void Player::stop() {
+	gOutputEngine.remove(this);
+}
+#endif
 
 pthread_mutex_t gPlayerMutex = PTHREAD_MUTEX_INITIALIZER;
 
@@ -323,22 +392,362 @@ int rtPlayerBackendCallback(
 	RtAudioStreamStatus status,
 	void *userData
 ) {
-	float *out = (float *) outputBuffer;
-	Player *player = (Player *) userData;
-	RtBuffers buffers((float *) outputBuffer, player->numChannels(), nBufferFrames);
- 
-	if(status) {
-		std::cout << "Stream underflow detected!" << std::endl;
-	}
+	using namespace std::chrono;
+	OutputEngine* engine = (OutputEngine*)userData;
 
-	bool done = fillBufferList(player, nBufferFrames, &buffers);
-	// recordPlayer(player, inNumberFrames, ioData);
+	auto start = steady_clock::now();
+	engine->mix((float*)outputBuffer, nBufferFrames);
+	auto end = steady_clock::now();
 
-	if (done) {
-		player->done = true;
+	// a device calls back on its own clock, so jitter is how far the interval between callbacks strays from the period.
+	int64_t jitter = 0;
+	if (engine->stats.count.load(std::memory_order_relaxed))
+		jitter = std::abs(duration_cast<nanoseconds>(start - engine->lastCallback).count() - engine->periodNanos);
+	engine->lastCallback = start;
+
+	engine->stats.add(jitter, duration_cast<nanoseconds>(end - start).count(), engine->periodNanos, status & RTAUDIO_OUTPUT_UNDERFLOW);
+	return 0;
+}
+
+OutputEngine::OutputEngine()
+	: numChannels(0), scratchFrames(0), active(nullptr), callbacks(0), snapshotRequest(nullptr), periodNanos(0),
+	simulated(false), simFile(nullptr), clockRunning(false)
+{
+	const char* driver = getenv("SAPF_AUDIO");
+	simulated = driver && strcmp(driver, "null") == 0;
+}
+
+bool OutputEngine::isOpen()
+{
+	return simulated ? clock.joinable() : audio.isStreamOpen();
+}
+
+int32_t OutputEngine::open(int inNumChannels)
+{
+	if (isOpen() && inNumChannels <= numChannels)
+		return 0;
+
+	if (simulated) {
+		stopClock();
+		numChannels = std::max(inNumChannels, numChannels);
+		scratchFrames = kOutputBufferFrames;
+		scratch.assign(kMaxChannels * scratchFrames, 0.f);
+		periodNanos = (int64_t)(1e9 * scratchFrames / vm.ar.sampleRate);
+		startClock();
+		post("start null output OK\n");
+		return 0;
+	}
+
+	if (audio.getDeviceCount() < 1) {
+		std::cout << "\nNo audio devices found!\n";
+		exit(0);
 	}
+
+	// reopening for more channels. the players stay in the list and resume in the new stream.
+	if (audio.isStreamRunning()) audio.stopStream();
+	if (audio.isStreamOpen()) audio.closeStream();
+
+	RtAudio::StreamParameters parameters;
+	parameters.deviceId = audio.getDefaultOutputDevice();
+	parameters.nChannels = std::max(inNumChannels, numChannels);
+	parameters.firstChannel = 0;
+	unsigned int sampleRate = vm.ar.sampleRate;
+	unsigned int bufferFrames = kOutputBufferFrames;
+	RtAudio::StreamOptions options;
+	options.flags = RTAUDIO_NONINTERLEAVED /* | RTAUDIO_MINIMIZE_LATENCY | RTAUDIO_SCHEDULE_REALTIME */;
+
+	audio.openStream(&parameters, NULL, RTAUDIO_FLOAT32, sampleRate, &bufferFrames, &rtPlayerBackendCallback, this, &options);
+
+	numChannels = parameters.nChannels;
+	scratchFrames = (int)bufferFrames;
+	scratch.assign(kMaxChannels * scratchFrames, 0.f);
+	periodNanos = (int64_t)(1e9 * scratchFrames / sampleRate);
+
+	audio.startStream();
+
+	post("start output unit OK\n");
+
 	return 0;
 }
+
+// only called with gPlayerMutex held, so the audio callback is the only other thread touching the list.
+void OutputEngine::add(Player* player)
+{
+	if (!active.load()) stats.reset();
+	player->mixNext.store(active.load());
+	active.store(player);
+}
+
+void OutputEngine::remove(Player* player)
+{
+	Player* prev = nullptr;
+	Player* p = active.load();
+	while (p && p != player) {
+		prev = p;
+		p = p->mixNext.load();
+	}
+	if (!p) return;
+	
+	Player* next = p->mixNext.load();
+	if (prev) prev->mixNext.store(next);
+	else active.store(next);
+
+	// a callback that began before the unlink may still be reading the player. wait for it to finish.
+	uint64_t c = callbacks.load();
+	if (c & 1) {
+		while (callbacks.load() == c)
+			std::this_thread::yield();
+	}
+
+	if (simulated && !active.load())
+		stats.report(name(), scratchFrames, periodNanos);
+}
+
+void OutputEngine::mix(float* out, int n)
+{
+	callbacks.fetch_add(1);
+	memset(out, 0, numChannels * n * sizeof(float));
+	for (int offset = 0; offset < n; offset += scratchFrames) {
+		int m = std::min(n - offset, scratchFrames);
+		for (Player* player = active.load(); player; player = player->mixNext.load()) {
+			if (player->done) continue;
+			RtBuffers buffers(scratch.data(), player->numChannels(), m);
+			bool done = fillBufferList(player, m, &buffers);
+			int nc = std::min(player->numChannels(), numChannels);
+			for (int c = 0; c < nc; ++c) {
+				float* mixed = out + c * n + offset;
+				float* in = buffers.data(c);
+				for (int i = 0; i < m; ++i) mixed[i] += in[i];
+			}
+			if (done) player->done = true;
+		}
+	}
+	if (PlayerSnapshot* snapshot = snapshotRequest.exchange(nullptr)) {
+		snapshot->take(active.load());
+		snapshot->served.store(true);
+	}
+	callbacks.fetch_add(1);
+}
+
+void PlayerSnapshot::take(Player* player)
+{
+	for (; player && numPlayers < maxPlayers; player = player->mixNext.load()) {
+		if (player->done) continue;
+		int nc = player->numChannels();
+		for (int c = 0; c < nc; ++c) {
+			ZIn& in = player->in[c];
+			inputs[numPlayers * kMaxChannels + c] = in.isConstant() ? in.mConstant : V(in.mList());
+		}
+		channels[numPlayers++] = nc;
+	}
+}
+
+void OutputEngine::startClock()
+{
+	if (!simFile) {
+		const char* path = getenv("SAPF_AUDIO_FILE");
+		if (path && *path) {
+			simFile = fopen(path, "wb");
+			if (!simFile) post("couldn't create output file \"%s\"\n", path);
+		}
+	}
+	clockRunning = true;
+	clock = std::thread([this]{ runClock(); });
+}
+
+void OutputEngine::stopClock()
+{
+	if (!clock.joinable()) return;
+	clockRunning = false;
+	clock.join();
+}
+
+void OutputEngine::runClock()
+{
+	using namespace std::chrono;
+	const nanoseconds period(periodNanos);
+	std::vector<float> out(numChannels * scratchFrames);
+	std::vector<float> interleaved(numChannels * scratchFrames);
+
+	auto deadline = steady_clock::now();
+	while (clockRunning.load()) {
+		std::this_thread::sleep_until(deadline);
+		auto start = steady_clock::now();
+		mix(out.data(), scratchFrames);
+		auto end = steady_clock::now();
+
+		// a device wants each buffer one period after asking for it.
+		bool missed = end > deadline + period;
+		stats.add(duration_cast<nanoseconds>(start - deadline).count(), duration_cast<nanoseconds>(end - start).count(), periodNanos, missed);
+
+		if (simFile) {
+			for (int c = 0; c < numChannels; ++c)
+				for (int i = 0; i < scratchFrames; ++i)
+					interleaved[i * numChannels + c] = out[c * scratchFrames + i];
+			fwrite(interleaved.data(), sizeof(float), interleaved.size(), simFile);
+		}
+
+		deadline += period;
+		// fell behind. resume from now, as a device does after an underflow.
+		if (end > deadline) deadline = end;
+	}
+	if (simFile) fflush(simFile);
+}
+
+static int timingBucket(uint64_t nanos)
+{
+	uint64_t micros = nanos / 1000;
+	if (micros == 0) return 0;
+	return std::min(64 - __builtin_clzll(micros), kNumTimingBuckets - 1);
+}
+
+static void atomicMax(std::atomic<uint64_t>& x, uint64_t y)
+{
+	uint64_t old = x.load(std::memory_order_relaxed);
+	while (y > old && !x.compare_exchange_weak(old, y, std::memory_order_relaxed)) {}
+}
+
+void TimingStats::reset()
+{
+	count = 0;
+	xruns = 0;
+	totalCallback = 0;
+	maxCallback = 0;
+	maxJitter = 0;
+	for (int i = 0; i < kNumTimingBuckets; ++i) {
+		callbackHist[i] = 0;
+		jitterHist[i] = 0;
+	}
+	for (int i = 0; i < kNumLoadBuckets; ++i) {
+		loadHist[i] = 0;
+	}
+}
+
+void TimingStats::add(int64_t jitterNanos, int64_t callbackNanos, int64_t periodNanos, bool xrun)
+{
+	uint64_t jitter = std::max(jitterNanos, (int64_t)0);
+	uint64_t callback = std::max(callbackNanos, (int64_t)0);
+	int load = periodNanos > 0 ? (int)std::min(100 * callback / periodNanos, (uint64_t)kNumLoadBuckets - 1) : 0;
+	count.fetch_add(1, std::memory_order_relaxed);
+	if (xrun) xruns.fetch_add(1, std::memory_order_relaxed);
+	totalCallback.fetch_add(callback, std::memory_order_relaxed);
+	atomicMax(maxCallback, callback);
+	atomicMax(maxJitter, jitter);
+	callbackHist[timingBucket(callback)].fetch_add(1, std::memory_order_relaxed);
+	jitterHist[timingBucket(jitter)].fetch_add(1, std::memory_order_relaxed);
+	loadHist[load].fetch_add(1, std::memory_order_relaxed);
+}
+
+// the upper edge of the load bucket holding the p-th fraction of the buffers.
+double TimingStats::loadPercentile(double p)
+{
+	uint64_t n = count.load();
+	if (!n) return 0.;
+	uint64_t rank = (uint64_t)ceil(p * n);
+	uint64_t sum = 0;
+	for (int i = 0; i < kNumLoadBuckets; ++i) {
+		sum += loadHist[i].load();
+		if (sum >= rank) return i + 1;
+	}
+	return kNumLoadBuckets;
+}
+
+void TimingStats::report(const char* name, int frames, int64_t periodNanos)
+{
+	uint64_t n = count.load();
+	double period = periodNanos * 1e-3;
+	post("%s: %llu buffers of %d frames, period %.0f us, %llu xruns\n",
+		name, (unsigned long long)n, frames, period, (unsigned long long)xruns.load());
+	if (!n) return;
+	post("  callback mean %.0f us, max %.0f us, max jitter %.0f us\n", totalCallback.load() * 1e-3 / n, maxCallback.load() * 1e-3, maxJitter.load() * 1e-3);
+	post("  load mean %.1f%%, p99 < %.0f%%, max %.1f%%\n", 100. * totalCallback.load() / ((double)n * periodNanos), loadPercentile(.99), 100. * maxCallback.load() / periodNanos);
+	post("  %-14s %10s %10s\n", "us", "callback", "jitter");
+	for (int i = 0; i < kNumTimingBuckets; ++i) {
+		uint64_t c = callbackHist[i].load();
+		uint64_t j = jitterHist[i].load();
+		if (!c && !j) continue;
+		char range[32];
+		if (i == 0) snprintf(range, 32, "< 1");
+		else if (i == kNumTimingBuckets - 1) snprintf(range, 32, ">= %d", 1 << (i - 1));
+		else snprintf(range, 32, "%d - %d", 1 << (i - 1), 1 << i);
+		post("  %-14s %10llu %10llu\n", range, (unsigned long long)c, (unsigned long long)j);
+	}
+}
+
+// one line per call, for the periodic report.
+void TimingStats::summarize(FILE* f, int64_t periodNanos)
+{
+	uint64_t n = count.load();
+	double mean = n ? 100. * totalCallback.load() / ((double)n * periodNanos) : 0.;
+	double max = periodNanos ? 100. * maxCallback.load() / periodNanos : 0.;
+	char stamp[32];
+	time_t now = time(nullptr);
+	strftime(stamp, 32, "%Y-%m-%d %H:%M:%S", localtime(&now));
+	fprintf(f, "%s buffers %llu xruns %llu load mean %.1f%% p99 %.0f%% max %.1f%% max jitter %.0f us\n",
+		stamp, (unsigned long long)n, (unsigned long long)xruns.load(), mean, loadPercentile(.99), max, maxJitter.load() * 1e-3);
+}
+
+void postAudioStats()
+{
+	gOutputEngine.stats.report(gOutputEngine.name(), gOutputEngine.scratchFrames, gOutputEngine.periodNanos);
+}
+
+// the callback advances the players' inputs without a lock, so it copies them itself when asked.
+void collectPlayerInputs(std::vector<std::vector<V>>& outPlayers)
+{
+	using namespace std::chrono;
+	Locker lock(&gPlayerMutex);
+	if (!gOutputEngine.active.load()) return;
+
+	int maxPlayers = 0;
+	for (Player* player = gAllPlayers; player; player = player->next) ++maxPlayers;
+
+	PlayerSnapshot snapshot(maxPlayers);
+	gOutputEngine.snapshotRequest.store(&snapshot);
+	auto deadline = steady_clock::now() + seconds(1);
+	while (!snapshot.served.load()) {
+		// withdraw the request unless a callback has already taken it.
+		if (steady_clock::now() > deadline && gOutputEngine.snapshotRequest.exchange(nullptr)) {
+			post("the output callback is not running. players were not walked.\n");
+			return;
+		}
+		std::this_thread::sleep_for(milliseconds(1));
+	}
+
+	for (int i = 0; i < snapshot.numPlayers; ++i) {
+		auto first = snapshot.inputs.begin() + i * kMaxChannels;
+		outPlayers.emplace_back(first, first + snapshot.channels[i]);
+	}
+}
+
+static void writeAudioStats()
+{
+	static int seconds = 0;
+	const char* path = getenv("SAPF_AUDIO_STATS");
+	if (!path || !*path) return;
+	if (!gOutputEngine.active.load() || ++seconds < kAudioStatsInterval) return;
+	seconds = 0;
+	FILE* f = fopen(path, "a");
+	if (!f) return;
+	gOutputEngine.stats.summarize(f, gOutputEngine.periodNanos);
+	fclose(f);
+}
+#endif
+
+#ifdef SAPF_AUDIOTOOLBOX
+void postAudioStats()
+{
+	post("no output statistics for this audio backend\n");
+}
+
+void collectPlayerInputs(std::vector<std::vector<V>>& outPlayers)
+{
+	post("players are not walked with this audio backend\n");
+}
+
+static void writeAudioStats()
+{
+}
 #endif
 
 static void stopPlayer(Player* player)
@@ -361,19 +770,15 @@ void stopPlaying()
 
 void stopPlayingIfDone()
 {
-#ifdef SAPF_AUDIOTOOLBOX
     Locker lock(&gPlayerMutex);
 	
-	AUPlayer* player = gAllPlayers;
+	Player* player = gAllPlayers;
 	while (player) {
-		AUPlayer* next = player->next;
+		Player* next = player->next;
 		if (player->done)
 			stopPlayer(player);
 		player = next;
 	}
-#else
-        // TODO: cross platform playback
-#endif // SAPF_AUDIOTOOLBOX
 }
 
 static bool fillBufferList(Player *player, int inNumberFrames, Buffers *buffers)
@@ -435,6 +840,7 @@ static void* stopDonePlayers(void* x)
 	while(1) {
 		std::this_thread::sleep_for(1s);
 		stopPlayingIfDone();
+		writeAudioStats();
 	}
 	return nullptr;
 }
@@ -40,7 +40,7 @@ void swapifgt(T& a, T& b) {
 
 struct URand : ZeroInputGen<URand>
 {	
-    RGen r;
+    CRGen r;
     
 	URand(Thread& th) : ZeroInputGen<URand>(th, false) 
 	{
@@ -59,7 +59,7 @@ struct URand : ZeroInputGen<URand>
 
 struct URandz : ZeroInputUGen<URandz>
 {	
-    RGen r;
+    CRGen r;
     
 	URandz(Thread& th) : ZeroInputUGen<URandz>(th, false) 
 	{
@@ -70,16 +70,14 @@ struct URandz : ZeroInputUGen<URandz>
     
 	void calc(int n, Z* out) 
 	{
-		for (int i = 0; i < n; ++i) {
-			out[i] = r.drand();
-		}
+		r.drands(n, out);
 	}
 };
 
 
 struct NURand : NZeroInputGen<NURand>
 {	
-    RGen r;
+    CRGen r;
     
 	NURand(Thread& th, int64_t n) : NZeroInputGen<NURand>(th, n) 
 	{
@@ -98,7 +96,7 @@ struct NURand : NZeroInputGen<NURand>
 
 struct NURandz : NZeroInputUGen<NURandz>
 {	
-    RGen r;
+    CRGen r;
     
 	NURandz(Thread& th, int64_t n) : NZeroInputUGen<NURandz>(th, n) 
 	{
@@ -109,15 +107,13 @@ struct NURandz : NZeroInputUGen<NURandz>
     
 	void calc(int n, Z* out) 
 	{
-		for (int i = 0; i < n; ++i) {
-			out[i] = r.drand();
-		}
+		r.drands(n, out);
 	}
 };
 
 struct BRand : ZeroInputGen<BRand>
 {	
-    RGen r;
+    CRGen r;
     
 	BRand(Thread& th) : ZeroInputGen<BRand>(th, false) 
 	{
@@ -136,7 +132,7 @@ struct BRand : ZeroInputGen<BRand>
 
 struct BRandz : ZeroInputUGen<BRandz>
 {	
-    RGen r;
+    CRGen r;
     
 	BRandz(Thread& th) : ZeroInputUGen<BRandz>(th, false) 
 	{
@@ -156,7 +152,7 @@ struct BRandz : ZeroInputUGen<BRandz>
 
 struct NBRand : NZeroInputGen<NBRand>
 {	
-    RGen r;
+    CRGen r;
     
 	NBRand(Thread& th, int64_t n) : NZeroInputGen<NBRand>(th, n) 
 	{
@@ -175,7 +171,7 @@ struct NBRand : NZeroInputGen<NBRand>
 
 struct NBRandz : NZeroInputUGen<NBRandz>
 {	
-    RGen r;
+    CRGen r;
     
 	NBRandz(Thread& th, int64_t n) : NZeroInputUGen<NBRandz>(th, n) 
 	{
@@ -195,7 +191,7 @@ struct NBRandz : NZeroInputUGen<NBRandz>
 
 struct Rand : TwoInputGen<Rand>
 {	
-    RGen r;
+    CRGen r;
     
 	Rand(Thread& th,  Arg a, Arg b) : TwoInputGen<Rand>(th, a, b) 
 	{
@@ -226,7 +222,7 @@ struct Rand : TwoInputGen<Rand>
 
 struct Randz : TwoInputUGen<Randz>
 {	
-    RGen r;
+    CRGen r;
     
 	Randz(Thread& th,  Arg a, Arg b) : TwoInputUGen<Randz>(th, a, b) 
 	{
@@ -241,8 +237,9 @@ struct Randz : TwoInputUGen<Randz>
 			Z a = *aa;
 			Z b = *bb; 
 			swapifgt(a, b);
+			r.drands(n, out);
 			for (int i = 0; i < n; ++i) {
-				out[i] = a + (b - a) * r.drand();
+				out[i] = a + (b - a) * out[i];
 			}
 		} else {
 			for (int i = 0; i < n; ++i) {
@@ -258,7 +255,7 @@ struct Randz : TwoInputUGen<Randz>
 
 struct NRand : NTwoInputGen<NRand>
 {	
-    RGen r;
+    CRGen r;
     
 	NRand(Thread& th, int64_t n, Arg a, Arg b) : NTwoInputGen<NRand>(th, n, a, b) 
 	{
@@ -289,7 +286,7 @@ struct NRand : NTwoInputGen<NRand>
 
 struct NRandz : NTwoInputUGen<NRandz>
 {	
-    RGen r;
+    CRGen r;
     
 	NRandz(Thread& th, int64_t n, Arg a, Arg b) : NTwoInputUGen<NRandz>(th, n, a, b) 
 	{
@@ -304,8 +301,9 @@ struct NRandz : NTwoInputUGen<NRandz>
 			Z a = *aa;
 			Z b = *bb; 
 			swapifgt(a, b);
+			r.drands(n, out);
 			for (int i = 0; i < n; ++i) {
-				out[i] = a + (b - a) * r.drand();
+				out[i] = a + (b - a) * out[i];
 			}
 		} else {
 			for (int i = 0; i < n; ++i) {
@@ -448,7 +446,7 @@ static void rand_(Thread& th, Prim* prim)
 
 struct Coin : OneInputGen<Coin>
 {	
-    RGen r;
+    CRGen r;
     
 	Coin(Thread& th,  Arg a) : OneInputGen<Coin>(th, a)
 	{
@@ -475,7 +473,7 @@ struct Coin : OneInputGen<Coin>
 
 struct Coinz : OneInputUGen<Coinz>
 {	
-    RGen r;
+    CRGen r;
     
 	Coinz(Thread& th,  Arg a) : OneInputUGen<Coinz>(th, a)
 	{
@@ -502,7 +500,7 @@ struct Coinz : OneInputUGen<Coinz>
 
 struct NCoin : NOneInputGen<NCoin>
 {	
-    RGen r;
+    CRGen r;
     
 	NCoin(Thread& th, int64_t n, Arg a) : NOneInputGen<NCoin>(th, n, a)
 	{
@@ -529,7 +527,7 @@ struct NCoin : NOneInputGen<NCoin>
 
 struct NCoinz : NOneInputUGen<NCoinz>
 {	
-    RGen r;
+    CRGen r;
     
 	NCoinz(Thread& th, int64_t n, Arg a) : NOneInputUGen<NCoinz>(th, n, a)
 	{
@@ -600,7 +598,7 @@ static void ncoinz_(Thread& th, Prim* prim)
 
 struct IRand : TwoInputGen<IRand>
 {	
-    RGen r;
+    CRGen r;
     
 	IRand(Thread& th,  Arg a, Arg b) : TwoInputGen<IRand>(th, a, b) 
 	{
@@ -631,7 +629,7 @@ struct IRand : TwoInputGen<IRand>
 
 struct IRandz : TwoInputUGen<IRandz>
 {	
-    RGen r;
+    CRGen r;
     
 	IRandz(Thread& th,  Arg a, Arg b) : TwoInputUGen<IRandz>(th, a, b) 
 	{
@@ -663,7 +661,7 @@ struct IRandz : TwoInputUGen<IRandz>
 
 struct NIRand : NTwoInputGen<NIRand>
 {	
-    RGen r;
+    CRGen r;
     
 	NIRand(Thread& th, int64_t n, Arg a, Arg b) : NTwoInputGen<NIRand>(th, n, a, b) 
 	{
@@ -694,7 +692,7 @@ struct NIRand : NTwoInputGen<NIRand>
 
 struct NIRandz : NTwoInputUGen<NIRandz>
 {	
-    RGen r;
+    CRGen r;
     
 	NIRandz(Thread& th, int64_t n, Arg a, Arg b) : NTwoInputUGen<NIRandz>(th, n, a, b) 
 	{
@@ -776,7 +774,7 @@ static void irand_(Thread& th, Prim* prim)
 
 struct ExcRand : TwoInputGen<ExcRand>
 {	
-    RGen r;
+    CRGen r;
 	int64_t prev;
     
 	ExcRand(Thread& th,  Arg a, Arg b) : TwoInputGen<ExcRand>(th, a, b), prev(INT32_MIN)
@@ -815,7 +813,7 @@ struct ExcRand : TwoInputGen<ExcRand>
 
 struct ExcRandz : TwoInputUGen<ExcRandz>
 {	
-    RGen r;
+    CRGen r;
 	int64_t prev;
     
 	ExcRandz(Thread& th,  Arg a, Arg b) : TwoInputUGen<ExcRandz>(th, a, b), prev(INT32_MIN)
@@ -855,7 +853,7 @@ struct ExcRandz : TwoInputUGen<ExcRandz>
 
 struct NExcRand : NTwoInputGen<NExcRand>
 {	
-    RGen r;
+    CRGen r;
  	int64_t prev;
     
 	NExcRand(Thread& th, int64_t n, Arg a, Arg b) : NTwoInputGen<NExcRand>(th, n, a, b), prev(INT32_MIN)
@@ -894,7 +892,7 @@ struct NExcRand : NTwoInputGen<NExcRand>
 
 struct NExcRandz : NTwoInputUGen<NExcRandz>
 {	
-    RGen r;
+    CRGen r;
 	int64_t prev;
     
 	NExcRandz(Thread& th, int64_t n, Arg a, Arg b) : NTwoInputUGen<NExcRandz>(th, n, a, b), prev(INT32_MIN)
@@ -965,7 +963,7 @@ static void neprandz_(Thread& th, Prim* prim)
 
 struct ExpRand : TwoInputGen<ExpRand>
 {	
-    RGen r;
+    CRGen r;
     
 	ExpRand(Thread& th,  Arg a, Arg b) : TwoInputGen<ExpRand>(th, a, b) 
 	{
@@ -996,7 +994,7 @@ struct ExpRand : TwoInputGen<ExpRand>
 
 struct ExpRandz : TwoInputUGen<ExpRandz>
 {	
-    RGen r;
+    CRGen r;
     
 	ExpRandz(Thread& th,  Arg a, Arg b) : TwoInputUGen<ExpRandz>(th, a, b) 
 	{
@@ -1028,7 +1026,7 @@ struct ExpRandz : TwoInputUGen<ExpRandz>
 
 struct NExpRand : NTwoInputGen<NExpRand>
 {	
-    RGen r;
+    CRGen r;
     
 	NExpRand(Thread& th, int64_t n, Arg a, Arg b) : NTwoInputGen<NExpRand>(th, n, a, b) 
 	{
@@ -1059,7 +1057,7 @@ struct NExpRand : NTwoInputGen<NExpRand>
 
 struct NExpRandz : NTwoInputUGen<NExpRandz>
 {	
-    RGen r;
+    CRGen r;
     
 	NExpRandz(Thread& th, int64_t n, Arg a, Arg b) : NTwoInputUGen<NExpRandz>(th, n, a, b) 
 	{
@@ -1140,7 +1138,7 @@ static void xrand_(Thread& th, Prim* prim)
 
 struct ILinRand : TwoInputGen<ILinRand>
 {	
-    RGen r;
+    CRGen r;
     
 	ILinRand(Thread& th,  Arg a, Arg b) : TwoInputGen<ILinRand>(th, a, b) 
 	{
@@ -1171,7 +1169,7 @@ struct ILinRand : TwoInputGen<ILinRand>
 
 struct ILinRandz : TwoInputUGen<ILinRandz>
 {	
-    RGen r;
+    CRGen r;
     
 	ILinRandz(Thread& th,  Arg a, Arg b) : TwoInputUGen<ILinRandz>(th, a, b) 
 	{
@@ -1203,7 +1201,7 @@ struct ILinRandz : TwoInputUGen<ILinRandz>
 
 struct NILinRand : NTwoInputGen<NILinRand>
 {	
-    RGen r;
+    CRGen r;
     
 	NILinRand(Thread& th, int64_t n, Arg a, Arg b) : NTwoInputGen<NILinRand>(th, n, a, b) 
 	{
@@ -1234,7 +1232,7 @@ struct NILinRand : NTwoInputGen<NILinRand>
 
 struct NILinRandz : NTwoInputUGen<NILinRandz>
 {	
-    RGen r;
+    CRGen r;
     
 	NILinRandz(Thread& th, int64_t n, Arg a, Arg b) : NTwoInputUGen<NILinRandz>(th, n, a, b) 
 	{
@@ -1318,7 +1316,7 @@ static void ilinrand_(Thread& th, Prim* prim)
 
 struct LinRand : TwoInputGen<LinRand>
 {	
-    RGen r;
+    CRGen r;
     
 	LinRand(Thread& th,  Arg a, Arg b) : TwoInputGen<LinRand>(th, a, b) 
 	{
@@ -1349,7 +1347,7 @@ struct LinRand : TwoInputGen<LinRand>
 
 struct LinRandz : TwoInputUGen<LinRandz>
 {	
-    RGen r;
+    CRGen r;
     
 	LinRandz(Thread& th,  Arg a, Arg b) : TwoInputUGen<LinRandz>(th, a, b) 
 	{
@@ -1381,7 +1379,7 @@ struct LinRandz : TwoInputUGen<LinRandz>
 
 struct NLinRand : NTwoInputGen<NLinRand>
 {	
-    RGen r;
+    CRGen r;
     
 	NLinRand(Thread& th, int64_t n, Arg a, Arg b) : NTwoInputGen<NLinRand>(th, n, a, b) 
 	{
@@ -1412,7 +1410,7 @@ struct NLinRand : NTwoInputGen<NLinRand>
 
 struct NLinRandz : NTwoInputUGen<NLinRandz>
 {	
-    RGen r;
+    CRGen r;
     
 	NLinRandz(Thread& th, int64_t n, Arg a, Arg b) : NTwoInputUGen<NLinRandz>(th, n, a, b) 
 	{
@@ -1494,7 +1492,7 @@ static void linrand_(Thread& th, Prim* prim)
 
 struct Rand2 : OneInputGen<Rand2>
 {	
-    RGen r;
+    CRGen r;
     
 	Rand2(Thread& th,  Arg a) : OneInputGen<Rand2>(th, a)
 	{
@@ -1522,7 +1520,7 @@ struct Rand2 : OneInputGen<Rand2>
 
 struct Rand2z : OneInputUGen<Rand2z>
 {	
-    RGen r;
+    CRGen r;
     
 	Rand2z(Thread& th,  Arg a) : OneInputUGen<Rand2z>(th, a)
 	{
@@ -1731,7 +1729,7 @@ struct CityNoise : OneInputUGen<CityNoise>
 
 struct Violet : OneInputUGen<Violet>
 {	
-    RGen r;
+    CRGen r;
 	Z prev;
     
 	Violet(Thread& th,  Arg a) : OneInputUGen<Violet>(th, a), prev(0.)
@@ -1764,7 +1762,7 @@ struct Violet : OneInputUGen<Violet>
 
 struct NRand2 : NOneInputGen<NRand2>
 {	
-    RGen r;
+    CRGen r;
     
 	NRand2(Thread& th, int64_t n, Arg a) : NOneInputGen<NRand2>(th, n, a)
 	{
@@ -1792,7 +1790,7 @@ struct NRand2 : NOneInputGen<NRand2>
 
 struct NRand2z : NOneInputUGen<NRand2z>
 {	
-    RGen r;
+    CRGen r;
     
 	NRand2z(Thread& th, int64_t n, Arg a) : NOneInputUGen<NRand2z>(th, n, a)
 	{
@@ -1922,7 +1920,7 @@ static void rand2_(Thread& th, Prim* prim)
 
 struct IRand2 : OneInputGen<IRand2>
 {	
-    RGen r;
+    CRGen r;
     
 	IRand2(Thread& th,  Arg a) : OneInputGen<IRand2>(th, a)
 	{
@@ -1950,7 +1948,7 @@ struct IRand2 : OneInputGen<IRand2>
 
 struct IRand2z : OneInputUGen<IRand2z>
 {	
-    RGen r;
+    CRGen r;
     
 	IRand2z(Thread& th,  Arg a) : OneInputUGen<IRand2z>(th, a)
 	{
@@ -1978,7 +1976,7 @@ struct IRand2z : OneInputUGen<IRand2z>
 
 struct NIRand2 : NOneInputGen<NIRand2>
 {	
-    RGen r;
+    CRGen r;
     
 	NIRand2(Thread& th, int64_t n, Arg a) : NOneInputGen<NIRand2>(th, n, a)
 	{
@@ -2006,7 +2004,7 @@ struct NIRand2 : NOneInputGen<NIRand2>
 
 struct NIRand2z : NOneInputUGen<NIRand2z>
 {	
-    RGen r;
+    CRGen r;
     
 	NIRand2z(Thread& th, int64_t n, Arg a) : NOneInputUGen<NIRand2z>(th, n, a)
 	{
@@ -2080,7 +2078,7 @@ static void irand2_(Thread& th, Prim* prim)
 struct Pick : ZeroInputGen<Pick>
 {
 	P<Array> _array;
-	RGen r;
+	CRGen r;
 	
 	Pick(Thread& th, P<Array> const& array) : ZeroInputGen<Pick>(th, false), _array(array)
 	{
@@ -2109,7 +2107,7 @@ struct Pick : ZeroInputGen<Pick>
 struct Pickz : ZeroInputUGen<Pickz>
 {
 	P<Array> _array;
-	RGen r;
+	CRGen r;
 	
 	Pickz(Thread& th, P<Array> const& array) : ZeroInputUGen<Pickz>(th, false), _array(array)
 	{
@@ -2131,7 +2129,7 @@ struct Pickz : ZeroInputUGen<Pickz>
 struct NPick : NZeroInputGen<NPick>
 {
 	P<Array> _array;
-	RGen r;
+	CRGen r;
 	
 	NPick(Thread& th, int64_t n, P<Array> const& array) : NZeroInputGen<NPick>(th, n), _array(array)
 	{
@@ -2160,7 +2158,7 @@ struct NPick : NZeroInputGen<NPick>
 struct NPickz : NZeroInputUGen<NPickz>
 {
 	P<Array> _array;
-	RGen r;
+	CRGen r;
 	
 	NPickz(Thread& th, int64_t n, P<Array> const& array) : NZeroInputUGen<NPickz>(th, n), _array(array)
 	{
@@ -2258,7 +2256,7 @@ struct WPick : ZeroInputGen<WPick>
 {
 	P<Array> _array;
 	P<Array> _weights;
-	RGen r;
+	CRGen r;
 	
 	WPick(Thread& th, P<Array> const& array, P<Array> const& weights) : ZeroInputGen<WPick>(th, false), _array(array), _weights(weights)
 	{
@@ -2291,7 +2289,7 @@ struct WPickz : ZeroInputUGen<WPickz>
 {
 	P<Array> _array;
 	P<Array> _weights;
-	RGen r;
+	CRGen r;
 	
 	WPickz(Thread& th, P<Array> const& array, P<Array> const& weights) : ZeroInputUGen<WPickz>(th, false), _array(array), _weights(weights)
 	{
@@ -2316,7 +2314,7 @@ struct NWPick : NZeroInputGen<NWPick>
 {
 	P<Array> _array;
 	P<Array> _weights;
-	RGen r;
+	CRGen r;
 	
 	NWPick(Thread& th, int64_t n, P<Array> const& array, P<Array> const& weights) : NZeroInputGen<NWPick>(th, n), _array(array), _weights(weights)
 	{
@@ -2349,7 +2347,7 @@ struct NWPickz : NZeroInputUGen<NWPickz>
 {
 	P<Array> _array;
 	P<Array> _weights;
-	RGen r;
+	CRGen r;
 	
 	NWPickz(Thread& th, int64_t n, P<Array> const& array, P<Array> const& weights) : NZeroInputUGen<NWPickz>(th, n), _array(array), _weights(weights)
 	{
@@ -2531,7 +2529,7 @@ static void wpick_(Thread& th, Prim* prim)
 struct WRand : ZeroInputGen<WRand>
 {
 	P<Array> _weights;
-	RGen r;
+	CRGen r;
 	
 	WRand(Thread& th, P<Array> const& weights) : ZeroInputGen<WRand>(th, false), _weights(weights)
 	{
@@ -2553,7 +2551,7 @@ struct WRand : ZeroInputGen<WRand>
 struct WRandz : ZeroInputUGen<WRandz>
 {
 	P<Array> _weights;
-	RGen r;
+	CRGen r;
 	
 	WRandz(Thread& th, P<Array> const& weights) : ZeroInputUGen<WRandz>(th, false), _weights(weights)
 	{
@@ -2575,7 +2573,7 @@ struct WRandz : ZeroInputUGen<WRandz>
 struct NWRand : NZeroInputGen<NWRand>
 {
 	P<Array> _weights;
-	RGen r;
+	CRGen r;
 	
 	NWRand(Thread& th, int64_t n, P<Array> const& weights) : NZeroInputGen<NWRand>(th, n), _weights(weights)
 	{
@@ -2597,7 +2595,7 @@ struct NWRand : NZeroInputGen<NWRand>
 struct NWRandz : NZeroInputUGen<NWRandz>
 {
 	P<Array> _weights;
-	RGen r;
+	CRGen r;
 	
 	NWRandz(Thread& th, int64_t n, P<Array> const& weights) : NZeroInputUGen<NWRandz>(th, n), _weights(weights)
 	{
@@ -2704,7 +2702,7 @@ static void wrand_(Thread& th, Prim* prim)
 
 struct GrayNoise : OneInputUGen<GrayNoise>
 {	
-    RGen r;
+    CRGen r;
 	int32_t counter_;
     
 	GrayNoise(Thread& th,  Arg a) : OneInputUGen<GrayNoise>(th, a), counter_(0)
@@ -2737,7 +2735,7 @@ struct GrayNoise : OneInputUGen<GrayNoise>
 
 struct Gray64Noise : OneInputUGen<Gray64Noise>
 {	
-    RGen r;
+    CRGen r;
 	int64_t counter_;
     
 	Gray64Noise(Thread& th,  Arg a) : OneInputUGen<Gray64Noise>(th, a), counter_(0)
@@ -2787,12 +2785,13 @@ struct PinkNoise : Gen
 	ZIn _a;
 	uint64_t dice[16];
 	uint64_t total_;
+	CRGen r;
 	
 	PinkNoise(Thread& th, Arg a)
     : Gen(th, itemTypeZ, a.isFinite()), _a(a) 
 	{
 		total_ = 0;
-		RGen& r = th.rgen;
+		r.init(th.rgen.trand());
 		for (int i = 0; i < 16; ++i) {
 			int64_t x = (uint64_t)r.trand() >> 16;
 			total_ += x;
@@ -2803,7 +2802,6 @@ struct PinkNoise : Gen
 	virtual const char* TypeName() const override { return "PinkNoise"; }
 	
 	virtual void pull(Thread& th) override {
-		RGen& r = th.rgen;
 		int framesToFill = mBlockSize;
 		Z* out = mOut->fulfillz(framesToFill);
 		uint64_t total = total_;
@@ -2844,10 +2842,12 @@ struct PinkNoise0 : Gen
 	ZIn _a;
 	uint64_t dice[16];
 	uint64_t total_;
+	CRGen r;
 	
 	PinkNoise0(Thread& th, Arg a)
     : Gen(th, itemTypeZ, a.isFinite()), _a(a) 
 	{
+		r.init(th.rgen.trand());
 		total_ = 0;
 		for (int i = 0; i < 16; ++i) {
 			dice[i] = 0;
@@ -2857,7 +2857,6 @@ struct PinkNoise0 : Gen
 	virtual const char* TypeName() const override { return "PinkNoise0"; }
 	
 	virtual void pull(Thread& th) override {
-		RGen& r = th.rgen;
 		int framesToFill = mBlockSize;
 		Z* out = mOut->fulfillz(framesToFill);
 		uint64_t total = total_;
@@ -2898,13 +2897,14 @@ struct BlueNoise : Gen
 	ZIn _a;
 	uint64_t dice[16];
 	uint64_t total_;
+	CRGen r;
 	Z prev;
 	
 	BlueNoise(Thread& th, Arg a)
     : Gen(th, itemTypeZ, a.isFinite()), _a(a), prev(0.)
 	{
 		total_ = 0;
-		RGen& r = th.rgen;
+		r.init(th.rgen.trand());
 		for (int i = 0; i < 16; ++i) {
 			int64_t x = (uint64_t)r.trand() >> 16;
 			total_ += x;
@@ -2915,7 +2915,6 @@ struct BlueNoise : Gen
 	virtual const char* TypeName() const override { return "BlueNoise"; }
 	
 	virtual void pull(Thread& th) override {
-		RGen& r = th.rgen;
 		int framesToFill = mBlockSize;
 		Z* out = mOut->fulfillz(framesToFill);
 		uint64_t total = total_;
@@ -2979,20 +2978,18 @@ struct BrownNoise : Gen
 {
 	ZIn _a;
 	Z total_;
+	CRGen r;
 	
 	BrownNoise(Thread& th, Arg a)
     : Gen(th, itemTypeZ, a.isFinite()), _a(a) 
 	{
-		total_ = 0;
-		RGen& r = th.rgen;
+		r.init(th.rgen.trand());
 		total_ = r.drand2();
-        
 	}
     
 	virtual const char* TypeName() const override { return "BrownNoise"; }
 	
 	virtual void pull(Thread& th) override {
-		RGen& r = th.rgen;
 		int framesToFill = mBlockSize;
 		Z* out = mOut->fulfillz(framesToFill);
 		Z z = total_;
@@ -3034,16 +3031,17 @@ struct Dust : Gen
 	ZIn _density;
 	ZIn _amp;
 	Z _densmul;
+	CRGen r;
 	
 	Dust(Thread& th, Arg density, Arg amp)
     : Gen(th, itemTypeZ, mostFinite(density, amp)), _density(density), _amp(amp), _densmul(th.rate.invSampleRate)
 	{
+		r.init(th.rgen.trand());
 	}
     
 	virtual const char* TypeName() const override { return "Dust"; }
 	
 	virtual void pull(Thread& th) override {
-		RGen& r = th.rgen;
 		int framesToFill = mBlockSize;
 		Z* out = mOut->fulfillz(framesToFill);
 		while (framesToFill) {
@@ -3077,16 +3075,17 @@ struct Dust2 : Gen
 	ZIn _density;
 	ZIn _amp;
 	Z _densmul;
+	CRGen r;
 	
 	Dust2(Thread& th, Arg density, Arg amp)
     : Gen(th, itemTypeZ, mostFinite(density, amp)), _density(density), _amp(amp), _densmul(th.rate.invSampleRate)
 	{
+		r.init(th.rgen.trand());
 	}
     
 	virtual const char* TypeName() const override { return "Dust2"; }
 	
 	virtual void pull(Thread& th) override {
-		RGen& r = th.rgen;
 		int framesToFill = mBlockSize;
 		Z* out = mOut->fulfillz(framesToFill);
 		while (framesToFill) {
@@ -3119,16 +3118,17 @@ struct Velvet : Gen
 	ZIn _density;
 	ZIn _amp;
 	Z _densmul;
+	CRGen r;
 	
 	Velvet(Thread& th, Arg density, Arg amp)
     : Gen(th, itemTypeZ, mostFinite(density, amp)), _density(density), _amp(amp), _densmul(th.rate.invSampleRate)
 	{
+		r.init(th.rgen.trand());
 	}
     
 	virtual const char* TypeName() const override { return "Velvet"; }
 	
 	virtual void pull(Thread& th) override {
-		RGen& r = th.rgen;
 		int framesToFill = mBlockSize;
 		Z* out = mOut->fulfillz(framesToFill);
 		while (framesToFill) {
@@ -0,0 +1,173 @@
+//    SAPF - Sound As Pure Form
+//    Copyright (C) 2019 James McCartney
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "Retention.hpp"
+#include "Play.hpp"
+#include <algorithm>
+#include <string>
+#include <thread>
+#include <unordered_set>
+
+const int kRetentionStep = 4096; // objects visited between yields.
+const size_t kRetentionLines = 20; // the largest retainers are listed, the rest summed.
+
+struct Retained
+{
+	std::string name;
+	int64_t lists = 0;
+	int64_t arrayBytes = 0;
+	int64_t gens = 0;
+	int64_t busy = 0; // lists that were being filled by another thread, and so not entered.
+};
+
+// walks everything reachable from one root.
+// a list's fields are copied under its lock. a list whose lock is held is being filled, possibly by this
+// thread further up the stack, so it is counted but not entered rather than waited for.
+class RetentionWalk
+{
+	std::vector<V> mStack;
+	std::unordered_set<Object*> mSeen;
+	Retained& mOut;
+
+	void push(Arg v)
+	{
+		if (v.isObject() && mSeen.insert(v.o()).second) mStack.push_back(v);
+	}
+	void visit(Arg v);
+
+public:
+	RetentionWalk(Arg root, Retained& out) : mOut(out) { push(root); }
+
+	// visits up to budget objects. returns true when the walk is finished.
+	bool step(int budget)
+	{
+		while (budget-- && !mStack.empty()) {
+			V v = mStack.back();
+			mStack.pop_back();
+			visit(v);
+		}
+		return mStack.empty();
+	}
+};
+
+void RetentionWalk::visit(Arg v)
+{
+	Object* o = v.o();
+	if (o->isList()) {
+		List* list = (List*)o;
+		P<List> next;
+		P<Array> array;
+		P<Gen> gen;
+		{
+			TrySpinLocker lock(list->mSpinLock);
+			if (!lock.owns()) {
+				++mOut.lists;
+				++mOut.busy;
+				return;
+			}
+			next = list->next();
+			array = list->mArray;
+			gen = list->mGen;
+		}
+		++mOut.lists;
+		if (gen() && mSeen.insert(gen()).second) ++mOut.gens;
+		push(V(array()));
+		push(V(next()));
+	} else if (o->isArray()) {
+		Array* a = (Array*)o;
+		mOut.arrayBytes += a->capacity() * a->elemSize();
+		if (a->isV()) {
+			for (int64_t i = 0; i < a->size(); ++i)
+				push(a->_at(i));
+		}
+	} else if (o->isForm()) {
+		Form* form = (Form*)o;
+		for (size_t i = 0; i < form->mTable->mMap->mSize; ++i)
+			push(form->mTable->mValues[i]);
+		push(V(form->mNextForm()));
+	} else if (o->isFun()) {
+		// not the function's workspace, which is the workspace being walked.
+		for (V const& var : ((Fun*)o)->mVars)
+			push(var);
+	} else if (o->isRef()) {
+		push(((Ref*)o)->deref());
+	}
+}
+
+static void walkRoot(Retained& r, Arg root)
+{
+	RetentionWalk walk(root, r);
+	while (!walk.step(kRetentionStep))
+		std::this_thread::yield();
+}
+
+void postRetention(Thread& th)
+{
+	std::vector<std::pair<std::string, V>> roots;
+	
+	// inner bindings hide outer ones of the same name.
+	std::unordered_set<std::string> names;
+	for (GForm* form = th.mWorkspace(); form; form = form->mNextForm()) {
+		for (P<TreeNode> const& node : form->mTable->sorted()) {
+			if (!node->mKey.isString()) continue;
+			std::string name = ((String*)node->mKey.o())->s;
+			if (names.insert(name).second) roots.emplace_back(name, node->mValue);
+		}
+	}
+	
+	for (size_t i = 0; i < th.stack.size(); ++i)
+		roots.emplace_back("stack " + std::to_string(i), th.stack[i]);
+	
+	std::vector<std::vector<V>> players;
+	collectPlayerInputs(players);
+	for (size_t i = 0; i < players.size(); ++i) {
+		for (size_t c = 0; c < players[i].size(); ++c)
+			roots.emplace_back("player " + std::to_string(i) + " channel " + std::to_string(c), players[i][c]);
+	}
+	
+	std::vector<Retained> results;
+	for (auto& root : roots) {
+		Retained r;
+		r.name = root.first;
+		walkRoot(r, root.second);
+		if (r.lists || r.arrayBytes || r.gens) results.push_back(r);
+	}
+	
+	std::sort(results.begin(), results.end(), [](Retained const& a, Retained const& b) {
+		return a.arrayBytes > b.arrayBytes || (a.arrayBytes == b.arrayBytes && a.lists > b.lists);
+	});
+	
+	if (results.empty()) {
+		post("nothing retains any lists.\n");
+		return;
+	}
+	post("%-24s %12s %14s %8s\n", "retained by", "lists", "array bytes", "gens");
+	for (size_t i = 0; i < results.size() && i < kRetentionLines; ++i) {
+		Retained const& r = results[i];
+		post("%-24s %12lld %14lld %8lld%s\n", r.name.c_str(), (long long)r.lists, (long long)r.arrayBytes, (long long)r.gens,
+			r.busy ? " (being filled)" : "");
+	}
+	if (results.size() > kRetentionLines) {
+		Retained rest;
+		for (size_t i = kRetentionLines; i < results.size(); ++i) {
+			rest.lists += results[i].lists;
+			rest.arrayBytes += results[i].arrayBytes;
+			rest.gens += results[i].gens;
+		}
+		std::string name = std::to_string(results.size() - kRetentionLines) + " more";
+		post("%-24s %12lld %14lld %8lld\n", name.c_str(), (long long)rest.lists, (long long)rest.arrayBytes, (long long)rest.gens);
+	}
+}
@@ -0,0 +1,161 @@
+//    SAPF - Sound As Pure Form
+//    Copyright (C) 2019 James McCartney
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "Server.hpp"
+#include "ErrorCodes.hpp"
+#include <string>
+#include <thread>
+#include <errno.h>
+#include <signal.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+// reads the next zero terminated request from the connection.
+// returns false when the client has closed the connection and nothing is left.
+static bool readRequest(int fd, std::string& pending, std::string& request)
+{
+	while (1) {
+		size_t end = pending.find('\0');
+		if (end != std::string::npos) {
+			request.assign(pending, 0, end);
+			pending.erase(0, end + 1);
+			return true;
+		}
+		char buf[4096];
+		ssize_t n = read(fd, buf, sizeof(buf));
+		if (n <= 0) {
+			if (pending.empty()) return false;
+			request.swap(pending);
+			pending.clear();
+			return true;
+		}
+		pending.append(buf, n);
+	}
+}
+
+static bool writeAll(int fd, const char* p, size_t n)
+{
+	while (n) {
+		ssize_t written = write(fd, p, n);
+		if (written <= 0) return false;
+		p += written;
+		n -= written;
+	}
+	return true;
+}
+
+static bool isQuit(std::string const& source)
+{
+	size_t begin = source.find_first_not_of(" \t\r\n");
+	size_t end = source.find_last_not_of(" \t\r\n");
+	return begin != std::string::npos && source.compare(begin, end + 1 - begin, "quit") == 0;
+}
+
+static void evalRequest(Thread& parent, std::string const& source, std::string& reply)
+{
+	std::string output;
+	bool ok = false;
+	{
+		PostCapture capture(output);
+		Thread th(parent);
+		// bindings made by the request go in its own table in front of the parent's workspace.
+		th.mWorkspace = new GForm(parent.mWorkspace);
+		try {
+			P<Fun> compiledFun;
+			if (th.compile(source.c_str(), compiledFun, true)) {
+				compiledFun->runREPL(th);
+				if (th.stackDepth()) {
+					th.printStack();
+					post("\n");
+				}
+				ok = true;
+			}
+		} catch (V& v) {
+			post("error: ");
+			v.print(th);
+			post("\n");
+		} catch (int err) {
+			if (err <= -1000 && err > -1000 - kNumErrors) {
+				post("error: %s\n", errString[-1000 - err]);
+			} else {
+				post("error: %d\n", err);
+			}
+		} catch (std::bad_alloc& xerr) {
+			post("not enough memory\n");
+		} catch (...) {
+			post("unknown error\n");
+		}
+	}
+	reply = ok ? "ok\n" : "error\n";
+	reply += output;
+}
+
+static void serveConnection(Thread& parent, int fd)
+{
+	std::string pending;
+	std::string request;
+	std::string reply;
+	while (readRequest(fd, pending, request)) {
+		if (isQuit(request)) break;
+		evalRequest(parent, request, reply);
+		if (!writeAll(fd, reply.c_str(), reply.size() + 1)) break; // includes the terminating zero.
+	}
+	close(fd);
+}
+
+void runServer(Thread& parent, const char* socketPath)
+{
+	struct sockaddr_un addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	if (strlen(socketPath) >= sizeof(addr.sun_path)) {
+		post("socket path is too long: '%s'\n", socketPath);
+		return;
+	}
+	strcpy(addr.sun_path, socketPath);
+	
+	int listenfd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (listenfd < 0) {
+		post("could not create socket\n");
+		return;
+	}
+	unlink(socketPath);
+	if (bind(listenfd, (struct sockaddr*)&addr, sizeof(addr)) < 0 || listen(listenfd, 64) < 0) {
+		post("could not listen on socket '%s'\n", socketPath);
+		close(listenfd);
+		return;
+	}
+	
+	// a client that goes away before reading its reply must not end the server.
+	signal(SIGPIPE, SIG_IGN);
+	
+	post("listening on '%s'\n", socketPath);
+	fflush(stdout);
+	
+	while (1) {
+		int fd = accept(listenfd, nullptr, nullptr);
+		if (fd < 0) {
+			if (errno == EINTR) continue;
+			post("accept failed %d\n", errno);
+			break;
+		}
+		std::thread(serveConnection, std::ref(parent), fd).detach();
+	}
+	close(listenfd);
+	unlink(socketPath);
+}
@@ -17,13 +17,31 @@
 #include "VM.hpp"
 #include "clz.hpp"
 
+// The set operations search lists through a hash index of the list's distinct elements.
+// The index is kept on the list, so searching the same list again does not rebuild it.
+// Signals get a ZSet, which hashes the raw samples. Other lists get a Set of V's.
+
+class SetIndex : public Object
+{
+public:
+	virtual bool isSet() const override { return true; }
+	virtual bool Equals(Thread& th, Arg v) override;
+	
+	virtual int size() const = 0;
+	virtual bool has(Thread& th, V& value) = 0;
+	virtual int indexOf(Thread& th, V& value) = 0;
+	
+	P<List> asVList(Thread& th);
+	P<List> asZList(Thread& th);
+};
+
 struct SetPair
 {
 	V mValue;
 	int mIndex;
 };
 
-class Set : public Object
+class Set : public SetIndex
 {
 	int mSize;
 	int mCap;
@@ -42,37 +60,82 @@ public:
 	virtual ~Set();
 	
 	virtual const char* TypeName() const override { return "Set"; }
-    
-	virtual bool isSet() const override { return true; }
-	virtual bool Equals(Thread& th, Arg v) override;
 	
-	int size() { return mSize; }
+	virtual int size() const override { return mSize; }
 	
-	bool has(Thread& th, V& value);
-    int indexOf(Thread& th, V& value);
+	virtual bool has(Thread& th, V& value) override;
+	virtual int indexOf(Thread& th, V& value) override;
 	
 	void put(Thread& th, V& inValue, int inIndex);
     
     void putAll(Thread& th, P<List>& list);
 	
 	virtual V at(int64_t i) override { return mPairs[i].mValue; }
-    
-    P<List> asVList(Thread& th);
-    P<List> asZList(Thread& th);
+};
+
+class ZSet : public SetIndex
+{
+	int mSize;
+	int mCap;
+	int* mIndices; // 2 * mCap slots. zero is empty, otherwise one more than an index into mValues.
+	Z* mValues;
+	int* mFirst; // the index in the list of the first occurrence of each value.
+	
+	ZSet(const ZSet& that) {}
+
+	static int hashz(Z z)
+	{
+		double d = z;
+		if (d == 0.) d = 0.; // so that -0 finds 0.
+		int64_t bits;
+		memcpy(&bits, &d, sizeof(bits));
+		return (int)Hash64(bits);
+	}
+	
+	int find(Z z) const
+	{
+		int mask = mCap * 2 - 1;
+		int index = hashz(z) & mask;
+		const int* indices = mIndices;
+		const Z* values = mValues;
+		while (1) {
+			int index2 = indices[index]-1;
+			if (index2 == -1) return -1;
+			if (values[index2] == z) return index2;
+			index = (index + 1) & mask;
+		}
+	}
+	
+public:
+	ZSet(Array* a);
+	virtual ~ZSet();
+	
+	virtual const char* TypeName() const override { return "ZSet"; }
+	
+	virtual int size() const override { return mSize; }
+	
+	bool hasz(Z z) const { return find(z) >= 0; }
+	int indexOfz(Z z) const { int i = find(z); return i < 0 ? -1 : mFirst[i]; }
+	Z z(int i) const { return mValues[i]; }
+	
+	virtual bool has(Thread& th, V& value) override { return value.isReal() && hasz(value.f); }
+	virtual int indexOf(Thread& th, V& value) override { return value.isReal() ? indexOfz(value.f) : -1; }
+	
+	virtual V at(int64_t i) override { return mValues[i]; }
+	virtual Z atz(int64_t i) override { return mValues[i]; }
 };
 
 
-bool Set::Equals(Thread& th, Arg v) 
+bool SetIndex::Equals(Thread& th, Arg v) 
 {
 	if (v.Identical(this)) return true;
 	if (!v.isSet()) return false;
 	if (this == v.o()) return true;
-	Set* that = (Set*)v.o();
-	if (mSize != that->size()) return false;
+	SetIndex* that = (SetIndex*)v.o();
+	if (size() != that->size()) return false;
     
-	for (int64_t i = 0; i < mSize; ++i) {
-		V& value = mPairs[i].mValue;
-		V u;
+	for (int64_t i = 0; i < size(); ++i) {
+		V value = at(i);
 		if (!that->has(th, value)) return false;
 	}
     
@@ -147,12 +210,22 @@ void Set::grow(Thread& th)
     
 	SetPair* oldPairs = mPairs;
 	int oldSize = mSize;
+	int oldCap = mCap;
     
-	alloc(mCap * 2);
+	mCap = NEXTPOWEROFTWO(oldCap * 2);
+	mPairs = new SetPair[mCap];
+	mIndices = (int*)calloc(2 * mCap, sizeof(int));
 	
+	// the values are already distinct, so they are moved into place without comparing them.
+	int mask = mCap * 2 - 1;
 	for (int i = 0; i < oldSize; ++i) {
 		SetPair& pair = oldPairs[i];
-		put(th, pair.mValue, pair.mIndex);
+		int index = pair.mValue.Hash() & mask;
+		while (mIndices[index]) index = (index + 1) & mask;
+		mIndices[index] = i+1;
+		mPairs[i].mValue.o.swap(pair.mValue.o);
+		mPairs[i].mValue.f = pair.mValue.f;
+		mPairs[i].mIndex = pair.mIndex;
 	}
 	
 	delete [] oldPairs;
@@ -190,16 +263,70 @@ void Set::put(Thread& th, V& inValue, int inIndex)
 void Set::putAll(Thread& th, P<List>& in)
 {
     // caller must ensure that in is finite.
-    int64_t insize = in->length(th);
     in = in->pack(th);
+    int64_t insize = in->mArray->size();
     for (int i = 0; i < insize; ++i) {
         V val = in->at(i);
         put(th, val, i);
     }
 }
 
+ZSet::ZSet(Array* a)
+{
+	int64_t n = a->size();
+	mCap = NEXTPOWEROFTWO(std::max(n, (int64_t)16));
+	mIndices = (int*)calloc(2 * mCap, sizeof(int));
+	mValues = (Z*)malloc(mCap * sizeof(Z));
+	mFirst = (int*)malloc(mCap * sizeof(int));
+	mSize = 0;
+	
+	const Z* zz = a->z();
+	int mask = mCap * 2 - 1;
+	for (int64_t i = 0; i < n; ++i) {
+		Z z = zz[i];
+		int index = hashz(z) & mask;
+		while (1) {
+			int index2 = mIndices[index]-1;
+			if (index2 == -1) {
+				index2 = mSize++;
+				mIndices[index] = index2+1;
+				mValues[index2] = z;
+				mFirst[index2] = (int)i;
+				break;
+			}
+			if (mValues[index2] == z) break;
+			index = (index + 1) & mask;
+		}
+	}
+}
+
+ZSet::~ZSet()
+{
+	free(mIndices);
+	free(mValues);
+	free(mFirst);
+}
+
+// returns the index of a finite list, building it if the list does not have one yet.
+static P<SetIndex> setIndex(Thread& th, P<List> const& list)
+{
+	{
+		SpinLocker lock(list->mSpinLock);
+		P<Object> index = list->mSetIndex;
+		if (index) return (SetIndex*)index();
+	}
+	
+	P<List> packed = list->pack(th);
+	P<SetIndex> index;
+	if (packed->isZ()) index = new ZSet(packed->mArray());
+	else index = new Set(th, packed);
+	
+	SpinLocker lock(list->mSpinLock);
+	list->mSetIndex = index;
+	return index;
+}
 
-P<List> Set::asVList(Thread& th)
+P<List> SetIndex::asVList(Thread& th)
 {
     int64_t outsize = size();
     
@@ -212,7 +339,7 @@ P<List> Set::asVList(Thread& th)
     return out;
 }
 
-P<List> Set::asZList(Thread& th)
+P<List> SetIndex::asZList(Thread& th)
 {
     int64_t outsize = size();
     
@@ -227,9 +354,7 @@ P<List> Set::asZList(Thread& th)
 
 static P<List> nub(Thread& th, P<List> in)
 {
-    P<Set> set = new Set(th, in);
-    
-    return set->asVList(th);
+    return setIndex(th, in)->asVList(th);
 }
 
 
@@ -242,57 +367,72 @@ static P<List> set_or(Thread& th, P<List> a, P<List> b)
     return a->isZ() && b->isZ() ? set->asZList(th) : set->asVList(th);
 }
 
+// the elements of setA for which setB->has is equal to want, in the order of setA.
+static void addMembers(Thread& th, SetIndex* setA, SetIndex* setB, bool want, P<List> const& out)
+{
+	if (out->isZ()) {
+		ZSet* za = (ZSet*)setA;
+		ZSet* zb = (ZSet*)setB;
+		for (int i = 0; i < za->size(); ++i) {
+			Z z = za->z(i);
+			if (zb->hasz(z) == want) out->addz(z);
+		}
+	} else {
+		for (int64_t i = 0; i < setA->size(); ++i) {
+			V v = setA->at(i);
+			if (setB->has(th, v) == want) out->add(v);
+		}
+	}
+}
+
 static P<List> set_and(Thread& th, P<List> a, P<List> b)
 {
-    P<Set> setA = new Set(th, a);
-    P<Set> setB = new Set(th, b);
+    P<SetIndex> setA = setIndex(th, a);
+    P<SetIndex> setB = setIndex(th, b);
     P<List> out = new List(a->isZ() && b->isZ() ? itemTypeZ : itemTypeV, 32);
     
-    for (int64_t i = 0; i < setA->size(); ++i) {
-        V v = setA->at(i);
-        if (setB->has(th, v)) out->add(v);
-    }
+    addMembers(th, setA(), setB(), true, out);
     
     return out;
 }
 
 static P<List> set_minus(Thread& th, P<List> a, P<List> b)
 {
-    P<Set> setA = new Set(th, a);
-    P<Set> setB = new Set(th, b);
+    P<SetIndex> setA = setIndex(th, a);
+    P<SetIndex> setB = setIndex(th, b);
     P<List> out = new List(a->isZ() && b->isZ() ? itemTypeZ : itemTypeV, 32);
     
-    for (int64_t i = 0; i < setA->size(); ++i) {
-        V v = setA->at(i);
-        if (!setB->has(th, v)) out->add(v);
-    }
+    addMembers(th, setA(), setB(), false, out);
     
     return out;
 }
 
 static P<List> set_xor(Thread& th, P<List> a, P<List> b)
 {
-    P<Set> setA = new Set(th, a);
-    P<Set> setB = new Set(th, b);
+    P<SetIndex> setA = setIndex(th, a);
+    P<SetIndex> setB = setIndex(th, b);
     P<List> out = new List(a->isZ() && b->isZ() ? itemTypeZ : itemTypeV, 32);
     
-    for (int64_t i = 0; i < setA->size(); ++i) {
-        V v = setA->at(i);
-        if (!setB->has(th, v)) out->add(v);
-    }
-    for (int64_t i = 0; i < setB->size(); ++i) {
-        V v = setB->at(i);
-        if (!setA->has(th, v)) out->add(v);
-    }
+    addMembers(th, setA(), setB(), false, out);
+    addMembers(th, setB(), setA(), false, out);
     
     return out;
 }
 
 static bool subset(Thread& th, P<List> a, P<List> b)
 {
-    P<Set> setA = new Set(th, a);
-    P<Set> setB = new Set(th, b);
+    P<SetIndex> setA = setIndex(th, a);
+    P<SetIndex> setB = setIndex(th, b);
 
+	if (a->isZ() && b->isZ()) {
+		ZSet* za = (ZSet*)setA();
+		ZSet* zb = (ZSet*)setB();
+		for (int i = 0; i < za->size(); ++i) {
+			if (!zb->hasz(za->z(i))) return false;
+		}
+		return true;
+	}
+	
     for (int64_t i = 0; i < setA->size(); ++i) {
         V v = setA->at(i);
         if (!setB->has(th, v)) return false;
@@ -303,10 +443,11 @@ static bool subset(Thread& th, P<List> a, P<List> b)
 
 static bool set_equals(Thread& th, P<List> a, P<List> b)
 {
-    P<Set> setA = new Set(th, a);
-    P<Set> setB = new Set(th, b);
+    P<SetIndex> setA = setIndex(th, a);
+    P<SetIndex> setB = setIndex(th, b);
 
-	return setA->Equals(th, setB);
+	if (setA->size() != setB->size()) return false;
+	return subset(th, a, b);
 }
 
 /* 
@@ -420,10 +561,10 @@ static void set_equals_(Thread& th, Prim* prim)
 
 struct FindV : Gen
 {
-	P<Set> mSet;
+	P<SetIndex> mSet;
 	VIn items;
 	
-	FindV(Thread& th, Arg inItems, P<Set> const& inSet)
+	FindV(Thread& th, Arg inItems, P<SetIndex> const& inSet)
 		: Gen(th, itemTypeV, inItems.isFinite()), mSet(inSet), items(inItems) {}
 		
 	const char* TypeName() const override { return "FindV"; }
@@ -453,11 +594,12 @@ struct FindV : Gen
 
 struct FindZ : Gen
 {
-	P<Set> mSet;
+	P<SetIndex> mSet;
+	ZSet* mZSet;
 	ZIn items;
 	
-	FindZ(Thread& th, Arg inItems, P<Set> const& inSet)
-		: Gen(th, itemTypeZ, inItems.isFinite()), mSet(inSet), items(inItems) {}
+	FindZ(Thread& th, Arg inItems, P<SetIndex> const& inSet)
+		: Gen(th, itemTypeZ, inItems.isFinite()), mSet(inSet), mZSet(dynamic_cast<ZSet*>(inSet())), items(inItems) {}
 		
 	const char* TypeName() const override { return "FindZ"; }
 	
@@ -473,10 +615,17 @@ struct FindZ : Gen
 				setDone();
 				break;
 			}
-			for (int i = 0; i < n; ++i) {
-				V va = *a;
-				out[i] = mSet->indexOf(th, va);
-				a += astride;
+			if (mZSet) {
+				for (int i = 0; i < n; ++i) {
+					out[i] = mZSet->indexOfz(*a);
+					a += astride;
+				}
+			} else {
+				for (int i = 0; i < n; ++i) {
+					V va = *a;
+					out[i] = mSet->indexOf(th, va);
+					a += astride;
+				}
 			}
 			items.advance(n);
 			framesToFill -= n;
@@ -488,10 +637,10 @@ struct FindZ : Gen
 
 struct SetHasV : Gen
 {
-	P<Set> mSet;
+	P<SetIndex> mSet;
 	VIn items;
 	
-	SetHasV(Thread& th, Arg inItems, P<Set> const& inSet)
+	SetHasV(Thread& th, Arg inItems, P<SetIndex> const& inSet)
 		: Gen(th, itemTypeV, inItems.isFinite()), mSet(inSet), items(inItems) {}
 		
 	const char* TypeName() const override { return "SetHasV"; }
@@ -521,11 +670,12 @@ struct SetHasV : Gen
 
 struct SetHasZ : Gen
 {
-	P<Set> mSet;
+	P<SetIndex> mSet;
+	ZSet* mZSet;
 	ZIn items;
 	
-	SetHasZ(Thread& th, Arg inItems, P<Set> const& inSet)
-		: Gen(th, itemTypeV, inItems.isFinite()), mSet(inSet), items(inItems) {}
+	SetHasZ(Thread& th, Arg inItems, P<SetIndex> const& inSet)
+		: Gen(th, itemTypeZ, inItems.isFinite()), mSet(inSet), mZSet(dynamic_cast<ZSet*>(inSet())), items(inItems) {}
 		
 	const char* TypeName() const override { return "SetHasZ"; }
 	
@@ -541,10 +691,17 @@ struct SetHasZ : Gen
 				setDone();
 				break;
 			}
-			for (int i = 0; i < n; ++i) {
-				V va = *a;
-				out[i] = mSet->has(th, va);
-				a += astride;
+			if (mZSet) {
+				for (int i = 0; i < n; ++i) {
+					out[i] = mZSet->hasz(*a);
+					a += astride;
+				}
+			} else {
+				for (int i = 0; i < n; ++i) {
+					V va = *a;
+					out[i] = mSet->has(th, va);
+					a += astride;
+				}
 			}
 			items.advance(n);
 			framesToFill -= n;
@@ -553,7 +710,7 @@ struct SetHasZ : Gen
 	}
 };
 
-static V findBase(Thread& th, V& a, P<Set> const& inSet)
+static V findBase(Thread& th, V& a, P<SetIndex> const& inSet)
 {
 	V result;
 	if (a.isList()) {
@@ -576,12 +733,12 @@ static void find_(Thread& th, Prim* prim)
 
 	V a = th.pop();
 
-    P<Set> setB = new Set(th, b);
+    P<SetIndex> setB = setIndex(th, b);
 	
 	th.push(findBase(th, a, setB));
 }
 
-static V hasBase(Thread& th, V& a, P<Set> const& inSet)
+static V hasBase(Thread& th, V& a, P<SetIndex> const& inSet)
 {
 	V result;
 	if (a.isList()) {
@@ -604,7 +761,7 @@ static void sethas_(Thread& th, Prim* prim)
 
 	V a = th.pop();
 
-    P<Set> setB = new Set(th, b);
+    P<SetIndex> setB = setIndex(th, b);
 	
 	th.push(hasBase(th, a, setB));
 }
@@ -1,8 +1,9 @@
 #ifndef SAPF_AUDIOTOOLBOX
 #include "SndfileSoundFile.hpp"
+#include <cmath>
 
-SndfileSoundFile::SndfileSoundFile(SNDFILE *inSndfile, int inNumChannels)
-	: mSndfile(inSndfile), mNumChannels(inNumChannels)
+SndfileSoundFile::SndfileSoundFile(SNDFILE *inSndfile, int inNumChannels, double inSampleRate)
+	: mSndfile(inSndfile), mNumChannels(inNumChannels), mSampleRate(inSampleRate)
 {}
 	
 SndfileSoundFile::~SndfileSoundFile() {
@@ -13,10 +14,24 @@ uint32_t SndfileSoundFile::numChannels() {
 	return this->mNumChannels;
 }
 
+double SndfileSoundFile::sampleRate() {
+	return this->mSampleRate;
+}
+
+int SndfileSoundFile::seek(double seconds) {
+	sf_count_t frame = (sf_count_t)floor(seconds * this->mSampleRate + .5);
+	sf_count_t result = sf_seek(this->mSndfile, frame, SEEK_SET);
+	return result < 0 ? (int)result : 0;
+}
+
 int SndfileSoundFile::pull(uint32_t *framesRead, PortableBuffers& buffers) {
-	buffers.interleaved.resize(*framesRead * this->mNumChannels * sizeof(double));
-	double *interleaved = (double *) buffers.interleaved.data();
+	buffers.interleaved.resize(*framesRead * this->mNumChannels * sizeof(Z));
+	Z *interleaved = (Z *) buffers.interleaved.data();
+#if SAMPLE_IS_DOUBLE
 	sf_count_t framesReallyRead = sf_readf_double(this->mSndfile, interleaved, *framesRead);
+#else
+	sf_count_t framesReallyRead = sf_readf_float(this->mSndfile, interleaved, *framesRead);
+#endif
 
 	int result = 0;
 	if(framesReallyRead >= 0) {
@@ -27,7 +42,7 @@ int SndfileSoundFile::pull(uint32_t *framesRead, PortableBuffers& buffers) {
 	}
 
 	for(int ch = 0; ch < this->mNumChannels; ch++) {
-		double *buf = (double *) buffers.buffers[ch].data;
+		Z *buf = (Z *) buffers.buffers[ch].data;
 		for(sf_count_t frame = 0; frame < framesReallyRead; frame++) {
 			buf[frame] = interleaved[frame * this->mNumChannels + ch];
 		}
@@ -36,7 +51,7 @@ int SndfileSoundFile::pull(uint32_t *framesRead, PortableBuffers& buffers) {
 	return result;
 }
 
-std::unique_ptr<SndfileSoundFile> SndfileSoundFile::open(const char *path) {
+std::unique_ptr<SndfileSoundFile> SndfileSoundFile::open(const char *path, double threadSampleRate) {
 	SNDFILE *sndfile = nullptr;
 	SF_INFO sfinfo = {0};
 		
@@ -55,7 +70,7 @@ std::unique_ptr<SndfileSoundFile> SndfileSoundFile::open(const char *path) {
 		return nullptr;
 	}
 		
-	return std::make_unique<SndfileSoundFile>(sndfile, numChannels);
+	return std::make_unique<SndfileSoundFile>(sndfile, numChannels, (double)sfinfo.samplerate);
 }
 
 std::unique_ptr<SndfileSoundFile> SndfileSoundFile::create(const char *path, int numChannels, double threadSampleRate, double fileSampleRate, bool interleaved) {
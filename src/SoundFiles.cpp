@@ -15,23 +15,328 @@
 //    along with this program.  If not, see <https://www.gnu.org/licenses/>.
 
 #include "SoundFiles.hpp"
+#include "MathFuns.hpp"
 #include <valarray>
+#include <atomic>
+#include <thread>
+#include <mutex>
 
 extern char gSessionTime[256];
 
-class SFReaderOutputChannel;
+////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-class SFReader : public Object
+// Sample rate conversion for files whose rate differs from the thread's.
+// Band limited interpolation with a kaiser windowed sinc kernel, about 90 dB of stop band rejection.
+
+const int kSRCZeroCrossings = 16;
+const int kSRCTableRes = 256;
+const double kSRCCutoff = .96;
+const double kSRCKaiserBeta = 8.6;
+
+static double gSRCKernel[kSRCZeroCrossings * kSRCTableRes + 2];
+
+static double src_bessi0(double x)
+{
+	double sum = 1., term = 1., x2 = .25 * x * x;
+	for (int k = 1; k < 50; ++k) {
+		term *= x2 / (k * k);
+		sum += term;
+		if (term < 1e-12 * sum) break;
+	}
+	return sum;
+}
+
+static void fillSRCKernel()
+{
+	const int n = kSRCZeroCrossings * kSRCTableRes;
+	double rb = 1. / src_bessi0(kSRCKaiserBeta);
+	for (int i = 0; i <= n; ++i) {
+		double x = (double)i / kSRCTableRes;
+		double w = x / kSRCZeroCrossings;
+		gSRCKernel[i] = sc_sinc(M_PI * x) * rb * src_bessi0(kSRCKaiserBeta * sqrt(std::max(0., 1. - w*w)));
+	}
+	gSRCKernel[n+1] = 0.;
+}
+
+static inline double srcKernel(double x)
+{
+	x = fabs(x) * kSRCTableRes;
+	if (x >= kSRCZeroCrossings * kSRCTableRes) return 0.;
+	int i = (int)x;
+	return lut(gSRCKernel, i, x - i);
+}
+
+class SFResampler
+{
+	double mStep = 1.; // input frames per output frame
+	double mScale = 1.; // kernel bandwidth relative to the input rate
+	int mTaps = 0; // taps on each side
+	double mInRate = 0., mOutRate = 0.;
+	int64_t mOutFrames = 0; // output frames computed so far
+	int64_t mHistStart = 0; // input frame of mHist[c][0]
+	int64_t mInFrames = 0;
+	std::vector<std::vector<Z>> mHist;
+	std::vector<double> mWeights;
+
+	void run(std::vector<Z>* out);
+
+public:
+	void init(int numChannels, double inRate, double outRate);
+	bool active() const { return mStep != 1.; }
+	int taps() const { return mTaps; }
+	double ratio() const { return 1. / mStep; }
+
+	// append n input frames per channel, append the output frames that can now be computed to out.
+	void process(int n, Z** in, std::vector<Z>* out);
+	// compute the remaining output frames after the end of the input.
+	void finish(std::vector<Z>* out);
+};
+
+void SFResampler::init(int numChannels, double inRate, double outRate)
+{
+	// two files may be opened at once.
+	static std::once_flag sKernelFilled;
+	std::call_once(sKernelFilled, fillSRCKernel);
+	mStep = inRate / outRate;
+	mScale = std::min(1., outRate / inRate) * kSRCCutoff;
+	mTaps = (int)ceil(kSRCZeroCrossings / mScale);
+	mInRate = inRate;
+	mOutRate = outRate;
+	mOutFrames = 0;
+	mHistStart = -mTaps;
+	mInFrames = 0;
+	mHist.assign(numChannels, std::vector<Z>(mTaps, 0.));
+	mWeights.resize(2 * mTaps);
+}
+
+void SFResampler::run(std::vector<Z>* out)
+{
+	int numChannels = (int)mHist.size();
+	int64_t histEnd = mHistStart + (int64_t)mHist[0].size();
+	double* w = mWeights.data();
+	// output frame j is at input frame j * mStep. compare in whole frames to get the length exactly right.
+	while (mOutFrames * mInRate < mInFrames * mOutRate) {
+		double t = mOutFrames * mStep;
+		int64_t i0 = (int64_t)floor(t);
+		if (i0 + mTaps >= histEnd) break;
+		double frac = t - i0;
+		for (int k = 0; k < 2 * mTaps; ++k) {
+			w[k] = mScale * srcKernel((k - mTaps + 1 - frac) * mScale);
+		}
+		for (int c = 0; c < numChannels; ++c) {
+			const Z* x = mHist[c].data() + (i0 - mTaps + 1 - mHistStart);
+			double sum = 0.;
+			for (int k = 0; k < 2 * mTaps; ++k) {
+				sum += w[k] * x[k];
+			}
+			out[c].push_back(sum);
+		}
+		++mOutFrames;
+	}
+	
+	// drop input that no output frame will use again.
+	int64_t keepFrom = (int64_t)floor(mOutFrames * mStep) - mTaps + 1;
+	if (keepFrom > mHistStart) {
+		int64_t drop = std::min(keepFrom - mHistStart, (int64_t)mHist[0].size());
+		for (int c = 0; c < numChannels; ++c) {
+			mHist[c].erase(mHist[c].begin(), mHist[c].begin() + drop);
+		}
+		mHistStart += drop;
+	}
+}
+
+void SFResampler::process(int n, Z** in, std::vector<Z>* out)
+{
+	for (size_t c = 0; c < mHist.size(); ++c) {
+		mHist[c].insert(mHist[c].end(), in[c], in[c] + n);
+	}
+	mInFrames += n;
+	run(out);
+}
+
+void SFResampler::finish(std::vector<Z>* out)
+{
+	for (size_t c = 0; c < mHist.size(); ++c) {
+		mHist[c].insert(mHist[c].end(), mTaps + 1, 0.);
+	}
+	run(out);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// A sound file is decoded and converted to the thread's sample rate by a background thread
+// that keeps a ring buffer ahead of the reader. Readers only copy out of the ring,
+// so disk I/O and resampling stay off the audio path. Half the ring is filled before the first read.
+// A reader that catches up with the disk never waits for it: the missing frames are read as silence,
+// the file resumes where it left off, and the underrun is counted and reported when the file is closed.
+
+const int kReadAheadFrames = 1 << 17; // per channel. a power of two.
+const int kReadChunkFrames = 8192;
+
+class SFReadAhead
 {
 	std::unique_ptr<SoundFile> mSoundFile;
+	int mNumChannels;
+	int mChunkFrames;
+	std::vector<Z> mRing; // kReadAheadFrames per channel
+	std::atomic<int64_t> mWritePos;
+	std::atomic<int64_t> mReadPos;
+	std::atomic<bool> mEOF;
+	std::atomic<bool> mQuit;
+	int64_t mUnderruns = 0; // only used by the reader.
+
+	std::vector<Z> mChunk;
 	AudioBuffers mBuffers;
+	SFResampler mResampler;
+	std::vector<std::vector<Z>> mConverted;
+	std::thread mThread;
+
+	bool fill();
+	void run();
+	void write(int n, Z** in);
+
+public:
+	SFReadAhead(std::unique_ptr<SoundFile> inSoundFile, double inOutRate);
+	~SFReadAhead();
+
+	int numChannels() const { return mNumChannels; }
+
+	// copy n frames of each channel to out, padding with silence if the disk is behind.
+	// returns the number of frames copied, fewer than n only at the end of the file.
+	int read(int n, Z** out);
+};
+
+SFReadAhead::SFReadAhead(std::unique_ptr<SoundFile> inSoundFile, double inOutRate)
+	: mSoundFile(std::move(inSoundFile)), mNumChannels(mSoundFile->numChannels()),
+	mWritePos(0), mReadPos(0), mEOF(false), mQuit(false), mBuffers(mNumChannels)
+{
+	double fileRate = mSoundFile->sampleRate();
+	if (fileRate <= 0.) fileRate = inOutRate;
+	mResampler.init(mNumChannels, fileRate, inOutRate);
+	mConverted.resize(mNumChannels);
+
+	// a chunk after conversion must fit in half the ring.
+	mChunkFrames = (int)std::max(1., std::min((double)kReadChunkFrames, floor(.5 * kReadAheadFrames / mResampler.ratio()) - mResampler.taps() - 1.));
+	mChunk.resize((size_t)mChunkFrames * mNumChannels);
+	mRing.resize((size_t)kReadAheadFrames * mNumChannels);
+
+	// have half the ring ready before anyone reads.
+	bool more;
+	while ((more = fill()) && mWritePos.load(std::memory_order_relaxed) < kReadAheadFrames / 2) {}
+	if (more)
+		mThread = std::thread([this]() { run(); });
+}
+
+SFReadAhead::~SFReadAhead()
+{
+	mQuit.store(true);
+	if (mThread.joinable())
+		mThread.join();
+	if (mUnderruns)
+		post("sound file read ahead fell behind %lld times. the missing frames were read as silence.\n", (long long)mUnderruns);
+}
+
+void SFReadAhead::write(int n, Z** in)
+{
+	int64_t writePos = mWritePos.load(std::memory_order_relaxed);
+	const int mask = kReadAheadFrames - 1;
+	for (int c = 0; c < mNumChannels; ++c) {
+		Z* ring = mRing.data() + (size_t)c * kReadAheadFrames;
+		int i = (int)(writePos & mask);
+		int n1 = std::min(n, kReadAheadFrames - i);
+		memcpy(ring + i, in[c], n1 * sizeof(Z));
+		memcpy(ring, in[c] + n1, (n - n1) * sizeof(Z));
+	}
+	mWritePos.store(writePos + n, std::memory_order_release);
+}
+
+bool SFReadAhead::fill()
+{
+	std::vector<Z*> chunk(mNumChannels);
+	for (int c = 0; c < mNumChannels; ++c) {
+		chunk[c] = mChunk.data() + (size_t)c * mChunkFrames;
+		mBuffers.setNumChannels(c, 1);
+		mBuffers.setData(c, chunk[c]);
+		mBuffers.setSize(c, mChunkFrames * sizeof(Z));
+	}
+
+	uint32_t framesRead = mChunkFrames;
+	int err = mSoundFile->pull(&framesRead, mBuffers);
+	if (err) {
+		post("error reading sound file %d\n", err);
+		framesRead = 0;
+	}
+	bool more = framesRead > 0;
+
+	if (!mResampler.active()) {
+		if (framesRead) write(framesRead, chunk.data());
+	} else {
+		for (int c = 0; c < mNumChannels; ++c) mConverted[c].clear();
+		if (more) mResampler.process(framesRead, chunk.data(), mConverted.data());
+		else mResampler.finish(mConverted.data());
+		int n = (int)mConverted[0].size();
+		if (n) {
+			for (int c = 0; c < mNumChannels; ++c) chunk[c] = mConverted[c].data();
+			write(n, chunk.data());
+		}
+	}
+
+	if (!more) mEOF.store(true, std::memory_order_release);
+	return more;
+}
+
+void SFReadAhead::run()
+{
+	while (!mQuit.load(std::memory_order_relaxed)) {
+		int64_t used = mWritePos.load(std::memory_order_relaxed) - mReadPos.load(std::memory_order_acquire);
+		if (used > kReadAheadFrames / 2) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(2));
+			continue;
+		}
+		if (!fill()) break;
+	}
+}
+
+int SFReadAhead::read(int n, Z** out)
+{
+	int64_t readPos = mReadPos.load(std::memory_order_relaxed);
+		bool eof = mEOF.load(std::memory_order_acquire);
+	int64_t avail = mWritePos.load(std::memory_order_acquire) - readPos;
+	int m = (int)std::min((int64_t)n, avail);
+
+	const int mask = kReadAheadFrames - 1;
+	for (int c = 0; c < mNumChannels; ++c) {
+		const Z* ring = mRing.data() + (size_t)c * kReadAheadFrames;
+		int i = (int)(readPos & mask);
+		int m1 = std::min(m, kReadAheadFrames - i);
+		memcpy(out[c], ring + i, m1 * sizeof(Z));
+		memcpy(out[c] + m1, ring, (m - m1) * sizeof(Z));
+	}
+	mReadPos.store(readPos + m, std::memory_order_release);
+	if (m == n || eof) return m;
+
+	// the disk is behind. don't wait for it.
+	for (int c = 0; c < mNumChannels; ++c)
+		memset(out[c] + m, 0, (n - m) * sizeof(Z));
+	++mUnderruns;
+	return n;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+class SFReaderOutputChannel;
+
+class SFReader : public Object
+{
+	SFReadAhead mReadAhead;
 	SFReaderOutputChannel* mOutputs;
+	std::vector<Z*> mOutBuffers;
 	int64_t mFramesRemaining;
 	bool mFinished = false;
 	
 public:
 	
-	SFReader(std::unique_ptr<SoundFile> inSoundFile, int64_t inDuration);
+	SFReader(std::unique_ptr<SoundFile> inSoundFile, double inSampleRate, int64_t inDuration);
 	
 	~SFReader();
 
@@ -79,9 +384,9 @@ public:
 	
 };
 
-SFReader::SFReader(std::unique_ptr<SoundFile> inSoundFile, int64_t inDuration) :
-	mSoundFile(std::move(inSoundFile)),
-	mBuffers(mSoundFile->numChannels()),
+SFReader::SFReader(std::unique_ptr<SoundFile> inSoundFile, double inSampleRate, int64_t inDuration) :
+	mReadAhead(std::move(inSoundFile), inSampleRate),
+	mOutBuffers(mReadAhead.numChannels()),
 	mFramesRemaining(inDuration)
 {
 	
@@ -100,7 +405,6 @@ SFReader::~SFReader()
 void SFReader::fulfillOutputs(int blockSize)
 {
 	SFReaderOutputChannel* output = mOutputs;
-	size_t bufSize = blockSize * sizeof(Z);
 	for (int i = 0; output; ++i, output = output->mNextOutput){
 		Z* out;
 		if (output->mOut)
@@ -112,11 +416,7 @@ void SFReader::fulfillOutputs(int blockSize)
 			out = output->mDummy;
 		}
 
-		this->mBuffers.setNumChannels(i, 1);
-		this->mBuffers.setData(i, out);
-		this->mBuffers.setSize(i, bufSize);
-		
-		memset(out, 0, bufSize);
+		mOutBuffers[i] = out;
 	};
 }
 
@@ -132,7 +432,7 @@ void SFReader::produceOutputs(int shrinkBy)
 
 P<List> SFReader::createOutputs(Thread& th)
 {
-	const uint32_t numChannels = mSoundFile->numChannels();
+	const uint32_t numChannels = mReadAhead.numChannels();
 	P<List> s = new List(itemTypeV, numChannels);
 	
 	// fill s->mArray with ola's output channels.
@@ -164,11 +464,9 @@ bool SFReader::pull(Thread& th)
 	
 	fulfillOutputs(blockSize);
 	
-	// read file here.
-	uint32_t framesRead = blockSize;
-	int err = mSoundFile->pull(&framesRead, mBuffers);
+	int framesRead = mReadAhead.read(blockSize, mOutBuffers.data());
 		
-	if (err || framesRead == 0) {
+	if (framesRead == 0) {
 		mFinished = true;
 	}
 	
@@ -178,14 +476,19 @@ bool SFReader::pull(Thread& th)
 	return mFinished; 
 }
 
-void sfread(Thread& th, Arg filename, int64_t offset, int64_t frames)
+void sfread(Thread& th, Arg filename, double offset, double duration)
 {
 	const char* path = ((String*)filename.o())->s;
 
-	std::unique_ptr<SoundFile> soundFile = SoundFile::open(path);
+	std::unique_ptr<SoundFile> soundFile = SoundFile::open(path, th.rate.sampleRate);
 
 	if(soundFile != nullptr) {
-		SFReader* sfr = new SFReader(std::move(soundFile), -1);
+		if (offset > 0. && soundFile->seek(offset)) {
+			post("seek failed\n");
+			throw errFailed;
+		}
+		int64_t frames = duration < 0. ? -1 : (int64_t)floor(duration * th.rate.sampleRate + .5);
+		SFReader* sfr = new SFReader(std::move(soundFile), th.rate.sampleRate, frames);
 		th.push(sfr->createOutputs(th));
 	}
 }
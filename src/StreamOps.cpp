@@ -23,10 +23,14 @@
 #include <float.h>
 #include <vector>
 #include <algorithm>
+#include <deque>
+#include <thread>
+#include <exception>
 #include "MultichannelExpansion.hpp"
 #include "UGen.hpp"
 #include "dsp.hpp"
 #include "SoundFiles.hpp"
+#include "Opcode.hpp"
 
 const Z kOneThird = 1. / 3.;
 
@@ -868,7 +872,7 @@ static Z degkey(Z degree, P<Array> const& scale, Z cycleWidth, int degreesPerCyc
 
 static Z keydeg(Z key, P<Array> const& scale, Z cycleWidth, int degreesPerCycle)
 {
-	Z cycles, cyckey;
+	double cycles, cyckey;
 	sc_fdivmod(key, cycleWidth, cycles, cyckey);
 	
 	Z frac = scale->atz(0) + cycleWidth - cyckey;
@@ -1594,7 +1598,7 @@ struct Ever : public Gen
 {
 	V _val;
 
-	Ever(Thread& th, Arg val) : Gen(th, itemTypeV, false), _val(val) {}
+	Ever(Thread& th, Arg val) : Gen(th, itemTypeV, false), _val(val) { setReadAhead(); }
 
 	virtual const char* TypeName() const override { return "Ever"; }
 
@@ -1640,7 +1644,7 @@ struct By : public Gen
 	V _start;
 	V _step;
 
-	By(Thread& th, Arg start, Arg step) : Gen(th, itemTypeV, false), _start(start), _step(step) {}
+	By(Thread& th, Arg start, Arg step) : Gen(th, itemTypeV, false), _start(start), _step(step) { setReadAhead(); }
 
 	virtual const char* TypeName() const override { return "By"; }
 
@@ -1685,7 +1689,7 @@ struct Grow : public Gen
 	V _start;
 	V _step;
 
-	Grow(Thread& th, Arg start, Arg step) : Gen(th, itemTypeV, false), _start(start), _step(step) {}
+	Grow(Thread& th, Arg start, Arg step) : Gen(th, itemTypeV, false), _start(start), _step(step) { setReadAhead(); }
 
 	virtual const char* TypeName() const override { return "Grow"; }
 
@@ -1730,7 +1734,7 @@ struct CubicLine : public Gen
 	V _start;
 	V _step;
 
-	CubicLine(Thread& th, Arg start, Arg step) : Gen(th, itemTypeV, false), _start(start), _step(step) {}
+	CubicLine(Thread& th, Arg start, Arg step) : Gen(th, itemTypeV, false), _start(start), _step(step) { setReadAhead(); }
 
 	virtual const char* TypeName() const override { return "CubicLine"; }
 
@@ -1775,7 +1779,7 @@ struct Inv : public Gen
 {
 	V _start;
 
-	Inv(Thread& th) : Gen(th, itemTypeV, false), _start(1.) {}
+	Inv(Thread& th) : Gen(th, itemTypeV, false), _start(1.) { setReadAhead(); }
 
 	virtual const char* TypeName() const override { return "Inv"; }
 
@@ -1821,7 +1825,7 @@ struct NInv : public Gen
 	V _start;
 	int64_t _n;
 
-	NInv(Thread& th, int64_t n) : Gen(th, itemTypeV, true), _start(1.), _n(n) {}
+	NInv(Thread& th, int64_t n) : Gen(th, itemTypeV, true), _start(1.), _n(n) { setReadAhead(); }
 
 	virtual const char* TypeName() const override { return "NInv"; }
 
@@ -1878,7 +1882,7 @@ struct NBy : public Gen
 	V _step;
 	int64_t _n;
 
-	NBy(Thread& th, Arg start, Arg step, int64_t n) : Gen(th, itemTypeV, true), _start(start), _step(step), _n(n) {}
+	NBy(Thread& th, Arg start, Arg step, int64_t n) : Gen(th, itemTypeV, true), _start(start), _step(step), _n(n) { setReadAhead(); }
 
 	virtual const char* TypeName() const override { return "NBy"; }
 
@@ -1936,7 +1940,7 @@ struct NGrow : public Gen
 	V _step;
 	int64_t _n;
 
-	NGrow(Thread& th, Arg start, Arg step, int64_t n) : Gen(th, itemTypeV, true), _start(start), _step(step), _n(n) {}
+	NGrow(Thread& th, Arg start, Arg step, int64_t n) : Gen(th, itemTypeV, true), _start(start), _step(step), _n(n) { setReadAhead(); }
 
 	virtual const char* TypeName() const override { return "NGrow"; }
 
@@ -2022,7 +2026,7 @@ struct Fib : public Gen
 	V _a;
 	V _b;
     
-	Fib(Thread& th, Arg a, Arg b) : Gen(th, itemTypeV, false), _a(a), _b(b) {}
+	Fib(Thread& th, Arg a, Arg b) : Gen(th, itemTypeV, false), _a(a), _b(b) { setReadAhead(); }
     
 	virtual const char* TypeName() const override { return "Fib"; }
         
@@ -2428,7 +2432,7 @@ struct Ints : public Gen
 {
 	Z _a;
     
-	Ints(Thread& th) : Gen(th, itemTypeV, false), _a(0.) {}
+	Ints(Thread& th) : Gen(th, itemTypeV, false), _a(0.) { setReadAhead(); }
     
 	virtual const char* TypeName() const override { return "Ints"; }
     
@@ -2487,10 +2491,9 @@ static void intz_(Thread& th, Prim* prim)
 
 struct Primes : Gen
 {
-	int byte;
-	int bit;
+	PrimeCursor cursor;
 	
-	Primes(Thread& th) : Gen(th, itemTypeV, false), byte(-1), bit(0) {}
+	Primes(Thread& th) : Gen(th, itemTypeV, false) { setReadAhead(); }
     
 	virtual const char* TypeName() const override { return "Primes"; }
         
@@ -2499,44 +2502,23 @@ struct Primes : Gen
 		int n = mBlockSize;
 		V* out = mOut->fulfill(n);
 		for (int i = 0; i < n; ++i) {
-            if (byte < 0) {
-                out[i] = gLowPrimes[bit];
-                if (++bit >= 10) {
-                    byte = 0;
-                    bit = 0;
-                }
-            } else {
-                while (1) {
-					if (byte >= kPrimesMaskSize) {
-						setDone();
-						produce(n - i);
-						return;
-					} else if (gPrimesMask[byte] & (1 << bit)) {
-                        out[i] = 30 * (1 + byte) + gPrimeOffsets[bit];
-						if (++bit >= 8) {
-                            ++byte;
-                            bit = 0;
-                        }
-                        break;
-                    } else {
-						if (++bit >= 8) {
-                            ++byte;
-                            bit = 0;
-                        }
-                    }
-                }
-            }
-        }
+			int64_t p = cursor.next();
+			if (!p) {
+				setDone();
+				produce(n - i);
+				return;
+			}
+			out[i] = p;
+		}
 		mOut = mOut->nextp();
     }
 };
 
 struct Primez : Gen
 {
-	int byte;
-	int bit;
+	PrimeCursor cursor;
 	
-	Primez(Thread& th) : Gen(th, itemTypeZ, false), byte(-1), bit(0) {}
+	Primez(Thread& th) : Gen(th, itemTypeZ, false) {}
     
 	virtual const char* TypeName() const override { return "Primez"; }
         
@@ -2545,34 +2527,14 @@ struct Primez : Gen
 		int n = mBlockSize;
 		Z* out = mOut->fulfillz(n);
 		for (int i = 0; i < n; ++i) {
-            if (byte < 0) {
-                out[i] = gLowPrimes[bit];
-                if (++bit >= 10) {
-                    byte = 0;
-                    bit = 0;
-                }
-            } else {
-                while (1) {
-					if (byte >= kPrimesMaskSize) {
-						setDone();
-						produce(n - i);
-						return;
-                    } else if (gPrimesMask[byte] & (1 << bit)) {
-                        out[i] = 30 * (1 + byte) + gPrimeOffsets[bit];
-						if (++bit >= 8) {
-                            ++byte;
-                            bit = 0;
-                        }
-                        break;
-                    } else {
-                        if (++bit >= 8) {
-                            ++byte;
-                            bit = 0;
-                        }
-                    }
-                }
-            }
-        }
+			int64_t p = cursor.next();
+			if (!p) {
+				setDone();
+				produce(n - i);
+				return;
+			}
+			out[i] = p;
+		}
 		mOut = mOut->nextp();
     }
 };
@@ -2927,7 +2889,7 @@ struct Repeat : Gen
     V _a;
 	int64_t _m;
     
-	Repeat(Thread& th, Arg a, int64_t m) : Gen(th, itemTypeV, m < LLONG_MAX), _a(a), _m(m) {}
+	Repeat(Thread& th, Arg a, int64_t m) : Gen(th, itemTypeV, m < LLONG_MAX), _a(a), _m(m) { setReadAhead(); }
 	    
 	virtual const char* TypeName() const override { return "Repeat"; }
 	
@@ -3085,6 +3047,7 @@ struct RCyc : public Gen
 	P<List> _a0;
 	P<List> _a;
 
+	// not read ahead. the ref is read again at each cycle, so a change to it should be heard at the next one.
 	RCyc(Thread& th, Arg ref, P<List> const& a) : Gen(th, a->elemType, false), _ref(ref), _a0(a), _a(a) {}
 
 	virtual const char* TypeName() const override { return "RCyc"; }
@@ -3110,7 +3073,7 @@ struct Cyc : public Gen
 	P<List> _a0;
 	P<List> _a;
 
-	Cyc(Thread& th, P<List> const& a) : Gen(th, a->elemType, false), _a0(a), _a(a) {}
+	Cyc(Thread& th, P<List> const& a) : Gen(th, a->elemType, false), _a0(a), _a(a) { setReadAhead(a); }
 
 	virtual const char* TypeName() const override { return "Cyc"; }
 
@@ -3131,7 +3094,7 @@ struct NCyc : public Gen
 	P<List> _a;
 	int64_t _n;
 	
-	NCyc(Thread& th, int64_t n, P<List> const& a) : Gen(th, a->elemType, true), _a0(a), _a(a), _n(n) {}
+	NCyc(Thread& th, int64_t n, P<List> const& a) : Gen(th, a->elemType, true), _a0(a), _a(a), _n(n) { setReadAhead(a); }
 
 	virtual const char* TypeName() const override { return "Cyc"; }
 
@@ -3350,6 +3313,15 @@ struct Cat : Gen
 	{
 		V v;
 		_b.one(th, v); // skip over a.
+		// the rest of b may hold functions that make the next list, so only read ahead when b is already all lists.
+		if (b->isPacked()) {
+			P<Array> const& items = b->mArray;
+			for (int64_t i = 0; i < items->size(); ++i) {
+				V item = items->at(i);
+				if (!item.isVList() || !canReadAhead(item)) return;
+			}
+			setReadAhead(a);
+		}
 	}
 	virtual const char* TypeName() const override { return "Cat"; }
 
@@ -3465,6 +3437,7 @@ struct Flat : Gen
 	{
 		VIn vin(inA);
 		in.push(vin);
+		setReadAhead(inA);
 	}
 	virtual const char* TypeName() const override { return "Flat"; }
 
@@ -3505,6 +3478,7 @@ struct Flatten : Gen
 	{
 		VIn vin(inA);
 		in.push(vin);
+		setReadAhead(inA);
 	}
 	virtual const char* TypeName() const override { return "Flat"; }
 
@@ -3541,7 +3515,7 @@ struct Keep : Gen
 	VIn _a;
 	int64_t _n;
 	
-	Keep(Thread& th, int64_t n, Arg a) : Gen(th, itemTypeV, true), _a(a), _n(n) {}
+	Keep(Thread& th, int64_t n, Arg a) : Gen(th, itemTypeV, true), _a(a), _n(n) { setReadAhead(a); }
 	virtual const char* TypeName() const override { return "Keep"; }
     	
 	virtual void pull(Thread& th) override {
@@ -3578,7 +3552,7 @@ struct Take : Gen
 	VIn _a;
 	int64_t _n;
 	
-	Take(Thread& th, int64_t n, Arg a) : Gen(th, itemTypeV, true), _a(a), _n(n) {}
+	Take(Thread& th, int64_t n, Arg a) : Gen(th, itemTypeV, true), _a(a), _n(n) { setReadAhead(a); }
 	virtual const char* TypeName() const override { return "Take"; }
     	
 	virtual void pull(Thread& th) override {
@@ -3598,7 +3572,7 @@ struct Take : Gen
 					mOut->link(th, g());
                     return;
                 } else {
-					_n -= framesToFill;
+					_n -= n;
 					for (int i = 0; i < n; ++i) {
                         out[i] = *a;
 						a += astride;
@@ -3675,7 +3649,7 @@ struct Takez : Gen
 					mOut->link(th, g());
                     return;
                 } else {
-					_n -= framesToFill;
+					_n -= n;
 					for (int i = 0; i < n; ++i) {
                         out[i] = *a;
 						a += astride;
@@ -4639,13 +4613,13 @@ static void histo_(Thread& th, Prim* prim)
 		Z* in = a->mArray->z();
 		
 		for (int64_t i = 0; i < size; ++i) {
-			int64_t j = (int64_t)std::clamp(in[i], 0., n1);
+			int64_t j = (int64_t)std::clamp<Z>(in[i], 0., n1);
 			out[j] += 1.;
 		}
 	} else {
 		V* in = a->mArray->v();
 		for (int64_t i = 0; i < size; ++i) {
-			int64_t j = (int64_t)std::clamp(in[i].asFloat(), 0., n1);
+			int64_t j = (int64_t)std::clamp<Z>(in[i].asFloat(), 0., n1);
 			out[j] += 1.;
 		}
 	}
@@ -5502,6 +5476,11 @@ static void stopDone_(Thread& th, Prim* prim)
 	stopPlayingIfDone();
 }
 
+static void audiostats_(Thread& th, Prim* prim)
+{
+	postAudioStats();
+}
+
 static void interleave(int stride, int numFrames, double* in, float* out)
 {
 	for (int f = 0, k = 0; f < numFrames; ++f, k += stride)
@@ -5570,6 +5549,7 @@ static const size_t gSessionTimeMaxLen = 256;
 char gSessionTime[gSessionTimeMaxLen];
 
 #include <time.h>
+#include <unistd.h>
 
 static void setSessionTime()
 {
@@ -5608,7 +5588,63 @@ static void sfread_(Thread& th, Prim* prim)
 	
 	V filename = th.popString("sf> : filename");
 		
-	sfread(th, filename, 0, -1);
+	sfread(th, filename, 0., -1.);
+}
+
+static void sfreadseg_(Thread& th, Prim* prim)
+{
+	double duration = th.popFloat("sfseg> : duration");
+	double offset = th.popFloat("sfseg> : offset");
+	V filename = th.popString("sfseg> : filename");
+	
+	if (offset < 0.) throw errOutOfRange;
+		
+	sfread(th, filename, offset, duration);
+}
+
+static void zfwrite_(Thread& th, Prim* prim)
+{
+	P<String> filename = th.popString(">zf : filename");
+	P<List> list = th.popZList(">zf : signal");
+	if (!list->isFinite()) indefiniteOp(">zf : signal", "");
+
+	// write to a temporary file and rename it over the target. the target may still be mapped by zf>,
+	// and truncating it in place would pull the pages out from under that mapping.
+	std::string tmpPath = filename->s;
+	tmpPath += ".tmp";
+	FILE* f = fopen(tmpPath.c_str(), "wb");
+	if (!f) {
+		post("could not open '%s'\n", tmpPath.c_str());
+		throw errFailed;
+	}
+	// only the unwritten part of the signal is kept alive.
+	bool ok = true;
+	try {
+		while (list && ok) {
+			list->force(th);
+			Array* a = list->mArray();
+			ok = fwrite(a->z(), sizeof(Z), a->size(), f) == (size_t)a->size();
+			list = list->next();
+		}
+	} catch (...) {
+		fclose(f);
+		unlink(tmpPath.c_str());
+		throw;
+	}
+	ok = ok && fflush(f) == 0 && fsync(fileno(f)) == 0;
+	ok = fclose(f) == 0 && ok;
+	if (!ok || rename(tmpPath.c_str(), filename->s) != 0) {
+		unlink(tmpPath.c_str());
+		post("write to '%s' failed\n", filename->s);
+		throw errFailed;
+	}
+}
+
+static void zfread_(Thread& th, Prim* prim)
+{
+	P<String> filename = th.popString("zf> : filename");
+	P<Array> a = Array::mapZFile(filename->s);
+	th.push(new List(a));
 }
 
 
@@ -5757,7 +5793,7 @@ static double kaiser_alpha(double atten)
 	return alpha;
 }
 
-static void kaiser(size_t m, double *s, double alpha)
+static void kaiser(size_t m, Z *s, double alpha)
 {
 	if (m == 0) return;
 	if (m == 1) {
@@ -6262,6 +6298,12 @@ static void packed_(Thread& th, Prim* prim)
 	th.pushBool(list->isPacked());
 }
 
+static void forced_(Thread& th, Prim* prim)
+{
+	P<List> list = th.popList("forced : list");
+	th.pushBool(!list->isThunk());
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 struct Scan : Gen
@@ -6921,6 +6963,233 @@ static void mergec_(Thread& th, Prim* prim)
 	}
 }
 
+// a binary min heap of input indices for the n-ary merges.
+// before(i, j) is true when the next item of input i should be output before that of input j.
+struct MergeHeap
+{
+	std::vector<int> heap;
+
+	bool empty() const { return heap.empty(); }
+	size_t size() const { return heap.size(); }
+	int top() const { return heap[0]; }
+
+	template <class Before>
+	void push(int k, Before&& before)
+	{
+		heap.push_back(k);
+		size_t i = heap.size() - 1;
+		while (i > 0) {
+			size_t parent = (i - 1) / 2;
+			if (!before(heap[i], heap[parent])) break;
+			std::swap(heap[i], heap[parent]);
+			i = parent;
+		}
+	}
+
+	template <class Before>
+	void pop(Before&& before)
+	{
+		heap[0] = heap.back();
+		heap.pop_back();
+		if (!heap.empty()) fixTop(before);
+	}
+
+	// restore the order after the next item of the top input changed.
+	template <class Before>
+	void fixTop(Before&& before)
+	{
+		size_t n = heap.size();
+		size_t i = 0;
+		while (1) {
+			size_t least = i;
+			size_t left = 2 * i + 1;
+			size_t right = left + 1;
+			if (left < n && before(heap[left], heap[least])) least = left;
+			if (right < n && before(heap[right], heap[least])) least = right;
+			if (least == i) break;
+			std::swap(heap[i], heap[least]);
+			i = least;
+		}
+	}
+};
+
+static P<Array> mergeInputs(Thread& th, P<List> const& streams, const char* msg, bool& outFinite)
+{
+	if (!streams->isFinite()) indefiniteOp(msg, "");
+	P<List> s = streams->pack(th);
+	P<Array> a = s->mArray;
+	outFinite = true;
+	for (int64_t i = 0; i < a->size(); ++i) {
+		V v = a->at(i);
+		if (!v.isList()) wrongType(msg, "List", v);
+		if (!v.isFinite()) outFinite = false;
+	}
+	return a;
+}
+
+static bool mergeOne(Thread& th, VIn& in, V& v) { return in.one(th, v); }
+static bool mergeOne(Thread& th, ZIn& in, Z& z) { return in.onez(th, z); }
+static V* mergeFulfill(List* out, int n, V*) { return out->fulfill(n); }
+static Z* mergeFulfill(List* out, int n, Z*) { return out->fulfillz(n); }
+
+enum { mergeByFun, mergeByKey, mergeByCmp };
+
+// merges any number of sorted streams. the inputs are kept in a heap ordered by their next item,
+// so each output item costs O(log n) comparisons instead of passing through n - 1 nested merges.
+// inputs that tie go out in input order, except when merging with a predicate function.
+template <class T, class In>
+struct MergeN : Gen
+{
+	std::vector<In> in_;
+	std::vector<T> heads;
+	std::vector<V> keys;
+	std::vector<int> equal;
+	MergeHeap heap;
+	V fun_;
+	int mode;
+	bool once = true;
+	bool failed = false;
+
+	MergeN(Thread& th, P<Array> const& streams, bool finite, Arg fun, int inMode)
+		: Gen(th, std::is_same<T, V>::value ? itemTypeV : itemTypeZ, finite), fun_(fun), mode(inMode)
+	{
+		int n = (int)streams->size();
+		in_.reserve(n);
+		for (int i = 0; i < n; ++i) in_.emplace_back(streams->at(i));
+		heads.resize(n);
+		if (mode == mergeByKey) keys.resize(n);
+	}
+
+	virtual const char* TypeName() const override { return "MergeN"; }
+
+	bool before(Thread& th, int i, int j)
+	{
+		if (mode == mergeByFun) {
+			th.push(heads[i]);
+			th.push(heads[j]);
+			fun_.apply(th);
+			return th.pop().isTrue();
+		}
+		int c = compare(th, i, j);
+		return c < 0 || (c == 0 && i < j);
+	}
+
+	int compare(Thread& th, int i, int j)
+	{
+		if (mode == mergeByKey) return ::Compare(th, keys[i], keys[j]);
+		th.push(heads[i]);
+		th.push(heads[j]);
+		fun_.apply(th);
+		Z c = th.popFloat("mergecn : compareValue");
+		return c < 0. ? -1 : c > 0. ? 1 : 0;
+	}
+
+	// reads the next item of input k. false when the input has ended.
+	bool load(Thread& th, int k)
+	{
+		if (mergeOne(th, in_[k], heads[k])) return false;
+		if (mode == mergeByKey) {
+			if constexpr (std::is_same<T, V>::value) {
+				if (!heads[k].dot(th, fun_, keys[k])) {
+					failed = true;
+					return false;
+				}
+			}
+		}
+		return true;
+	}
+
+	virtual void pull(Thread& th) override {
+		auto less = [&](int i, int j) { return before(th, i, j); };
+		int framesToFill = mBlockSize;
+		T* out = mergeFulfill(mOut, framesToFill, (T*)nullptr);
+		for (int i = 0; i < framesToFill; ++i) {
+			SaveStack ss(th);
+			if (once) {
+				once = false;
+				for (int k = 0; k < (int)in_.size(); ++k) {
+					if (load(th, k)) heap.push(k, less);
+				}
+			}
+			if (heap.empty() || failed) {
+				produce(framesToFill - i);
+				setDone();
+				return;
+			}
+			int k = heap.top();
+			out[i] = heads[k];
+			if (heap.size() == 1) {
+				produce(framesToFill - i - 1);
+				in_[k].link(th, mOut);
+				setDone();
+				return;
+			}
+			if (mode == mergeByCmp) {
+				// drop the items of other inputs that compare equal to this one.
+				heap.pop(less);
+				equal.clear();
+				while (!heap.empty() && compare(th, heap.top(), k) == 0) {
+					equal.push_back(heap.top());
+					heap.pop(less);
+				}
+				equal.push_back(k);
+				for (int e : equal) {
+					if (load(th, e)) heap.push(e, less);
+				}
+			} else if (load(th, k)) {
+				heap.fixTop(less);
+			} else {
+				heap.pop(less);
+			}
+		}
+		produce(0);
+	}
+};
+
+static void mergen_(Thread& th, Prim* prim)
+{
+	V fun = th.pop();
+	P<List> streams = th.popVList("mergen : streams");
+	bool finite;
+	P<Array> a = mergeInputs(th, streams, "mergen : streams", finite);
+
+	bool allZ = true, allV = true;
+	for (int64_t i = 0; i < a->size(); ++i) {
+		if (a->at(i).isZList()) allV = false;
+		else allZ = false;
+	}
+	if (allZ && a->size()) {
+		th.push(new List(new MergeN<Z, ZIn>(th, a, finite, fun, mergeByFun)));
+	} else if (allV) {
+		th.push(new List(new MergeN<V, VIn>(th, a, finite, fun, fun.isString() ? mergeByKey : mergeByFun)));
+	} else {
+		post("mergen : lists not same type\n");
+		throw errFailed;
+	}
+}
+
+static void mergecn_(Thread& th, Prim* prim)
+{
+	V fun = th.pop();
+	P<List> streams = th.popVList("mergecn : streams");
+	bool finite;
+	P<Array> a = mergeInputs(th, streams, "mergecn : streams", finite);
+
+	bool allZ = true, allV = true;
+	for (int64_t i = 0; i < a->size(); ++i) {
+		if (a->at(i).isZList()) allV = false;
+		else allZ = false;
+	}
+	if (allZ && a->size()) {
+		th.push(new List(new MergeN<Z, ZIn>(th, a, finite, fun, mergeByCmp)));
+	} else if (allV) {
+		th.push(new List(new MergeN<V, VIn>(th, a, finite, fun, mergeByCmp)));
+	} else {
+		post("mergecn : lists not same type\n");
+		throw errFailed;
+	}
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 //evmerge
@@ -6968,6 +7237,8 @@ struct MergeEvents : Gen
 						if (nextATime < nextBTime) {
 							out[i] = makeRestEvent(nextBTime - nextATime);
 							produce(framesToFill - i - 1);
+						} else {
+							produce(framesToFill - i);
 						}
 						b_.link(th, mOut);
 						setDone();
@@ -6991,6 +7262,8 @@ struct MergeEvents : Gen
 						if (nextBTime < nextATime) {
 							out[i] = makeRestEvent(nextATime - nextBTime);
 							produce(framesToFill - i - 1);
+						} else {
+							produce(framesToFill - i);
 						}
 						a_.link(th, mOut);
 						setDone();
@@ -7022,6 +7295,114 @@ static void evmerge_(Thread& th, Prim* prim)
 	th.push(new List(new MergeEvents(th, a, b, t)));
 }
 
+// merges any number of event streams. the streams are kept in a heap ordered by the start time of their next event,
+// so each event is pulled and extended once, instead of once for each level of nested evmerges.
+struct MergeEventsN : Gen
+{
+	std::vector<VIn> in_;
+	std::vector<Z> nextTime;
+	MergeHeap heap;
+	bool once = true;
+
+	MergeEventsN(Thread& th, P<Array> const& streams, bool finite, std::vector<Z> const& starts)
+		: Gen(th, itemTypeV, finite), nextTime(starts)
+	{
+		int n = (int)streams->size();
+		in_.reserve(n);
+		for (int i = 0; i < n; ++i) in_.emplace_back(streams->at(i));
+	}
+
+	virtual const char* TypeName() const override { return "MergeEventsN"; }
+
+	bool before(int i, int j) const
+	{
+		return nextTime[i] < nextTime[j] || (nextTime[i] == nextTime[j] && i < j);
+	}
+
+	virtual void pull(Thread& th) override {
+		auto less = [this](int i, int j) { return before(i, j); };
+		int framesToFill = mBlockSize;
+		V* out = mOut->fulfill(framesToFill);
+		for (int i = 0; i < framesToFill; ) {
+			SaveStack ss(th);
+			if (once) {
+				once = false;
+				for (int k = 0; k < (int)in_.size(); ++k) heap.push(k, less);
+				if (!heap.empty() && nextTime[heap.top()] > 0.) {
+					out[i++] = makeRestEvent(nextTime[heap.top()]);
+					continue;
+				}
+			}
+			if (heap.empty()) {
+				produce(framesToFill - i);
+				setDone();
+				return;
+			}
+
+			int k = heap.top();
+			Z t = nextTime[k];
+			V e;
+			if (in_[k].one(th, e)) {
+				heap.pop(less);
+				if (heap.empty()) {
+					produce(framesToFill - i);
+					setDone();
+					return;
+				}
+				Z next = nextTime[heap.top()];
+				if (t < next) out[i++] = makeRestEvent(next - t);
+				if (heap.size() == 1) {
+					produce(framesToFill - i);
+					in_[heap.top()].link(th, mOut);
+					setDone();
+					return;
+				}
+				continue;
+			}
+
+			V dtv;
+			if (!e.dot(th, s_dt, dtv)) {
+				produce(framesToFill - i);
+				setDone();
+				return;
+			}
+			Z dt = dtv.asFloat();
+			nextTime[k] = t + dt;
+			heap.fixTop(less);
+			int n = heap.top();
+			if (n != k) dt = std::min(dt, nextTime[n] - t);
+			out[i++] = extendFormByOne(th, asParent(th, e), dtTableMap, dt);
+		}
+		produce(0);
+	}
+};
+
+static void evmergen_(Thread& th, Prim* prim)
+{
+	V t = th.pop();
+	P<List> streams = th.popVList("evmergen : streams");
+	bool finite;
+	P<Array> a = mergeInputs(th, streams, "evmergen : streams", finite);
+	
+	int64_t n = a->size();
+	std::vector<Z> starts(n, 0.);
+	if (t.isReal()) {
+		for (int64_t i = 0; i < n; ++i) starts[i] = t.f;
+	} else if (t.isList()) {
+		if (!t.isFinite()) indefiniteOp("evmergen : t", "");
+		P<List> ts = ((List*)t.o())->pack(th);
+		P<Array> ta = ts->mArray;
+		if (ta->size() != n) {
+			post("evmergen : need one start time for each stream\n");
+			throw errOutOfRange;
+		}
+		for (int64_t i = 0; i < n; ++i) starts[i] = ta->at(i).asFloat();
+	} else {
+		wrongType("evmergen : t", "Real or List", t);
+	}
+	th.push(new List(new MergeEventsN(th, a, finite, starts)));
+}
+
 static void evrest_(Thread& th, Prim* prim)
 {
 	Z t = th.popFloat("evrest : t");
@@ -7037,6 +7418,57 @@ static void evdelay_(Thread& th, Prim* prim)
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
+// a function is pure if it only calls primitives marked pure and does not bind workspace variables.
+// this is conservative: calls through variables and message sends are not followed,
+// except that naming an argument is allowed when the caller knows no argument is a function.
+static bool isPureCode(Code* code, int numPlainArgs, int depth);
+
+static bool isPureFunction(Arg f, bool plainArgs = false, int depth = 0)
+{
+	if (depth > 8) return false;
+	if (f.isPrim()) return ((Prim*)f.o())->mPure;
+	if (f.isFun()) {
+		Fun* fun = (Fun*)f.o();
+		return isPureCode(fun->mDef->mCode(), plainArgs ? fun->NumArgs() : 0, depth + 1);
+	}
+	return false;
+}
+
+static bool isPureCode(Code* code, int numPlainArgs, int depth)
+{
+	for (Opcode const& opc : code->ops) {
+		switch (opc.op) {
+			case opNone :
+			case opPushImmediate :
+			case opPushLocalVar :
+			case opPushFunVar :
+			case opPushWorkspaceVar :
+			case opPushFun :
+				break;
+			case opBindLocal :
+			case opBindLocalFromList :
+				if (opc.v.i < numPlainArgs) return false; // an argument rebound to something else.
+				break;
+			case opCallLocalVar :
+				if (opc.v.i >= numPlainArgs) return false;
+				break;
+			case opCallImmediate :
+				if (opc.v.isFunOrPrim() && !isPureFunction(opc.v, false, depth)) return false;
+				break;
+			case opParens :
+			case opNewVList :
+			case opNewZList :
+				if (!isPureCode((Code*)opc.v.o(), numPlainArgs, depth)) return false;
+				break;
+			case opReturn :
+				return true;
+			default :
+				return false;
+		}
+	}
+	return true;
+}
+
 class CompareFun
 {
 public:
@@ -7045,7 +7477,7 @@ public:
 	virtual bool operator()(Thread& th, Arg a, Arg b) = 0;
 };
 
-class VLess : public CompareFun
+class VLess final : public CompareFun
 {
 public:
 	VLess() {}
@@ -7053,7 +7485,7 @@ public:
 	virtual bool operator()(Thread& th, Arg a, Arg b) { return Compare(th, a, b) < 0; }
 };
 
-class VGreater : public CompareFun
+class VGreater final : public CompareFun
 {
 public:
 	VGreater() {}
@@ -7061,12 +7493,18 @@ public:
 	virtual bool operator()(Thread& th, Arg a, Arg b) { return Compare(th, a, b) > 0; }
 };
 
-class VCompareF : public CompareFun
+class VCompareF final : public CompareFun
 {
 	V fun;
 public:
 	VCompareF(V inFun) : fun(inFun) {}
 	~VCompareF() {}
+	bool pure(int64_t n, const V* items) const
+	{
+		for (int64_t i = 0; i < n; ++i)
+			if (items[i].isFunOrPrim()) return isPureFunction(fun);
+		return isPureFunction(fun, true);
+	}
 	virtual bool operator()(Thread& th, Arg a, Arg b) {
 		SaveStack ss(th);
 		th.push(a);
@@ -7086,7 +7524,7 @@ public:
 	virtual bool operator()(Thread& th, Z a, Z b) = 0;
 };
 
-class ZLess : public ZCompareFun
+class ZLess final : public ZCompareFun
 {
 public:
 	ZLess() {}
@@ -7094,12 +7532,13 @@ public:
 	virtual bool operator()(Thread& th, Z a, Z b) { return a < b; }
 };
 
-class ZCompareF : public ZCompareFun
+class ZCompareF final : public ZCompareFun
 {
 	V fun;
 public:
 	ZCompareF(V inFun) : fun(inFun) {}
 	~ZCompareF() {}
+	bool pure() const { return isPureFunction(fun, true); }
 	virtual bool operator()(Thread& th, Z a, Z b) {
 		SaveStack ss(th);
 		th.push(a);
@@ -7109,7 +7548,7 @@ public:
 	}
 };
 
-class ZGreater : public ZCompareFun
+class ZGreater final : public ZCompareFun
 {
 public:
 	ZGreater() {}
@@ -7118,45 +7557,21 @@ public:
 };
 
 
-static void merge(Thread& th, int64_t an, V* a, int64_t bn, V* b, V* c, CompareFun* compare)
+template <class T, class Compare>
+static void merge(Thread& th, int64_t an, T* a, int64_t bn, T* b, T* c, Compare& compare)
 {
 	// merge a and b using scratch space c.
+	// on ties the item from a is taken first, so the sort is stable.
 	// copy result back to a.
 	// a and b are assumed to be contiguous.
 	int64_t ai = 0;
 	int64_t bi = 0;
 	int64_t ci = 0;
 	while (ai < an && bi < bn) {
-		if ((*compare)(th, a[ai], b[bi])) {
-			c[ci++] = a[ai++];
-		} else {
+		if (compare(th, b[bi], a[ai])) {
 			c[ci++] = b[bi++];
-		}
-	}
-	while (ai < an) {
-		c[ci++] = a[ai++];
-	}
-	while (bi < bn) {
-		c[ci++] = b[bi++];
-	}
-	for (int64_t i = 0; i < ci; ++i) {
-		a[i] = c[i];
-	}
-}
-
-static void merge(Thread& th, int64_t an, Z* a, int64_t bn, Z* b, Z* c, ZCompareFun* compare)
-{
-	// merge a and b using scratch space c.
-	// copy result back to a.
-	// a and b are assumed to be contiguous.
-	int64_t ai = 0;
-	int64_t bi = 0;
-	int64_t ci = 0;
-	while (ai < an && bi < bn) {
-		if ((*compare)(th, a[ai], b[bi])) {
-			c[ci++] = a[ai++];
 		} else {
-			c[ci++] = b[bi++];
+			c[ci++] = a[ai++];
 		}
 	}
 	while (ai < an) {
@@ -7170,47 +7585,20 @@ static void merge(Thread& th, int64_t an, Z* a, int64_t bn, Z* b, Z* c, ZCompare
 	}
 }
 
-static void mergesort(Thread& th, int64_t n, V* a, V* tmp, CompareFun* compare)
-{
-	if (n == 1) return;
-	int64_t an = n / 2;
-	int64_t bn = n - an;
-	V* b = a + an;
-	mergesort(th, an, a, tmp, compare);
-	mergesort(th, bn, b, tmp, compare);
-	merge(th, an, a, bn, b, tmp, compare);
-}
-
-static void mergesort(Thread& th, int64_t n, Z* a, Z* tmp, ZCompareFun* compare)
+template <class T, class Compare>
+static void mergesort(Thread& th, int64_t n, T* a, T* tmp, Compare& compare)
 {
-	if (n == 1) return;
+	if (n <= 1) return;
 	int64_t an = n / 2;
 	int64_t bn = n - an;
-	Z* b = a + an;
+	T* b = a + an;
 	mergesort(th, an, a, tmp, compare);
 	mergesort(th, bn, b, tmp, compare);
 	merge(th, an, a, bn, b, tmp, compare);
 }
 
-static void sort(Thread& th, int64_t n, const V* in, V* out, CompareFun* compare)
-{
-	V* tmp = new V[n];
-	ArrayDeleter<V> d(tmp);
-	
-	for (int64_t i = 0; i < n; ++i) out[i] = in[i];
-	mergesort(th, n, out, tmp, compare);
-}
-
-static void sort(Thread& th, int64_t n, const Z* in, Z* out, ZCompareFun* compare)
-{
-	Z* tmp = new Z[n];
-	ArrayDeleter<Z> d(tmp);
-	
-	for (int64_t i = 0; i < n; ++i) out[i] = in[i];
-	mergesort(th, n, out, tmp, compare);
-}
-
-static void merge(Thread& th, int64_t an, V* a, Z* az, int64_t bn, V* b, Z* bz, V* c, Z* cz, CompareFun* compare)
+template <class T, class Compare>
+static void merge(Thread& th, int64_t an, T* a, Z* az, int64_t bn, T* b, Z* bz, T* c, Z* cz, Compare& compare)
 {
 	// merge a and b using scratch space c.
 	// copy result back to a.
@@ -7219,43 +7607,12 @@ static void merge(Thread& th, int64_t an, V* a, Z* az, int64_t bn, V* b, Z* bz,
 	int64_t bi = 0;
 	int64_t ci = 0;
 	while (ai < an && bi < bn) {
-		if ((*compare)(th, a[ai], b[bi])) {
-			c[ci] = a[ai];
-			cz[ci++] = az[ai++];
-		} else {
+		if (compare(th, b[bi], a[ai])) {
 			c[ci] = b[bi];
 			cz[ci++] = bz[bi++];
-		}
-	}
-	while (ai < an) {
-		c[ci] = a[ai];
-		cz[ci++] = az[ai++];
-	}
-	while (bi < bn) {
-		c[ci] = b[bi];
-		cz[ci++] = bz[bi++];
-	}
-	for (int64_t i = 0; i < ci; ++i) {
-		a[i] = c[i];
-		az[i] = cz[i];
-	}
-}
-
-static void merge(Thread& th, int64_t an, Z* a, Z* az, int64_t bn, Z* b, Z* bz, Z* c, Z* cz, ZCompareFun* compare)
-{
-	// merge a and b using scratch space c.
-	// copy result back to a.
-	// a and b are assumed to be contiguous.
-	int64_t ai = 0;
-	int64_t bi = 0;
-	int64_t ci = 0;
-	while (ai < an && bi < bn) {
-		if ((*compare)(th, a[ai], b[bi])) {
+		} else {
 			c[ci] = a[ai];
 			cz[ci++] = az[ai++];
-		} else {
-			c[ci] = b[bi];
-			cz[ci++] = bz[bi++];
 		}
 	}
 	while (ai < an) {
@@ -7272,48 +7629,213 @@ static void merge(Thread& th, int64_t an, Z* a, Z* az, int64_t bn, Z* b, Z* bz,
 	}
 }
 
-static void mergesort(Thread& th, int64_t n, V* a, Z* az, V* c, Z* cz, CompareFun* compare)
+template <class T, class Compare>
+static void mergesort(Thread& th, int64_t n, T* a, Z* az, T* c, Z* cz, Compare& compare)
 {
-	if (n == 1) return;
+	if (n <= 1) return;
 	int64_t an = n / 2;
 	int64_t bn = n - an;
-	V* b = a + an;
+	T* b = a + an;
 	Z* bz = az + an;
 	mergesort(th, an, a, az, c, cz, compare);
 	mergesort(th, bn, b, bz, c, cz, compare);
 	merge(th, an, a, az, bn, b, bz, c, cz, compare);
 }
 
-static void mergesort(Thread& th, int64_t n, Z* a, Z* az, Z* c, Z* cz, ZCompareFun* compare)
+template <class F>
+static void runSortJobs(Thread& th, int numJobs, F const& job)
 {
-	if (n == 1) return;
-	int64_t an = n / 2;
-	int64_t bn = n - an;
-	Z* b = a + an;
-	Z* bz = az + an;
-	mergesort(th, an, a, az, c, cz, compare);
-	mergesort(th, bn, b, bz, c, cz, compare);
-	merge(th, an, a, az, bn, b, bz, c, cz, compare);
+	// job 0 runs on the calling thread. the others each get their own Thread to run compare functions on.
+	std::vector<std::thread> threads;
+	std::vector<std::exception_ptr> errors(numJobs);
+	for (int k = 1; k < numJobs; ++k) {
+		threads.emplace_back([&th, &job, &errors, k]() {
+			try {
+				Thread jobThread(th);
+				job(jobThread, k);
+			} catch (...) {
+				errors[k] = std::current_exception();
+			}
+		});
+	}
+	try {
+		job(th, 0);
+	} catch (...) {
+		errors[0] = std::current_exception();
+	}
+	for (std::thread& thread : threads) {
+		thread.join();
+	}
+	for (std::exception_ptr const& error : errors) {
+		if (error) std::rethrow_exception(error);
+	}
 }
 
+const int64_t kMinParallelSortChunk = 2048;
 
-static void grade(Thread& th, int64_t n, const V* in, Z* zout, CompareFun* compare)
+template <class T, class Compare>
+static void parallelMergesort(Thread& th, int64_t n, T* a, Z* az, T* tmp, Z* ztmp, Compare& compare)
 {
-	V* out = new V[n];
-	V* tmp = new V[n];
+	// sort one chunk per core, then merge neighboring runs in rounds.
+	// merges are stable, so the result is the same as the sequential sort.
+	// at least two chunks even on one core, so that a large sort takes the same path on every machine.
+	int64_t numCores = std::max(2u, std::thread::hardware_concurrency());
+	int numChunks = (int)std::min<int64_t>(numCores, n / kMinParallelSortChunk);
+	if (numChunks < 2) {
+		if (az) mergesort(th, n, a, az, tmp, ztmp, compare);
+		else mergesort(th, n, a, tmp, compare);
+		return;
+	}
+	
+	std::vector<int64_t> bounds(numChunks + 1);
+	for (int k = 0; k <= numChunks; ++k) bounds[k] = n * k / numChunks;
+	
+	runSortJobs(th, numChunks, [&](Thread& jobThread, int k) {
+		int64_t lo = bounds[k];
+		int64_t len = bounds[k+1] - lo;
+		if (az) mergesort(jobThread, len, a + lo, az + lo, tmp + lo, ztmp + lo, compare);
+		else mergesort(jobThread, len, a + lo, tmp + lo, compare);
+	});
+	
+	for (int width = 1; width < numChunks; width *= 2) {
+		int numMerges = (numChunks + 2 * width - 1) / (2 * width);
+		runSortJobs(th, numMerges, [&](Thread& jobThread, int k) {
+			int lo = 2 * width * k;
+			int mid = std::min(lo + width, numChunks);
+			int hi = std::min(lo + 2 * width, numChunks);
+			if (mid == hi) return;
+			int64_t an = bounds[mid] - bounds[lo];
+			int64_t bn = bounds[hi] - bounds[mid];
+			T* aa = a + bounds[lo];
+			if (az) merge(jobThread, an, aa, az + bounds[lo], bn, aa + an, az + bounds[mid], tmp + bounds[lo], ztmp + bounds[lo], compare);
+			else merge(jobThread, an, aa, bn, aa + an, tmp + bounds[lo], compare);
+		});
+	}
+}
+
+template <class T, class Compare>
+static void sort(Thread& th, int64_t n, const T* in, T* out, Compare& compare, bool parallel = false)
+{
+	T* tmp = new T[n];
+	ArrayDeleter<T> d(tmp);
+	
+	for (int64_t i = 0; i < n; ++i) out[i] = in[i];
+	if (parallel) parallelMergesort(th, n, out, (Z*)nullptr, tmp, (Z*)nullptr, compare);
+	else mergesort(th, n, out, tmp, compare);
+}
+
+template <class T, class Compare>
+static void grade(Thread& th, int64_t n, const T* in, Z* zout, Compare& compare, bool parallel = false)
+{
+	T* out = new T[n];
+	T* tmp = new T[n];
 	Z* ztmp = new Z[n];
-	ArrayDeleter<V> d1(out);
-	ArrayDeleter<V> d2(tmp);
+	ArrayDeleter<T> d1(out);
+	ArrayDeleter<T> d2(tmp);
 	ArrayDeleter<Z> d3(ztmp);
 	
 	for (int64_t i = 0; i < n; ++i) out[i] = in[i];
 	double z = 0.;
 	for (int64_t i = 0; i < n; ++i, z+=1.) zout[i] = z;
-	mergesort(th, n, out, zout, tmp, ztmp, compare);
+	if (parallel) parallelMergesort(th, n, out, zout, tmp, ztmp, compare);
+	else mergesort(th, n, out, zout, tmp, ztmp, compare);
 }
 
-static void grade(Thread& th, int64_t n, const Z* in, Z* zout, ZCompareFun* compare)
+// signals sort without calling a compare function, using a radix sort on the IEEE bit patterns.
+
+typedef std::conditional<sizeof(Z) == 8, uint64_t, uint32_t>::type ZBits;
+
+const int kRadixBits = 11;
+const int kRadixSize = 1 << kRadixBits;
+const int kRadixPasses = (8 * sizeof(Z) + kRadixBits - 1) / kRadixBits;
+const int64_t kMinRadixSort = 256;
+
+static inline ZBits radixKey(Z z, ZBits flip)
 {
+	// maps the float ordering onto unsigned integer ordering.
+	// -0 gets the same key as 0 so equal values keep their order, as they do in the merge sort.
+	if (z == 0.) z = 0.;
+	ZBits u;
+	memcpy(&u, &z, sizeof(Z));
+	const ZBits signBit = ZBits(1) << (8 * sizeof(Z) - 1);
+	u = (u & signBit) ? ~u : (u | signBit);
+	return u ^ flip;
+}
+
+static void radixsort(int64_t n, Z* a, Z* tmp, Z* az, Z* ztmp, bool descending)
+{
+	// least significant digit first. az, if not null, is permuted along with a.
+	const ZBits flip = descending ? ~ZBits(0) : ZBits(0);
+	std::vector<int64_t> counts(kRadixPasses * kRadixSize, 0);
+	for (int64_t i = 0; i < n; ++i) {
+		ZBits key = radixKey(a[i], flip);
+		for (int p = 0; p < kRadixPasses; ++p) {
+			++counts[p * kRadixSize + ((key >> (p * kRadixBits)) & (kRadixSize - 1))];
+		}
+	}
+
+	Z* src = a;
+	Z* dst = tmp;
+	Z* zsrc = az;
+	Z* zdst = ztmp;
+	for (int p = 0; p < kRadixPasses; ++p) {
+		int shift = p * kRadixBits;
+		int64_t* offsets = &counts[p * kRadixSize];
+		if (offsets[(radixKey(src[0], flip) >> shift) & (kRadixSize - 1)] == n)
+			continue; // every item has the same digit.
+		
+		int64_t sum = 0;
+		for (int d = 0; d < kRadixSize; ++d) {
+			int64_t count = offsets[d];
+			offsets[d] = sum;
+			sum += count;
+		}
+		for (int64_t i = 0; i < n; ++i) {
+			int64_t j = offsets[(radixKey(src[i], flip) >> shift) & (kRadixSize - 1)]++;
+			dst[j] = src[i];
+			if (zsrc) zdst[j] = zsrc[i];
+		}
+		std::swap(src, dst);
+		std::swap(zsrc, zdst);
+	}
+	
+	if (src != a) {
+		memcpy(a, src, n * sizeof(Z));
+		if (az) memcpy(az, zsrc, n * sizeof(Z));
+	}
+}
+
+static void sortz(Thread& th, int64_t n, const Z* in, Z* out, bool descending)
+{
+	if (n < kMinRadixSort) {
+		if (descending) {
+			ZGreater cmp;
+			sort(th, n, in, out, cmp);
+		} else {
+			ZLess cmp;
+			sort(th, n, in, out, cmp);
+		}
+		return;
+	}
+	Z* tmp = new Z[n];
+	ArrayDeleter<Z> d(tmp);
+	
+	memcpy(out, in, n * sizeof(Z));
+	radixsort(n, out, tmp, nullptr, nullptr, descending);
+}
+
+static void gradez(Thread& th, int64_t n, const Z* in, Z* zout, bool descending)
+{
+	if (n < kMinRadixSort) {
+		if (descending) {
+			ZGreater cmp;
+			grade(th, n, in, zout, cmp);
+		} else {
+			ZLess cmp;
+			grade(th, n, in, zout, cmp);
+		}
+		return;
+	}
 	Z* out = new Z[n];
 	Z* tmp = new Z[n];
 	Z* ztmp = new Z[n];
@@ -7321,10 +7843,10 @@ static void grade(Thread& th, int64_t n, const Z* in, Z* zout, ZCompareFun* comp
 	ArrayDeleter<Z> d2(tmp);
 	ArrayDeleter<Z> d3(ztmp);
 	
-	for (int64_t i = 0; i < n; ++i) out[i] = in[i];
+	memcpy(out, in, n * sizeof(Z));
 	double z = 0.;
 	for (int64_t i = 0; i < n; ++i, z+=1.) zout[i] = z;
-	mergesort(th, n, out, zout, tmp, ztmp, compare);
+	radixsort(n, out, tmp, zout, ztmp, descending);
 }
 
 static void sort_(Thread& th, Prim* prim)
@@ -7347,16 +7869,15 @@ static void sort_(Thread& th, Prim* prim)
 		out->mArray->setSize(n);
 		V* vout = out->mArray->v();
 		
-		sort(th, n, v, vout, &cmp);
+		sort(th, n, v, vout, cmp);
 		th.push(out);
 	} else {
 		Z* z = array->z();
-		ZLess cmp;
 		P<List> out = new List(itemTypeZ, n);
 		out->mArray->setSize(n);
 		Z* zout = out->mArray->z();
 
-		sort(th, n, z, zout, &cmp);
+		sortz(th, n, z, zout, false);
 		th.push(out);
 	}
 }
@@ -7364,7 +7885,7 @@ static void sort_(Thread& th, Prim* prim)
 
 static void sortf_(Thread& th, Prim* prim)
 {
-	V fun = th.popList("sort : fun");
+	V fun = th.pop();
 	V a = th.popList("sort : a");
 	
 	if (!a.isFinite()) 
@@ -7383,7 +7904,7 @@ static void sortf_(Thread& th, Prim* prim)
 		out->mArray->setSize(n);
 		V* vout = out->mArray->v();
 		
-		sort(th, n, v, vout, &cmp);
+		sort(th, n, v, vout, cmp, cmp.pure(n, v));
 		th.push(out);
 	} else {
 		Z* z = array->z();
@@ -7392,7 +7913,7 @@ static void sortf_(Thread& th, Prim* prim)
 		out->mArray->setSize(n);
 		Z* zout = out->mArray->z();
 
-		sort(th, n, z, zout, &cmp);
+		sort(th, n, z, zout, cmp, cmp.pure());
 		th.push(out);
 	}
 }
@@ -7417,16 +7938,15 @@ static void sort_gt_(Thread& th, Prim* prim)
 		out->mArray->setSize(n);
 		V* vout = out->mArray->v();
 		
-		sort(th, n, v, vout, &cmp);
+		sort(th, n, v, vout, cmp);
 		th.push(out);
 	} else {
 		Z* z = array->z();
-		ZGreater cmp;
 		P<List> out = new List(itemTypeZ, n);
 		out->mArray->setSize(n);
 		Z* zout = out->mArray->z();
 
-		sort(th, n, z, zout, &cmp);
+		sortz(th, n, z, zout, true);
 		th.push(out);
 	}
 }
@@ -7451,16 +7971,15 @@ static void grade_(Thread& th, Prim* prim)
 		out->mArray->setSize(n);
 		Z* zout = out->mArray->z();
 		
-		grade(th, n, v, zout, &cmp);
+		grade(th, n, v, zout, cmp);
 		th.push(out);
 	} else {
 		Z* z = array->z();
-		ZLess cmp;
 		P<List> out = new List(itemTypeZ, n);
 		out->mArray->setSize(n);
 		Z* zout = out->mArray->z();
 
-		grade(th, n, z, zout, &cmp);
+		gradez(th, n, z, zout, false);
 		th.push(out);
 	}
 }
@@ -7468,7 +7987,7 @@ static void grade_(Thread& th, Prim* prim)
 
 static void gradef_(Thread& th, Prim* prim)
 {
-	V fun = th.popList("grade : fun");
+	V fun = th.pop();
 	V a = th.popList("grade : a");
 	
 	if (!a.isFinite()) 
@@ -7487,7 +8006,7 @@ static void gradef_(Thread& th, Prim* prim)
 		out->mArray->setSize(n);
 		Z* zout = out->mArray->z();
 		
-		grade(th, n, v, zout, &cmp);
+		grade(th, n, v, zout, cmp, cmp.pure(n, v));
 		th.push(out);
 	} else {
 		Z* z = array->z();
@@ -7496,7 +8015,7 @@ static void gradef_(Thread& th, Prim* prim)
 		out->mArray->setSize(n);
 		Z* zout = out->mArray->z();
 
-		grade(th, n, z, zout, &cmp);
+		grade(th, n, z, zout, cmp, cmp.pure());
 		th.push(out);
 	}
 }
@@ -7521,22 +8040,150 @@ static void grade_gt_(Thread& th, Prim* prim)
 		out->mArray->setSize(n);
 		Z* zout = out->mArray->z();
 		
-		grade(th, n, v, zout, &cmp);
+		grade(th, n, v, zout, cmp);
 		th.push(out);
 	} else {
 		Z* z = array->z();
-		ZGreater cmp;
 		P<List> out = new List(itemTypeZ, n);
 		out->mArray->setSize(n);
 		Z* zout = out->mArray->z();
 
-		grade(th, n, z, zout, &cmp);
+		gradez(th, n, z, zout, true);
 		th.push(out);
 	}
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
+#pragma mark LIVE SEQUENCES
+
+// a live sequence hands each reader its own cursor over a shared source, and keeps only the blocks between the
+// slowest live cursor and the newest block read. a new cursor starts at the oldest block still kept. once no
+// cursor is alive nothing is kept, so each use of the name consumes the blocks it reads and the next use goes on
+// from there. bound in the workspace it lets a long signal be read by several consumers without the binding
+// holding its head.
+class LiveSeq : public Object
+{
+	P<List> mSource; // the first list not yet split into blocks.
+	int mItemType;
+	bool mSourceFinite;
+	std::deque<P<Array>> mBlocks;
+	int64_t mFirst; // position of mBlocks.front().
+	std::vector<int64_t const*> mCursors;
+	LOCK_DECLARE(mSpinLock);
+
+	// drops the blocks every live cursor has passed.
+	void trim()
+	{
+		int64_t oldest = mFirst + (int64_t)mBlocks.size();
+		for (int64_t const* pos : mCursors) oldest = std::min(oldest, *pos);
+		while (mFirst < oldest) {
+			mBlocks.pop_front();
+			++mFirst;
+		}
+	}
+
+public:
+	LiveSeq(P<List> const& inSource)
+		: mSource(inSource), mItemType(inSource->ItemType()), mSourceFinite(inSource->isFinite()), mFirst(0)
+	{
+	}
+	
+	virtual const char* TypeName() const override { return "LiveSeq"; }
+	
+	// using the name a live sequence is bound to reads it.
+	virtual void apply(Thread& th) override;
+	
+	int itemType() const { return mItemType; }
+	bool sourceFinite() const { return mSourceFinite; }
+	
+	void addCursor(int64_t* pos)
+	{
+		SpinLocker lock(mSpinLock);
+		*pos = mFirst;
+		mCursors.push_back(pos);
+	}
+	
+	void removeCursor(int64_t const* pos)
+	{
+		SpinLocker lock(mSpinLock);
+		auto it = std::find(mCursors.begin(), mCursors.end(), pos);
+		if (it == mCursors.end()) return;
+		mCursors.erase(it);
+		trim();
+	}
+	
+	// returns the block at ioPos and advances ioPos past it, or returns null at the end of the source.
+	P<Array> next(Thread& th, int64_t& ioPos)
+	{
+		while (true) {
+			P<List> source;
+			{
+				SpinLocker lock(mSpinLock);
+				if (ioPos < mFirst + (int64_t)mBlocks.size()) {
+					P<Array> block = mBlocks[ioPos - mFirst];
+					++ioPos;
+					trim();
+					return block;
+				}
+				if (!mSource()) return nullptr;
+				source = mSource;
+			}
+			// the source runs outside the lock. it may take any time, and may itself read this sequence.
+			source->force(th);
+			SpinLocker lock(mSpinLock);
+			if (mSource() == source()) {
+				P<Array> block = source->mArray;
+				mSource = source->next();
+				if (block() && block->size()) mBlocks.push_back(block);
+			}
+		}
+	}
+};
+
+class LiveCursor : public Gen
+{
+	P<LiveSeq> mSeq;
+	int64_t mPos;
+public:
+	
+	LiveCursor(Thread& th, P<LiveSeq> const& inSeq)
+		: Gen(th, inSeq->itemType(), inSeq->sourceFinite()), mSeq(inSeq)
+	{
+		mSeq->addCursor(&mPos);
+	}
+	
+	~LiveCursor() { mSeq->removeCursor(&mPos); }
+	
+	virtual const char* TypeName() const override { return "LiveCursor"; }
+	
+	virtual void pull(Thread& th) override
+	{
+		P<Array> block = mSeq->next(th, mPos);
+		if (!block()) {
+			mSeq->removeCursor(&mPos);
+			end();
+			return;
+		}
+		if (elemType == itemTypeV) mOut->fulfill(block);
+		else mOut->fulfillz(block);
+		produce(0);
+	}
+};
+
+void LiveSeq::apply(Thread& th)
+{
+	th.push(new List(new LiveCursor(th, this)));
+}
+
+static void live_(Thread& th, Prim* prim)
+{
+	P<List> s = th.popList("live : seq");
+	th.push(new LiveSeq(s));
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
 #pragma mark ADD STREAM OPS
 
 #define DEF(NAME, TAKES, LEAVES, HELP) 	vm.def(#NAME, TAKES, LEAVES, NAME##_, HELP);
@@ -7582,6 +8229,8 @@ void AddStreamOps()
 	DEF(uncons, 1, 2, "(list --> tail head) returns the tail and head of a list. fails if list is empty.")
 	DEF(pack, 1, 1, "(list --> list) returns a packed version of the list.");
 	DEF(packed, 1, 1, "(list --> bool) returns whether the list is packed.");
+	DEF(forced, 1, 1, "(list --> bool) returns whether the first block of the list has been computed. does not compute it.");
+	DEFnoeach(live, 1, 1, "(seq --> live) bind the result to a name. each use of the name reads seq with a new cursor, starting at the oldest block a live cursor still needs. blocks every cursor has passed are freed, so a use of the name consumes what it reads: once it is done, the next use starts after it.");
 
 	vm.addBifHelp("\n*** list generation ***");
 
@@ -7592,7 +8241,7 @@ void AddStreamOps()
 	DEFnoeach(evens,  0, 1, "(--> series) return an infinite series of ascending non-negative even integers.")
 	DEFnoeach(odds,   0, 1, "(--> series) return an infinite series of ascending non-negative odd integers.")
 	DEFnoeach(ints,   0, 1, "(--> series) return the infinite series [0 1 -1 2 -2 3 -3...]")
-	DEFnoeach(primes, 0, 1, "(--> series) returns a finite series of prime numbers up to 1000039.")
+	DEFnoeach(primes, 0, 1, "(--> series) returns a series of prime numbers. the sieve is extended as the series is read.")
 	DEFAM(fib, kk, "(a b --> series) returns a fibonacci series starting with the two numbers given.") 
 
 	DEFnoeach(ordz,   0, 1, "(--> signal) return an infinite signal of integers ascending from 1.")
@@ -7602,7 +8251,7 @@ void AddStreamOps()
 	DEFnoeach(evenz,  0, 1, "(--> signal) return an infinite signal of ascending non-negative even integers.")
 	DEFnoeach(oddz,   0, 1, "(--> signal) return an infinite signal of ascending non-negative odd integers.")
 	DEFnoeach(intz,   0, 1, "(--> signal) return the infinite signal [0 1 -1 2 -2 3 -3...]")
-	DEFnoeach(primez, 0, 1, "(--> signal) returns a finite signal of prime numbers up to 1000039.")	
+	DEFnoeach(primez, 0, 1, "(--> signal) returns a signal of prime numbers. the sieve is extended as the signal is read.")	
 	DEFMCX(fibz, 2, "(a b --> signal) returns a fibonacci signal starting with the two numbers given.")
 
 	DEFAM(ninvs, k, "(n --> stream) return a finite stream of n reciprocals. equivalent to n 1 1 nby 1/")
@@ -7708,6 +8357,8 @@ void AddStreamOps()
 	DEF(lace, 1, 1, "(a --> b) returns the concatenation of the transpose of the list of lists a.")	
 	DEFAM(merge, aak, "(a b fun --> c) merges two lists according to the function given. The function should work like <.")
 	DEFAM(mergec, aak, "(a b fun --> c) merges two lists without duplicates according to the function given. The function should work like cmp.")
+	DEFAM(mergen, ak, "(lists fun --> c) merges a list of lists according to the function given. The function should work like <. If fun is a key, the lists are merged by the value at that key.")
+	DEFAM(mergecn, ak, "(lists fun --> c) merges a list of lists without duplicates according to the function given. The function should work like cmp.")
 	
 	DEF(perms, 1, 1, "(a --> b) returns a list of all permutations of the input list.")
 	DEFMCX(permz, 1, "(a --> b) returns a list of all permutations of the input signal. automaps over streams.")
@@ -7778,6 +8429,7 @@ void AddStreamOps()
 
 	vm.addBifHelp("\n*** event list operations ***");
 	DEFAM(evmerge, aak, "(a b t --> c) merges event list 'b' with delay 't' with event list 'a' according to their delta times")
+	DEFAM(evmergen, aa, "(lists t --> c) merges a list of event lists according to their delta times. 't' is a list of start times, one for each event list, or one start time for all of them.")
 	DEFAM(evdelay, ak, "(a t --> c) delay an event list by adding a preceeding rest of duration 't'")
 	DEFAM(evrest, aak, "(t --> c) returns a rest event for duration 't'.")
 	
@@ -7797,9 +8449,13 @@ void AddStreamOps()
 	DEF(play, 1, 0, "(channels -->) plays the audio to the hardware.")
 	DEF(record, 2, 0, "(channels filename -->) plays the audio to the hardware and records it to a file.")
 	DEFnoeach(stop, 0, 0, "(-->) stops any audio playing.")
+	DEFnoeach(audiostats, 0, 0, "(-->) prints the output callback timing and xrun counts since playing last started.")
 	vm.def("sf>", 1, 0, sfread_, "(filename -->) read channels from an audio file. not real time.");
+	vm.def("sfseg>", 3, 0, sfreadseg_, "(filename offset duration -->) read channels from an audio file starting at offset seconds for duration seconds. a negative duration reads to the end of the file.");
 	vm.def(">sf", 2, 0, sfwrite_, "(channels filename -->) writes the audio to a file.");
 	vm.def(">sfo", 2, 0, sfwriteopen_, "(channels filename -->) writes the audio to a file and opens it in the default application.");
+	vm.def(">zf", 2, 0, zfwrite_, "(signal filename -->) writes a finite signal to a file of raw samples in the native sample format.");
+	vm.def("zf>", 1, 1, zfread_, "(filename --> signal) maps a file of raw samples in the native sample format. the file is not read into memory.");
 	//vm.def("sf>", 2, sfread_);
 	DEF(bench, 1, 0, "(channels -->) prints the amount of CPU required to compute a segment of audio. audio must be of finite duration.")
 #ifdef SAPF_AUDIOTOOLBOX
@@ -39,7 +39,8 @@ struct MulAdd : public ThreeInputUGen<MulAdd>
 	
 	virtual const char* TypeName() const override { return "MulAdd"; }
 		
-	void calc(int n, Z* out, Z* a, Z* b, Z* c, int aStride, int bStride, int cStride) 
+	template <typename SA, typename SB, typename SC>
+	void calc(int n, Z* out, Z* a, Z* b, Z* c, SA aStride, SB bStride, SC cStride)
 	{
 		for (int i = 0; i < n; ++i) {
 			out[i] = *a * *b + *c;
@@ -713,7 +714,7 @@ struct Curves : public Gen
 								goto leave;
 							}
 						} while (dur_ <= 0.);
-						dur_ = std::max(dur_, 1e-4);
+						dur_ = std::max<Z>(dur_, 1e-4);
 						invdur_ = 1. / dur_;
 						Z a1 = (newval_ - oldval_) / (1. - exp(curve_));
 						a2_ = oldval_ + a1;
@@ -1031,7 +1032,7 @@ struct ADSR : public Gen
 			step_ = 1.;
 		} else {
 
-			dur_ = std::max(dur_, 1e-5);
+			dur_ = std::max<Z>(dur_, 1e-5);
 			Z invdur = 1. / dur_;
 			Z a1 = (newval_ - oldval_) / (1. - exp(curve_));
 			a2_ = oldval_ + a1;
@@ -1163,7 +1164,7 @@ struct GatedADSR : public Gen
 			step_ = 1.;
 		} else {
 
-			dur_ = std::max(dur_, 1e-5);
+			dur_ = std::max<Z>(dur_, 1e-5);
 			Z invdur = 1. / dur_;
 			Z a1 = (newval_ - oldval_) / (1. - exp(curve_));
 			a2_ = oldval_ + a1;
@@ -1637,17 +1638,18 @@ struct LFNoise0 : public Gen
 	Z val_;
 	Z phase_;
 	Z freqmul_;
+	CRGen r;
 
 	LFNoise0(Thread& th, Arg rate) : Gen(th, itemTypeZ, true), rate_(rate),
 		phase_(1.), freqmul_(th.rate.invSampleRate)
 	{
+		r.init(th.rgen.trand());
 	}
 
 	virtual const char* TypeName() const override { return "LFNoise0"; }
 
 	virtual void pull(Thread& th) override
 	{	
-		RGen& r = th.rgen;
 		Z* out = mOut->fulfillz(mBlockSize);
 		int framesToFill = mBlockSize;
 		Z x = phase_;
@@ -1687,11 +1689,12 @@ struct LFNoise1 : public Gen
 	Z slope_;
 	Z phase_;
 	Z freqmul_;
+	CRGen r;
 
 	LFNoise1(Thread& th, Arg rate) : Gen(th, itemTypeZ, true), rate_(rate),
 		phase_(1.), freqmul_(th.rate.invSampleRate)
 	{
-		RGen& r = th.rgen;
+		r.init(th.rgen.trand());
 		newval_ = oldval_ = r.drand2();
 	}
 
@@ -1699,7 +1702,6 @@ struct LFNoise1 : public Gen
 
 	virtual void pull(Thread& th) override
 	{	
-		RGen& r = th.rgen;
 		Z* out = mOut->fulfillz(mBlockSize);
 		int framesToFill = mBlockSize;
 		Z x = phase_;
@@ -1741,11 +1743,12 @@ struct LFNoise3 : public Gen
 	Z c0, c1, c2, c3;
 	Z phase_;
 	Z freqmul_;
+	CRGen r;
 
 	LFNoise3(Thread& th, Arg rate) : Gen(th, itemTypeZ, true), rate_(rate),
 		phase_(1.), freqmul_(th.rate.invSampleRate)
 	{
-		RGen& r = th.rgen;
+		r.init(th.rgen.trand());
 		y1 = r.drand2();
 		y2 = r.drand2();
 		y3 = r.drand2();
@@ -1755,7 +1758,6 @@ struct LFNoise3 : public Gen
 
 	virtual void pull(Thread& th) override
 	{	
-		RGen& r = th.rgen;
 		Z* out = mOut->fulfillz(mBlockSize);
 		int framesToFill = mBlockSize;
 		Z x = phase_;
@@ -2684,6 +2686,9 @@ protected:
 	int64_t mPrevChaseTime;
 	
 	P<Form> mChasedSignals;
+	
+	FormLookupCache mOutCache;
+	FormLookupCache mDtCache;
 
 public:
 	OverlapAdd(Thread& th, Arg sounds, Arg hops, Arg rate, P<Form> const& chasedSignals, int numChannels);
@@ -2840,9 +2845,10 @@ void OverlapAdd::addNewSources(Thread& th, int blockSize)
 						parents[1] = newSource;
 						newSource = linearizeInheritance(th, 2, parents);
 					}
-					newSource.dot(th, s_out, out);
+					Form* form = (Form*)newSource.o();
+					form->dot(th, s_out, out, mOutCache);
 					V hop;
-					if (newSource.dot(th, s_dt, hop) && hop.isReal()) {
+					if (form->dot(th, s_dt, hop, mDtCache) && hop.isReal()) {
 						deltaTime = hop.f;
 					}
 
@@ -3101,7 +3107,7 @@ struct ITD : public Gen
 			} else {
 				for (int i = 0; i < n; ++i) {
 					{
-						Z fpos = std::max(2., *pan * half + half);
+						Z fpos = std::max<Z>(2., *pan * half + half);
 						Z ipos = floor(fpos);
 						Z frac = fpos - ipos;
 						int32_t offset = bufPos-(int32_t)ipos;
@@ -3113,7 +3119,7 @@ struct ITD : public Gen
 						Lout += Loutstride;
 					}
 					{
-						Z fpos = std::max(2., -*pan * half + half);
+						Z fpos = std::max<Z>(2., -*pan * half + half);
 						Z ipos = floor(fpos);
 						Z frac = fpos - ipos;
 						int32_t offset = bufPos-(int32_t)ipos;
@@ -3284,7 +3290,7 @@ void Pan2::pull(Thread& th)
 		}
 		
 		if (bStride == 0) {
-			Z x = std::clamp(*b, -1., 1.);
+			Z x = std::clamp<Z>(*b, -1., 1.);
 			Z Lpan = fast_pan(-x);
 			Z Rpan = fast_pan(x);
 			for (int i = 0; i < n; ++i) {
@@ -3297,7 +3303,7 @@ void Pan2::pull(Thread& th)
 			}
 		} else {
 			for (int i = 0; i < n; ++i) {
-				Z x = std::clamp(*b, -1., 1.);
+				Z x = std::clamp<Z>(*b, -1., 1.);
 				Z z = *a;
 				*Lout = z * fast_pan(-x);
 				*Rout = z * fast_pan(x);
@@ -3429,7 +3435,7 @@ void Balance2::pull(Thread& th)
 		}
 		
 		if (cStride == 0) {
-			Z x = std::clamp(*c, -1., 1.);
+			Z x = std::clamp<Z>(*c, -1., 1.);
 			Z Lpan = fast_pan(-x);
 			Z Rpan = fast_pan(x);
 			for (int i = 0; i < n; ++i) {
@@ -3442,7 +3448,7 @@ void Balance2::pull(Thread& th)
 			}
 		} else {
 			for (int i = 0; i < n; ++i) {
-				Z x = std::clamp(*c, -1., 1.);
+				Z x = std::clamp<Z>(*c, -1., 1.);
 				*Lout = *a * fast_pan(-x);
 				*Rout = *b * fast_pan(x);
 				a += aStride;
@@ -3705,7 +3711,7 @@ struct Fade2 : public Gen
 			}
 			
 			if (cStride == 0) {
-				Z x = std::clamp(*c, -1., 1.);
+				Z x = std::clamp<Z>(*c, -1., 1.);
 				Z Lpan = fast_pan(-x);
 				Z Rpan = fast_pan(x);
 				for (int i = 0; i < n; ++i) {
@@ -3715,7 +3721,7 @@ struct Fade2 : public Gen
 				}
 			} else {
 				for (int i = 0; i < n; ++i) {
-					Z x = std::clamp(*c, -1., 1.);
+					Z x = std::clamp<Z>(*c, -1., 1.);
 					out[i] = *a * fast_pan(-x) + *b * fast_pan(x);
 					a += aStride;
 					b += bStride;
@@ -4146,7 +4152,8 @@ struct Clip : public ThreeInputUGen<Clip>
 	
 	virtual const char* TypeName() const override { return "Clip"; }
 	
-	void calc(int n, Z* out, Z* a, Z* b, Z* c, int aStride, int bStride, int cStride) 
+	template <typename SA, typename SB, typename SC>
+	void calc(int n, Z* out, Z* a, Z* b, Z* c, SA aStride, SB bStride, SC cStride)
 	{
 		for (int i = 0; i < n; ++i) {
 			out[i] = std::clamp(*a, *b, *c);
@@ -4166,7 +4173,8 @@ struct Wrap : public ThreeInputUGen<Wrap>
 	
 	virtual const char* TypeName() const override { return "Wrap"; }
 	
-	void calc(int n, Z* out, Z* a, Z* b, Z* c, int aStride, int bStride, int cStride) 
+	template <typename SA, typename SB, typename SC>
+	void calc(int n, Z* out, Z* a, Z* b, Z* c, SA aStride, SB bStride, SC cStride)
 	{
 		for (int i = 0; i < n; ++i) {
 			out[i] = sc_wrap(*a, *b, *c);
@@ -17,10 +17,12 @@
 #include "VM.hpp"
 #include "Opcode.hpp"
 #include "Parser.hpp"
+#include "CodeImage.hpp"
 #include "MultichannelExpansion.hpp"
 #include "elapsedTime.hpp"
 #include <stdexcept>
 #include <limits.h>
+#include <unistd.h>
 
 VM vm;
 
@@ -228,28 +230,42 @@ static const char* promptString(EditLine *e)
 }
 #endif
 
+const int kHistorySaveInterval = 20; // lines entered between history file saves. it is also saved on quit.
+
 void Thread::getLine()
 {	
 	if (fromString) return;
-	switch (parsingWhat) {
-		default: case parsingWords : el_set(el, EL_PROMPT, &prompt); break;
-		case parsingString : el_set(el, EL_PROMPT, &promptString); break;
-		case parsingParens : el_set(el, EL_PROMPT, &promptParen); break;
-		case parsingLambda : el_set(el, EL_PROMPT, &promptLambda); break;
-		case parsingArray : el_set(el, EL_PROMPT, &promptSquareBracket); break;
-		case parsingEnvir : el_set(el, EL_PROMPT, &promptCurlyBracket); break;
+	if (pipedInput) {
+		ssize_t n = ::getline(&pipedLine, &pipedLineSize, pipedInput);
+		if (n < 0) { line = NULL; throw errUserQuit; }
+		line = pipedLine;
+		linelen = (int)n;
+	} else {
+		switch (parsingWhat) {
+			default: case parsingWords : el_set(el, EL_PROMPT, &prompt); break;
+			case parsingString : el_set(el, EL_PROMPT, &promptString); break;
+			case parsingParens : el_set(el, EL_PROMPT, &promptParen); break;
+			case parsingLambda : el_set(el, EL_PROMPT, &promptLambda); break;
+			case parsingArray : el_set(el, EL_PROMPT, &promptSquareBracket); break;
+			case parsingEnvir : el_set(el, EL_PROMPT, &promptCurlyBracket); break;
+		}
+		line = el_gets(el, &linelen);
+		if (!line) throw errUserQuit;
 	}
-	line = el_gets(el, &linelen);
 	linepos = 0;
 	if (strncmp(line, "quit", 4)==0 || strncmp(line, "..", 2)==0) { line = NULL; throw errUserQuit; }
 	if (line && linelen) {
-		history(myhistory, &ev, H_ENTER, line);
-		history(myhistory, &ev, H_SAVE, historyfilename);
-		if (logfilename) {
-			FILE* logfile = fopen(logfilename, "a");
+		if (!pipedInput) {
+			history(myhistory, &ev, H_ENTER, line);
+			if (++linesSinceHistorySave >= kHistorySaveInterval) {
+				history(myhistory, &ev, H_SAVE, historyfilename);
+				linesSinceHistorySave = 0;
+			}
+		}
+		if (logfile) {
 			logTimestamp(logfile);
-			fwrite(line, 1, strlen(line), logfile);
-			fclose(logfile);
+			fwrite(line, 1, linelen, logfile);
+			if (!pipedInput) fflush(logfile);
 		}
 	}
 }
@@ -300,32 +316,43 @@ void Thread::repl(FILE* infile, const char* inLogfilename)
 	Thread& th = *this;
 
 	logfilename = inLogfilename;
+	if (logfilename) {
+		logfile = fopen(logfilename, "a");
+	}
 	
 	previousTimeStamp = 0;
 
-#if USE_LIBEDIT
-	el = el_init("sc", stdin, stdout, stderr);
-	el_set(el, EL_PROMPT, &prompt);
-	el_set(el, EL_EDITOR, "emacs");
-	el_set(el, EL_BIND, "-s", "\t", "    ", NULL);
-
-	myhistory = history_init();
-	if (myhistory == 0) {
-		post("history could not be initialized\n");
-		return;
+	// piped input, such as a script, is read in large blocks without editline and is not added to the history.
+	if (!isatty(fileno(infile))) {
+		pipedInput = infile;
+		setvbuf(pipedInput, NULL, _IOFBF, 1 << 16);
 	}
 
-	const char* envHistoryFileName = getenv("SAPF_HISTORY");
-	if (envHistoryFileName) {
-		snprintf(historyfilename, PATH_MAX, "%s", envHistoryFileName);
-	} else {
-		const char* homeDir = getenv("HOME");
-		snprintf(historyfilename, PATH_MAX, "%s/sapf-history.txt", homeDir);
+#if USE_LIBEDIT
+	if (!pipedInput) {
+		el = el_init("sc", stdin, stdout, stderr);
+		el_set(el, EL_PROMPT, &prompt);
+		el_set(el, EL_EDITOR, "emacs");
+		el_set(el, EL_BIND, "-s", "\t", "    ", NULL);
+
+		myhistory = history_init();
+		if (myhistory == 0) {
+			post("history could not be initialized\n");
+			return;
+		}
+
+		const char* envHistoryFileName = getenv("SAPF_HISTORY");
+		if (envHistoryFileName) {
+			snprintf(historyfilename, PATH_MAX, "%s", envHistoryFileName);
+		} else {
+			const char* homeDir = getenv("HOME");
+			snprintf(historyfilename, PATH_MAX, "%s/sapf-history.txt", homeDir);
+		}
+		history(myhistory, &ev, H_SETSIZE, 800);
+		history(myhistory, &ev, H_LOAD, historyfilename);
+		history(myhistory, &ev, H_SETUNIQUE, 1);
+		el_set(el, EL_HIST, history, myhistory);
 	}
-	history(myhistory, &ev, H_SETSIZE, 800);
-	history(myhistory, &ev, H_LOAD, historyfilename);
-	history(myhistory, &ev, H_SETUNIQUE, 1);
-	el_set(el, EL_HIST, history, myhistory);
 #endif
 	
 	fflush(infile);
@@ -384,10 +411,18 @@ void Thread::repl(FILE* infile, const char* inLogfilename)
 	
 
 #if USE_LIBEDIT
-	history(myhistory, &ev, H_SAVE, historyfilename);
-	history_end(myhistory);
-	el_end(el);
+	if (!pipedInput) {
+		history(myhistory, &ev, H_SAVE, historyfilename);
+		history_end(myhistory);
+		el_end(el);
+	}
 #endif
+	if (logfile) {
+		fclose(logfile);
+		logfile = nullptr;
+	}
+	free(pipedLine);
+	pipedLine = nullptr;
 }
 
 
@@ -404,7 +439,7 @@ public:
 	T* operator->() { return p; }
 };
 
-void loadFile(Thread& th, const char* filename)
+void loadFile(Thread& th, const char* filename, const char* imagePath)
 {
     post("loading file '%s'\n", filename);
 	FILE* f = fopen(filename, "r");
@@ -425,8 +460,18 @@ void loadFile(Thread& th, const char* filename)
 	try {
 		{
 			P<Fun> compiledFun;
-			if (th.compile(p, compiledFun, true)) {
+			int64_t sourceHash = imagePath ? hashSourceText(p, fileSize) : 0;
+			P<FunDef> imageDef;
+			if (imagePath && readCodeImage(th, imagePath, sourceHash, imageDef)) {
+				post("loaded code image '%s'\n", imagePath);
+				compiledFun = new Fun(th, imageDef());
+			} else if (th.compile(p, compiledFun, true)) {
 				post("compiled OK.\n");
+				if (imagePath && !writeCodeImage(th, imagePath, sourceHash, compiledFun->mDef)) {
+					post("could not write code image '%s'\n", imagePath);
+				}
+			}
+			if (compiledFun()) {
 				compiledFun->run(th);
 				post("done loading file\n");
 			}
@@ -484,6 +529,7 @@ void VM::setSampleRate(double inSampleRate)
 
 V VM::def(Arg key, Arg value)
 {
+	if (defPure && value.isPrim()) ((Prim*)value.o())->mPure = true;
 	builtins->putImpure(key, value); 
     V dummy;
     assert(builtins->getInner(key, dummy));
@@ -0,0 +1,163 @@
+//    SAPF - Sound As Pure Form
+//    Copyright (C) 2019 James McCartney
+//
+//    This program is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "WaveTableCache.hpp"
+#include "Hash.hpp"
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+const char kWaveTableMagic[8] = { 'S', 'A', 'P', 'F', 'W', 'T', 'B', 0 };
+const uint32_t kWaveTableVersion = 1;
+
+struct WaveTableHeader
+{
+	char magic[8];
+	uint32_t version;
+	uint32_t sampleSize; // 4 or 8
+	int64_t key;
+	uint64_t numSamples;
+};
+
+static inline int64_t hashZ(int64_t hash, double z)
+{
+	int64_t word;
+	memcpy(&word, &z, sizeof(word));
+	return Hash64(hash + word);
+}
+
+int64_t hashWaveTableSpec(int n, const Z* amps, int ampStride, const Z* phases, int phaseStride, Z smooth, int tableSize, int numTables)
+{
+	// the float build has already rounded its inputs, so the key is per-build.
+	int64_t hash = Hash64(kWaveTableVersion);
+	hash = Hash64(hash + sizeof(Z));
+	hash = Hash64(hash + tableSize);
+	hash = Hash64(hash + numTables);
+	hash = Hash64(hash + n);
+	hash = hashZ(hash, smooth);
+	for (int i = 0; i < n; ++i) {
+		hash = hashZ(hash, *amps);
+		hash = hashZ(hash, *phases);
+		amps += ampStride;
+		phases += phaseStride;
+	}
+	return hash;
+}
+
+static bool waveTablePath(int64_t key, char* path, size_t len)
+{
+	const char* dir = getenv("SAPF_WAVETABLE_CACHE");
+	char defaultDir[PATH_MAX];
+	if (!dir) {
+		const char* homeDir = getenv("HOME");
+		if (!homeDir) return false;
+		snprintf(defaultDir, PATH_MAX, "%s/sapf-wavetables", homeDir);
+		dir = defaultDir;
+	}
+	if (!*dir) return false;
+	
+	mkdir(dir, 0755);
+	snprintf(path, len, "%s/%016llx.wtb", dir, (unsigned long long)key);
+	return true;
+}
+
+bool readWaveTableCache(int64_t key, Z* tables, size_t numSamples)
+{
+	char path[PATH_MAX];
+	if (!waveTablePath(key, path, PATH_MAX)) return false;
+	
+	int fd = open(path, O_RDONLY);
+	if (fd < 0) return false;
+
+	struct stat st;
+	if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(WaveTableHeader)) {
+		close(fd);
+		return false;
+	}
+	size_t size = st.st_size;
+	void* data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (data == MAP_FAILED) return false;
+
+	bool ok = false;
+	WaveTableHeader header;
+	memcpy(&header, data, sizeof(header));
+	if (memcmp(header.magic, kWaveTableMagic, sizeof(kWaveTableMagic)) == 0
+		&& header.version == kWaveTableVersion
+		&& header.key == key
+		&& header.numSamples == numSamples
+		&& (header.sampleSize == sizeof(float) || header.sampleSize == sizeof(double))
+		&& size == sizeof(header) + numSamples * header.sampleSize)
+	{
+		const char* samples = (const char*)data + sizeof(header);
+		if (header.sampleSize == sizeof(Z)) {
+			memcpy(tables, samples, numSamples * sizeof(Z));
+		} else if (header.sampleSize == sizeof(float)) {
+			const float* in = (const float*)samples;
+			for (size_t i = 0; i < numSamples; ++i) tables[i] = in[i];
+		} else {
+			const double* in = (const double*)samples;
+			for (size_t i = 0; i < numSamples; ++i) tables[i] = in[i];
+		}
+		ok = true;
+	}
+
+	munmap(data, size);
+	return ok;
+}
+
+bool writeWaveTableCache(int64_t key, const Z* tables, size_t numSamples)
+{
+	char path[PATH_MAX];
+	if (!waveTablePath(key, path, PATH_MAX)) return false;
+
+	bool storeFloat = getenv("SAPF_WAVETABLE_FLOAT") != nullptr;
+	
+	WaveTableHeader header;
+	memcpy(header.magic, kWaveTableMagic, sizeof(kWaveTableMagic));
+	header.version = kWaveTableVersion;
+	header.sampleSize = storeFloat ? sizeof(float) : sizeof(Z);
+	header.key = key;
+	header.numSamples = numSamples;
+
+	const void* samples = tables;
+	std::vector<float> floats;
+	if (storeFloat && sizeof(Z) != sizeof(float)) {
+		floats.assign(tables, tables + numSamples);
+		samples = floats.data();
+	}
+
+	// write to a temporary file and rename, so that a concurrent reader never sees a partial table.
+	std::string tmpPath = path;
+	tmpPath += ".tmp";
+	FILE* f = fopen(tmpPath.c_str(), "wb");
+	if (!f) return false;
+	bool ok = fwrite(&header, sizeof(header), 1, f) == 1
+		&& fwrite(samples, header.sampleSize, numSamples, f) == numSamples;
+	ok = fclose(f) == 0 && ok;
+	if (!ok || rename(tmpPath.c_str(), path) != 0) {
+		unlink(tmpPath.c_str());
+		return false;
+	}
+	return true;
+}
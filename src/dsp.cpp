@@ -18,6 +18,12 @@
 #include <string.h>
 #include <stdio.h>
 #include <cmath>
+#include <mutex>
+
+#ifndef SAPF_ACCELERATE
+// the fftw planner is not thread safe. FFTs may be created after startup, e.g. to build wave tables.
+static std::mutex gFFTWPlannerMutex;
+#endif
 
 void FFT::init(size_t log2n) {
 	this->n = pow(2, log2n);
@@ -26,8 +32,9 @@ void FFT::init(size_t log2n) {
 #ifdef SAPF_ACCELERATE
 	this->setup = vDSP_create_fftsetupD(this->log2n, kFFTRadix2);
 #else
-	this->in = (fftw_complex *) fftw_malloc(this->n * sizeof(fftw_complex));
-	this->out = (fftw_complex *) fftw_malloc(this->n * sizeof(fftw_complex));
+	std::lock_guard<std::mutex> lock(gFFTWPlannerMutex);
+	this->in = (SAPF_FFTW(complex) *) SAPF_FFTW(malloc)(this->n * sizeof(SAPF_FFTW(complex)));
+	this->out = (SAPF_FFTW(complex) *) SAPF_FFTW(malloc)(this->n * sizeof(SAPF_FFTW(complex)));
 	// "Here, n is the “logical” size of the DFT, not necessarily the
 	// physical size of the array. In particular, the real (double) array
 	// has n elements, while the complex (fftw_complex) array has n/2+1
@@ -37,14 +44,14 @@ void FFT::init(size_t log2n) {
 	// 2*(n/2+1) elements, where the elements beyond the first n are unused
 	// padding."
 	// - https://fftw.org/fftw3_doc/One_002dDimensional-DFTs-of-Real-Data.html
-	this->in_out_real = (double *) fftw_malloc(2 * (this->n / 2 + 1) * sizeof(double));
+	this->in_out_real = (Z *) SAPF_FFTW(malloc)(2 * (this->n / 2 + 1) * sizeof(Z));
 	
-	this->forward_out_of_place_plan = fftw_plan_dft_1d(this->n, this->in, this->out, FFTW_FORWARD, FFTW_ESTIMATE);
-	this->backward_out_of_place_plan = fftw_plan_dft_1d(this->n, this->in, this->out, FFTW_BACKWARD, FFTW_ESTIMATE);
-	this->forward_in_place_plan = fftw_plan_dft_1d(this->n, this->in, this->in, FFTW_FORWARD, FFTW_ESTIMATE);
-	this->backward_in_place_plan = fftw_plan_dft_1d(this->n, this->in, this->in, FFTW_BACKWARD, FFTW_ESTIMATE);
-	this->forward_real_plan = fftw_plan_dft_r2c_1d(this->n, this->in_out_real, (fftw_complex *) this->in_out_real, FFTW_ESTIMATE);
-	this->backward_real_plan = fftw_plan_dft_c2r_1d(this->n, (fftw_complex *) this->in_out_real, this->in_out_real, FFTW_ESTIMATE);
+	this->forward_out_of_place_plan = SAPF_FFTW(plan_dft_1d)(this->n, this->in, this->out, FFTW_FORWARD, FFTW_ESTIMATE);
+	this->backward_out_of_place_plan = SAPF_FFTW(plan_dft_1d)(this->n, this->in, this->out, FFTW_BACKWARD, FFTW_ESTIMATE);
+	this->forward_in_place_plan = SAPF_FFTW(plan_dft_1d)(this->n, this->in, this->in, FFTW_FORWARD, FFTW_ESTIMATE);
+	this->backward_in_place_plan = SAPF_FFTW(plan_dft_1d)(this->n, this->in, this->in, FFTW_BACKWARD, FFTW_ESTIMATE);
+	this->forward_real_plan = SAPF_FFTW(plan_dft_r2c_1d)(this->n, this->in_out_real, (SAPF_FFTW(complex) *) this->in_out_real, FFTW_ESTIMATE);
+	this->backward_real_plan = SAPF_FFTW(plan_dft_c2r_1d)(this->n, (SAPF_FFTW(complex) *) this->in_out_real, this->in_out_real, FFTW_ESTIMATE);
 #endif // SAPF_ACCELERATE
 }
 
@@ -52,20 +59,21 @@ FFT::~FFT() {
 #ifdef SAPF_ACCELERATE
 	vDSP_destroy_fftsetupD(this->setup);
 #else
-	fftw_destroy_plan(forward_out_of_place_plan);
-	fftw_destroy_plan(backward_out_of_place_plan);
-	fftw_destroy_plan(forward_in_place_plan);
-	fftw_destroy_plan(backward_in_place_plan);
-	fftw_destroy_plan(forward_real_plan);
-	fftw_destroy_plan(backward_real_plan);
+	std::lock_guard<std::mutex> lock(gFFTWPlannerMutex);
+	SAPF_FFTW(destroy_plan)(forward_out_of_place_plan);
+	SAPF_FFTW(destroy_plan)(backward_out_of_place_plan);
+	SAPF_FFTW(destroy_plan)(forward_in_place_plan);
+	SAPF_FFTW(destroy_plan)(backward_in_place_plan);
+	SAPF_FFTW(destroy_plan)(forward_real_plan);
+	SAPF_FFTW(destroy_plan)(backward_real_plan);
 	
-	fftw_free(this->in);
-	fftw_free(this->out);
-	fftw_free(this->in_out_real);
+	SAPF_FFTW(free)(this->in);
+	SAPF_FFTW(free)(this->out);
+	SAPF_FFTW(free)(this->in_out_real);
 #endif // SAPF_ACCELERATE
 }
 
-void FFT::forward(double *inReal, double *inImag, double *outReal, double *outImag) {
+void FFT::forward(Z *inReal, Z *inImag, Z *outReal, Z *outImag) {
 	double scale = 2. / this->n;
 #ifdef SAPF_ACCELERATE
 	DSPDoubleSplitComplex in;
@@ -85,7 +93,7 @@ void FFT::forward(double *inReal, double *inImag, double *outReal, double *outIm
 		this->in[i][0] = inReal[i];
 		this->in[i][1] = inImag[i];
 	}
-	fftw_execute(this->forward_out_of_place_plan);
+	SAPF_FFTW(execute)(this->forward_out_of_place_plan);
 	for(size_t i = 0; i < this->n; i++) {
 		outReal[i] = this->out[i][0] * scale;
 		outImag[i] = this->out[i][1] * scale;
@@ -93,7 +101,7 @@ void FFT::forward(double *inReal, double *inImag, double *outReal, double *outIm
 #endif // SAPF_ACCELERATE
 }
 
-void FFT::backward(double *inReal, double *inImag, double *outReal, double *outImag) {
+void FFT::backward(Z *inReal, Z *inImag, Z *outReal, Z *outImag) {
 	double scale = .5;
 #ifdef SAPF_ACCELERATE
 	DSPDoubleSplitComplex in;
@@ -113,7 +121,7 @@ void FFT::backward(double *inReal, double *inImag, double *outReal, double *outI
 		this->in[i][0] = inReal[i];
 		this->in[i][1] = inImag[i];
 	}
-	fftw_execute(this->backward_out_of_place_plan);
+	SAPF_FFTW(execute)(this->backward_out_of_place_plan);
 	for(size_t i = 0; i < this->n; i++) {
 		outReal[i] = this->out[i][0] * scale;
 		outImag[i] = this->out[i][1] * scale;
@@ -121,7 +129,7 @@ void FFT::backward(double *inReal, double *inImag, double *outReal, double *outI
 #endif // SAPF_ACCELERATE
 }
 
-void FFT::forward_in_place(double *ioReal, double *ioImag) {
+void FFT::forward_in_place(Z *ioReal, Z *ioImag) {
 	double scale = 2. / this->n;
 #ifdef SAPF_ACCELERATE
 	DSPDoubleSplitComplex io;
@@ -138,7 +146,7 @@ void FFT::forward_in_place(double *ioReal, double *ioImag) {
 		this->in[i][0] = ioReal[i];
 		this->in[i][1] = ioImag[i];
 	}
-	fftw_execute(this->forward_in_place_plan);
+	SAPF_FFTW(execute)(this->forward_in_place_plan);
 	for(size_t i = 0; i < this->n; i++) {
 		ioReal[i] = this->in[i][0] * scale;
 		ioImag[i] = this->in[i][1] * scale;
@@ -146,7 +154,7 @@ void FFT::forward_in_place(double *ioReal, double *ioImag) {
 #endif // SAPF_ACCELERATE
 }
 
-void FFT::backward_in_place(double *ioReal, double *ioImag) {
+void FFT::backward_in_place(Z *ioReal, Z *ioImag) {
 	double scale = .5;
 #ifdef SAPF_ACCELERATE
 	DSPDoubleSplitComplex io;
@@ -163,7 +171,7 @@ void FFT::backward_in_place(double *ioReal, double *ioImag) {
 		this->in[i][0] = ioReal[i];
 		this->in[i][1] = ioImag[i];
 	}
-	fftw_execute(this->backward_in_place_plan);
+	SAPF_FFTW(execute)(this->backward_in_place_plan);
 	for(size_t i = 0; i < this->n; i++) {
 		ioReal[i] = this->in[i][0] * scale;
 		ioImag[i] = this->in[i][1] * scale;
@@ -171,7 +179,7 @@ void FFT::backward_in_place(double *ioReal, double *ioImag) {
 #endif // SAPF_ACCELERATE
 }
 
-void FFT::forward_real(double *inReal, double *outReal, double *outImag) {
+void FFT::forward_real(Z *inReal, Z *outReal, Z *outImag) {
 	double scale = 2. / n;
 	int n2 = this->n/2;
 #ifdef SAPF_ACCELERATE
@@ -195,7 +203,7 @@ void FFT::forward_real(double *inReal, double *outReal, double *outImag) {
 	for(size_t i = 0; i < this->n; i++) {
 		this->in_out_real[i] = inReal[i];
 	}
-	fftw_execute(this->forward_real_plan);
+	SAPF_FFTW(execute)(this->forward_real_plan);
 	for(size_t i = 0; i < n2; i++) {
 		outReal[i] = this->in_out_real[2*i] * scale;
 		outImag[i] = this->in_out_real[2*i+1] * scale;
@@ -203,7 +211,7 @@ void FFT::forward_real(double *inReal, double *outReal, double *outImag) {
 #endif // SAPF_ACCELERATE
 }
 
-void FFT::backward_real(double *inReal, double *inImag, double *outReal) {
+void FFT::backward_real(Z *inReal, Z *inImag, Z *outReal) {
 	double scale = .5;
 	int n2 = this->n/2;
 #ifdef SAPF_ACCELERATE
@@ -225,7 +233,10 @@ void FFT::backward_real(double *inReal, double *inImag, double *outReal) {
 		this->in_out_real[2*i] = inReal[i];
 		this->in_out_real[2*i+1] = inImag[i];
 	}
-	fftw_execute(this->backward_real_plan);
+	// the nyquist bin is not passed in. it is zero, as in the accelerate version.
+	this->in_out_real[2*n2] = 0.;
+	this->in_out_real[2*n2+1] = 0.;
+	SAPF_FFTW(execute)(this->backward_real_plan);
 	for(size_t i = 0; i < this->n; i++) {
 		outReal[i] = this->in_out_real[i] * scale;
 	}
@@ -243,39 +254,39 @@ void initFFT()
 	}
 }
 
-void fft(int n, double* inReal, double* inImag, double* outReal, double* outImag)
+void fft(int n, Z* inReal, Z* inImag, Z* outReal, Z* outImag)
 {
 	int log2n = n == 0 ? 0 : 64 - __builtin_clzll(n - 1);
         ffts[log2n].forward(inReal, inImag, outReal, outImag);
 }
 
-void ifft(int n, double* inReal, double* inImag, double* outReal, double* outImag)
+void ifft(int n, Z* inReal, Z* inImag, Z* outReal, Z* outImag)
 {
 	int log2n = n == 0 ? 0 : 64 - __builtin_clzll(n - 1);
         ffts[log2n].backward(inReal, inImag, outReal, outImag);
 }
 
-void fft(int n, double* ioReal, double* ioImag)
+void fft(int n, Z* ioReal, Z* ioImag)
 {
 	int log2n = n == 0 ? 0 : 64 - __builtin_clzll(n - 1);
         ffts[log2n].forward_in_place(ioReal, ioImag);
 }
 
-void ifft(int n, double* ioReal, double* ioImag)
+void ifft(int n, Z* ioReal, Z* ioImag)
 {
 	int log2n = n == 0 ? 0 : 64 - __builtin_clzll(n - 1);
         ffts[log2n].backward_in_place(ioReal, ioImag);
 }
 
 
-void rfft(int n, double* inReal, double* outReal, double* outImag)
+void rfft(int n, Z* inReal, Z* outReal, Z* outImag)
 {
 	int log2n = n == 0 ? 0 : 64 - __builtin_clzll(n - 1);
         ffts[log2n].forward_real(inReal, outReal, outImag);
 }
 
 
-void rifft(int n, double* inReal, double* inImag, double* outReal)
+void rifft(int n, Z* inReal, Z* inImag, Z* outReal)
 {
 	int log2n = n == 0 ? 0 : 64 - __builtin_clzll(n - 1);
         ffts[log2n].backward_real(inReal, inImag, outReal);
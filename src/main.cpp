@@ -20,6 +20,7 @@
 #include <algorithm>
 #include <sys/stat.h>
 #include "primes.hpp"
+#include "Server.hpp"
 #include <complex>
 #ifdef SAPF_DISPATCH
 #include <dispatch/dispatch.h>
@@ -120,7 +121,10 @@ const char* gVersionString = "0.1.21";
 
 static void usage()
 {
-	fprintf(stdout, "sapf [-r sample-rate][-p prelude-file]\n");
+	fprintf(stdout, "sapf [-r sample-rate][-p prelude-file][-s socket-path]\n");
+	fprintf(stdout, "\n");
+	fprintf(stdout, "    -s socket-path\n");
+	fprintf(stdout, "    run as a server, evaluating requests sent to a Unix domain socket instead of reading stdin\n");
 	fprintf(stdout, "\n");
 	fprintf(stdout, "sapf [-h]\n");
 	fprintf(stdout, "    print this help\n");
@@ -134,6 +138,8 @@ static void replLoop(Thread th) {
 
 int main (int argc, const char * argv[]) 
 {
+	const char* socketPath = nullptr;
+	
 	post("------------------------------------------------\n");	
 	post("A tool for the expression of sound as pure form.\n");	
 	post("------------------------------------------------\n");	
@@ -158,6 +164,11 @@ int main (int argc, const char * argv[])
 					vm.prelude_file = argv[i+1];
 					i += 2;
 				} break;
+				case 's' : {
+					if (argc <= i+1) { post("expected socket path after -s\n"); return 1; }
+					socketPath = argv[i+1];
+					i += 2;
+				} break;
 				case 'h' : {
 					usage();
 					exit(0);
@@ -178,6 +189,8 @@ int main (int argc, const char * argv[])
 	vm.addBifHelp("   k - argument is expected to be a scalar, signals and streams are automapped.");
 	vm.addBifHelp("");
 	
+	startListReclaimer();
+	
 	AddCoreOps();
 	AddMathOps();
 	AddStreamOps();
@@ -223,7 +236,20 @@ int main (int argc, const char * argv[])
 		vm.prelude_file = getenv("SAPF_PRELUDE");
 	}
 	if (vm.prelude_file) {
-		loadFile(th, vm.prelude_file);
+		// the compiled prelude is cached in a code image, which is rebuilt whenever the prelude changes.
+		const char* imagePath = getenv("SAPF_PRELUDE_IMAGE");
+		char imagefilename[PATH_MAX];
+		if (!imagePath) {
+			const char* home_dir = getenv("HOME");
+			snprintf(imagefilename, PATH_MAX, "%s/sapf-prelude-image.bin", home_dir);
+			imagePath = imagefilename;
+		}
+		loadFile(th, vm.prelude_file, imagePath);
+	}
+	
+	if (socketPath) {
+		runServer(th, socketPath);
+		return 0;
 	}
 
 #ifdef SAPF_DISPATCH
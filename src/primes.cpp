@@ -17,6 +17,10 @@
 #include "primes.hpp"
 #include "ErrorCodes.hpp"
 #include <stdint.h>
+#include <string.h>
+#include <cmath>
+#include <atomic>
+#include <mutex>
 
 // Within a cycle of 30, there are only 8 numbers that are not multiples of 2, 3 or 5.
 // We pack these 8 into a one byte bit map.
@@ -2121,31 +2125,119 @@ uint8_t gPrimesMask[kPrimesMaskSize] = {
 };
 
 
-static bool isprime_slow(int64_t x)
+// The sieve past gPrimesMask is built in segments of kPrimesMaskSize bytes, in order, as they are needed.
+// Segment 0 is gPrimesMask. Base primes for sieving come from gPrimesMask, which covers every segment
+// up to kMaxPrimeSegments.
+
+const int gWheelSteps[8] = {6, 4, 2, 4, 2, 4, 6, 2};
+
+static std::atomic<uint8_t*> gPrimeSegments[kMaxPrimeSegments];
+static int64_t gPrimeSegmentCounts[kMaxPrimeSegments+1]; // number of primes above 30 before each segment.
+static std::atomic<int64_t> gNumPrimeSegments = 0;
+static std::mutex gPrimeSegmentsMutex;
+
+static int64_t countPrimes(const uint8_t* mask)
 {
-	for (int i = 3; i < 10; ++i) {
-		if (x % gLowPrimes[i] == 0)
-			return false;
-	}
+	int64_t count = 0;
+	for (int i = 0; i < kPrimesMaskSize; ++i) count += __builtin_popcount(mask[i]);
+	return count;
+}
+
+static void sieveSegment(int64_t k, uint8_t* mask)
+{
+	const int64_t firstByte = k * kPrimesMaskSize;
+	const int64_t lo = 30 * (firstByte + 1);
+	const int64_t hi = lo + 30 * (int64_t)kPrimesMaskSize;
+	memset(mask, 0xff, kPrimesMaskSize);
 	
-	for (int i = 0; i < kPrimesMaskSize; ++i) {
-		if (gPrimesMask[i] == 0) continue;
-		int64_t k = 30 * (i+1);
-		for (int j = 0; j < 8; ++j) {
-			if (!(gPrimesMask[k] & (1 << j))) continue;
-			int64_t m = k + gPrimeOffsets[j];
-			if (m*m > x) {
-				return true;
-			}
-			
-			if (x % m == 0) return false;
+	auto strike = [&](int64_t p) {
+		// cross off p*q for each q in [lo/p, hi/p) that is not a multiple of 2, 3 or 5.
+		int64_t q = (lo + p - 1) / p;
+		while (gPrimesShift[q % 30] < 0) ++q;
+		int j = gPrimesShift[q % 30];
+		for (int64_t m = p * q; m < hi; m = p * q) {
+			mask[m / 30 - 1 - firstByte] &= ~(1 << gPrimesShift[m % 30]);
+			q += gWheelSteps[j];
+			j = (j + 1) & 7;
+		}
+	};
+	
+	for (int i = 3; i < 10; ++i) strike(gLowPrimes[i]);
+	for (int64_t byte = 0; byte < kPrimesMaskSize; ++byte) {
+		for (int bit = 0; bit < 8; ++bit) {
+			if (!(gPrimesMask[byte] & (1 << bit))) continue;
+			int64_t p = 30 * (byte + 1) + gPrimeOffsets[bit];
+			if (p * p >= hi) return;
+			strike(p);
 		}
 	}
+}
+
+const uint8_t* primesSegment(int64_t k)
+{
+	if (k < gNumPrimeSegments.load(std::memory_order_acquire))
+		return gPrimeSegments[k].load(std::memory_order_relaxed);
+	if (k >= kMaxPrimeSegments)
+		return nullptr;
 	
-	throw errOutOfRange;
+	std::lock_guard<std::mutex> lock(gPrimeSegmentsMutex);
+	int64_t numSegments = gNumPrimeSegments.load(std::memory_order_relaxed);
+	for (; numSegments <= k; ++numSegments) {
+		uint8_t* mask = gPrimesMask;
+		if (numSegments > 0) {
+			mask = new uint8_t[kPrimesMaskSize];
+			sieveSegment(numSegments, mask);
+		}
+		gPrimeSegmentCounts[numSegments+1] = gPrimeSegmentCounts[numSegments] + countPrimes(mask);
+		gPrimeSegments[numSegments].store(mask, std::memory_order_relaxed);
+		gNumPrimeSegments.store(numSegments + 1, std::memory_order_release);
+	}
+	return gPrimeSegments[k].load(std::memory_order_relaxed);
 }
 
-#include <stdio.h>
+static uint64_t mulmod(uint64_t a, uint64_t b, uint64_t m)
+{
+	return (uint64_t)((unsigned __int128)a * b % m);
+}
+
+static uint64_t powmod(uint64_t a, uint64_t e, uint64_t m)
+{
+	uint64_t r = 1;
+	a %= m;
+	while (e) {
+		if (e & 1) r = mulmod(r, a, m);
+		a = mulmod(a, a, m);
+		e >>= 1;
+	}
+	return r;
+}
+
+static bool isprime_millerRabin(uint64_t n)
+{
+	// deterministic for all 64 bit n with the first 12 primes as witnesses.
+	// n is odd and has no factor below 30 here.
+	uint64_t d = n - 1;
+	int s = 0;
+	while (!(d & 1)) {
+		d >>= 1;
+		++s;
+	}
+	static const uint64_t witnesses[12] = {2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37};
+	for (uint64_t a : witnesses) {
+		uint64_t x = powmod(a, d, n);
+		if (x == 1 || x == n - 1) continue;
+		bool composite = true;
+		for (int r = 1; r < s; ++r) {
+			x = mulmod(x, x, n);
+			if (x == n - 1) {
+				composite = false;
+				break;
+			}
+		}
+		if (composite) return false;
+	}
+	return true;
+}
 
 bool isprime(int64_t x)
 {
@@ -2158,10 +2250,19 @@ bool isprime(int64_t x)
 	int shift = gPrimesShift[bit];
 	if (shift < 0) return false; // eliminate multiples of 2,3,5.
 	int64_t byte = x / 30 - 1;
-		
-	if (byte >= kPrimesMaskSize) return isprime_slow(x);	
+	int64_t k = byte / kPrimesMaskSize;
 	
-	return gPrimesMask[byte] & (1 << shift);
+	if (k == 0) return gPrimesMask[byte] & (1 << shift);
+	
+	// use the sieve as far as it has been built, rather than building it for one query.
+	if (k >= gNumPrimeSegments.load(std::memory_order_acquire)) {
+		for (int i = 3; i < 10; ++i) {
+			if (x % gLowPrimes[i] == 0) return false;
+		}
+		return isprime_millerRabin(x);
+	}
+	
+	return gPrimeSegments[k].load(std::memory_order_relaxed)[byte - k * kPrimesMaskSize] & (1 << shift);
 }
 
 
@@ -2172,8 +2273,70 @@ int64_t nextPrime(int64_t x)
 	}
 }
 
+// the end of the sieve when all kMaxPrimeSegments are built.
+const int64_t kPrimeSieveEnd = 30 * ((int64_t)kMaxPrimeSegments * kPrimesMaskSize + 1);
 
+int64_t nthPrime(int64_t n)
+{
+	if (n < 0) throw errOutOfRange;
+	if (n < 10) return gLowPrimes[n];
+	
+	// the mth prime is more than m (ln m + ln ln m - 1) for m >= 2 (Dusart), so an n whose prime is past the end of
+	// the sieve is refused here rather than after building every segment, which are never freed.
+	double m = (double)n + 1.;
+	if (m * (log(m) + log(log(m)) - 1.) >= kPrimeSieveEnd) throw errOutOfRange;
+	
+	n -= 10;
+	
+	// find the segment holding the prime using the running counts, then the byte by popcount.
+	int64_t k = 0;
+	const uint8_t* mask;
+	for (;; ++k) {
+		mask = primesSegment(k);
+		if (!mask) throw errOutOfRange;
+		if (gPrimeSegmentCounts[k+1] > n) break;
+	}
+	n -= gPrimeSegmentCounts[k];
+	
+	int64_t byte = 0;
+	for (;; ++byte) {
+		int count = __builtin_popcount(mask[byte]);
+		if (n < count) break;
+		n -= count;
+	}
+	int bits = mask[byte];
+	for (; n > 0; --n) bits &= bits - 1;
+	return 30 * (k * kPrimesMaskSize + byte + 1) + gPrimeOffsets[__builtin_ctz(bits)];
+}
 
-
-
-
+int64_t PrimeCursor::next()
+{
+	if (mByte < 0) {
+		int64_t p = gLowPrimes[mBit];
+		if (++mBit >= 10) {
+			mByte = 0;
+			mBit = 0;
+		}
+		return p;
+	}
+	while (1) {
+		int64_t k = mByte / kPrimesMaskSize;
+		if (!mSegment || k != mSegmentIndex) {
+			mSegment = primesSegment(k);
+			if (!mSegment) return 0;
+			mSegmentIndex = k;
+		}
+		int bits = mSegment[mByte - k * kPrimesMaskSize] >> mBit;
+		if (bits) {
+			mBit += __builtin_ctz(bits);
+			int64_t p = 30 * (mByte + 1) + gPrimeOffsets[mBit];
+			if (++mBit >= 8) {
+				++mByte;
+				mBit = 0;
+			}
+			return p;
+		}
+		++mByte;
+		mBit = 0;
+	}
+}